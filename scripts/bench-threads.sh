@@ -0,0 +1,24 @@
+#!/bin/sh
+# Runs the walk-gltf benchmark offscreen with 1, 2, 4, 8 and 16 threads
+# recording the draw commands and compares the runs against one thread.
+#
+# Usage: bench-threads.sh model.gltf [walk-gltf options]
+# Set WALK to the walk-gltf executable if it is not in the PATH.
+
+set -e
+
+if [ $# -lt 1 ]; then
+  sed -n '2,6p' "$0" | sed 's/^# \{0,1\}//'
+  exit 1
+fi
+
+WALK=${WALK:-walk-gltf}
+DIR=$(dirname "$0")
+FILES=""
+
+for n in 1 2 4 8 16; do
+  "$WALK" -offscreen -bench "threads-$n.json" -threads "$n" "$@"
+  FILES="$FILES threads-$n.json"
+done
+
+python3 "$DIR/compare-bench.py" $FILES
@@ -0,0 +1,54 @@
+#!/usr/bin/env python3
+# Compares the results of walk-gltf -bench runs, e.g. of two builds or of
+# different -threads counts. The first file is the baseline; for the others
+# the change of each stage against it is printed.
+
+import argparse
+import json
+import sys
+
+
+def load(filename):
+    with open(filename) as f:
+        return json.load(f)
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Compare walk-gltf benchmark results against a baseline.")
+    parser.add_argument("files", nargs="+", help="baseline.json other.json...")
+    parser.add_argument("-s", "--stat", default="p50",
+                        help="statistic to compare: mean, min, max, p50, "
+                             "p90, p95 or p99 (default p50)")
+    parser.add_argument("-c", "--counters", action="store_true",
+                        help="compare the counters instead of the stages")
+    args = parser.parse_args()
+
+    section = "counters" if args.counters else "stages"
+    results = [load(f)[section] for f in args.files]
+    names = list(results[0])
+    for r in results[1:]:
+        names += [n for n in r if n not in names]
+
+    width = max(len(n) for n in names + ["stage"])
+    header = "%-*s" % (width, "stage") + "".join(
+        "  %18s" % f[-18:] for f in args.files)
+    print(header)
+
+    for name in names:
+        base = results[0].get(name, {}).get(args.stat)
+        line = "%-*s" % (width, name)
+        for i, r in enumerate(results):
+            value = r.get(name, {}).get(args.stat)
+            if value is None:
+                line += "  %18s" % "-"
+            elif i == 0 or not base:
+                line += "  %18.3f" % value
+            else:
+                line += "  %10.3f %+6.1f%%" % (value, (value / base - 1) * 100)
+        print(line)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
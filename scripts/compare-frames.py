@@ -0,0 +1,124 @@
+#!/usr/bin/env python3
+# Compares frames saved by walk-gltf -o, e.g. of two builds or of different
+# options that should render the same image. Prints how many pixels differ
+# and by how much, and exits with status 1 if too many differ or a frame is
+# blank (a single color). Reads 8-bit RGB and RGBA PNGs without any
+# dependencies.
+
+import argparse
+import struct
+import sys
+import zlib
+
+
+def paeth(a, b, c):
+    p = a + b - c
+    pa, pb, pc = abs(p - a), abs(p - b), abs(p - c)
+    if pa <= pb and pa <= pc:
+        return a
+    return b if pb <= pc else c
+
+
+def load(filename):
+    """Returns the width, height, channels and the rows of a PNG."""
+    with open(filename, "rb") as f:
+        data = f.read()
+    if data[:8] != b"\x89PNG\r\n\x1a\n":
+        raise ValueError("%s: not a PNG" % filename)
+
+    pos, idat = 8, []
+    while pos < len(data):
+        length, kind = struct.unpack(">I4s", data[pos:pos + 8])
+        chunk = data[pos + 8:pos + 8 + length]
+        if kind == b"IHDR":
+            width, height, depth, color, _, _, interlace = struct.unpack(
+                ">IIBBBBB", chunk)
+            if depth != 8 or color not in (2, 6) or interlace != 0:
+                raise ValueError("%s: not an 8-bit RGB(A) PNG" % filename)
+        elif kind == b"IDAT":
+            idat.append(chunk)
+        pos += 12 + length
+
+    channels = 4 if color == 6 else 3
+    stride = width * channels
+    raw = zlib.decompress(b"".join(idat))
+    rows, prev = [], bytearray(stride)
+    for y in range(height):
+        start = y * (stride + 1)
+        kind = raw[start]
+        row = bytearray(raw[start + 1:start + 1 + stride])
+        if kind == 1:
+            for i in range(channels, stride):
+                row[i] = (row[i] + row[i - channels]) & 0xff
+        elif kind == 2:
+            row = bytearray((a + b) & 0xff for a, b in zip(row, prev))
+        elif kind == 3:
+            for i in range(stride):
+                left = row[i - channels] if i >= channels else 0
+                row[i] = (row[i] + ((left + prev[i]) >> 1)) & 0xff
+        elif kind == 4:
+            for i in range(stride):
+                left = row[i - channels] if i >= channels else 0
+                up_left = prev[i - channels] if i >= channels else 0
+                row[i] = (row[i] + paeth(left, prev[i], up_left)) & 0xff
+        rows.append(row)
+        prev = row
+    return width, height, channels, rows
+
+
+def is_blank(channels, rows):
+    first = rows[0][:channels]
+    return all(row == first * (len(row) // channels) for row in rows)
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Compare frames saved by walk-gltf -o.")
+    parser.add_argument("files", nargs="+", help="base.png other.png...")
+    parser.add_argument("-t", "--threshold", type=int, default=8,
+                        help="levels a color channel may differ by "
+                             "(default 8)")
+    parser.add_argument("-f", "--fraction", type=float, default=0.001,
+                        help="fraction of the pixels that may differ by "
+                             "more than the threshold (default 0.001)")
+    args = parser.parse_args()
+
+    width, height, channels, base = load(args.files[0])
+    status = 0
+    if is_blank(channels, base):
+        print("%s: blank" % args.files[0])
+        status = 1
+
+    for filename in args.files[1:]:
+        w, h, c, rows = load(filename)
+        if (w, h) != (width, height):
+            print("%s: %dx%d instead of %dx%d" % (filename, w, h, width,
+                                                 height))
+            status = 1
+            continue
+        if is_blank(c, rows):
+            print("%s: blank" % filename)
+            status = 1
+
+        # Only the color channels are compared, not alpha.
+        differing, max_diff, total = 0, 0, 0
+        for a, b in zip(base, rows):
+            for x in range(width):
+                d = max(abs(a[x * channels + i] - b[x * c + i])
+                        for i in range(3))
+                total += d
+                max_diff = max(max_diff, d)
+                differing += d > args.threshold
+
+        fraction = differing / (width * height)
+        print("%s: %d pixels (%.3f%%) differ by more than %d, max %d, "
+              "mean %.3f" % (filename, differing, fraction * 100,
+                             args.threshold, max_diff,
+                             total / (width * height)))
+        if fraction > args.fraction:
+            status = 1
+    return status
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,118 @@
+#!/usr/bin/env python3
+# Writes a glTF scene of n x n boxes in a wall facing the default camera of
+# walk-gltf, as a scene with many draws: each box is a node of its own,
+# sharing one of a few meshes and materials. Large enough scenes are
+# recorded on several threads and drawn as instances. With as many meshes
+# as boxes, nothing is instanced and the meshes fill more than one block of
+# the mesh arena.
+
+import argparse
+import base64
+import json
+import struct
+import sys
+
+NUM_MATERIALS = 8
+
+# The faces of a unit box as (normal, two axes spanning the face).
+FACES = [((1, 0, 0), (0, 1, 0), (0, 0, 1)), ((-1, 0, 0), (0, 0, 1), (0, 1, 0)),
+         ((0, 1, 0), (0, 0, 1), (1, 0, 0)), ((0, -1, 0), (1, 0, 0), (0, 0, 1)),
+         ((0, 0, 1), (1, 0, 0), (0, 1, 0)), ((0, 0, -1), (0, 1, 0), (1, 0, 0))]
+
+
+def box():
+    """Returns the positions, normals, texture coordinates and indices."""
+    pos, nrm, uv, idx = [], [], [], []
+    for n, a, b in FACES:
+        base = len(pos)
+        for s, t in ((0, 0), (1, 0), (1, 1), (0, 1)):
+            pos.append(tuple(0.5 * n[i] + (s - 0.5) * a[i] + (t - 0.5) * b[i]
+                             for i in range(3)))
+            nrm.append(n)
+            uv.append((s, t))
+        idx += [base, base + 1, base + 2, base, base + 2, base + 3]
+    return pos, nrm, uv, idx
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Write a glTF scene of n x n boxes.")
+    parser.add_argument("file", help="output .gltf")
+    parser.add_argument("-n", type=int, default=64,
+                        help="boxes per row and column (default 64)")
+    parser.add_argument("-m", "--meshes", type=int, default=16,
+                        help="meshes shared by the boxes (default 16)")
+    args = parser.parse_args()
+
+    pos, nrm, uv, idx = box()
+    data = b"".join(struct.pack("<3f", *p) for p in pos)
+    data += b"".join(struct.pack("<3f", *n) for n in nrm)
+    data += b"".join(struct.pack("<2f", *t) for t in uv)
+    data += struct.pack("<%dH" % len(idx), *idx)
+
+    v = len(pos)
+    views = [(0, 12 * v, 34962), (12 * v, 12 * v, 34962),
+             (24 * v, 8 * v, 34962), (32 * v, 2 * len(idx), 34963)]
+    accessors = [
+        {"bufferView": 0, "componentType": 5126, "count": v, "type": "VEC3",
+         "min": [-0.5] * 3, "max": [0.5] * 3},
+        {"bufferView": 1, "componentType": 5126, "count": v, "type": "VEC3"},
+        {"bufferView": 2, "componentType": 5126, "count": v, "type": "VEC2"},
+        {"bufferView": 3, "componentType": 5123, "count": len(idx),
+         "type": "SCALAR"},
+    ]
+
+    materials = [{
+        "name": "grid%d" % i,
+        "pbrMetallicRoughness": {
+            "baseColorFactor": [(i & 1) * 0.7 + 0.2, (i >> 1 & 1) * 0.7 + 0.2,
+                                (i >> 2 & 1) * 0.7 + 0.2, 1.0],
+            "metallicFactor": 0.0,
+            "roughnessFactor": 0.5,
+        },
+    } for i in range(NUM_MATERIALS)]
+    meshes = [{
+        "primitives": [{
+            "attributes": {"POSITION": 0, "NORMAL": 1, "TEXCOORD_0": 2},
+            "indices": 3,
+            "material": i % NUM_MATERIALS,
+        }],
+    } for i in range(args.meshes)]
+
+    # A wall 19.2 wide and high, 15 in front of the camera at (0, 1.7, 5)
+    # which looks down -z. The boxes are two thirds of their spacing wide.
+    spacing = 19.2 / args.n
+    nodes = []
+    for y in range(args.n):
+        for x in range(args.n):
+            nodes.append({
+                "mesh": (y * args.n + x) * 7 % args.meshes,
+                "translation": [(x - (args.n - 1) / 2) * spacing,
+                                1.7 + (y - (args.n - 1) / 2) * spacing,
+                                -10.0],
+                "scale": [spacing * 2 / 3] * 3,
+            })
+
+    gltf = {
+        "asset": {"version": "2.0", "generator": "make-grid.py"},
+        "scene": 0,
+        "scenes": [{"nodes": list(range(len(nodes)))}],
+        "nodes": nodes,
+        "meshes": meshes,
+        "materials": materials,
+        "accessors": accessors,
+        "bufferViews": [{"buffer": 0, "byteOffset": o, "byteLength": n,
+                         "target": t} for o, n, t in views],
+        "buffers": [{
+            "byteLength": len(data),
+            "uri": "data:application/octet-stream;base64," +
+                   base64.b64encode(data).decode(),
+        }],
+    }
+    with open(args.file, "w") as f:
+        json.dump(gltf, f)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,161 @@
+/*
+ Copyright (c) 2022 Tero Oinas
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+#include "core/fileutil.h"
+#include "image/bcn.h"
+#include "image/decoder.h"
+#include "image/mipmap.h"
+#include "loader/gltf.h"
+#include "sg/ktx2.h"
+
+#include <tiny_gltf.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+#include <set>
+
+using namespace cst;
+
+static void printHelp(std::string const &progname) {
+  std::cout << "Usage: " << progname << " [options] filename" << std::endl;
+  std::cout << "Bakes the textures of a GLTF model into " << BAKED_TEXTURE_DIR
+            << "/ directories next to the images.\n";
+  std::cout << "Options:" << std::endl;
+  std::cout << "  -f          Bake all textures, even if up to date\n";
+  std::cout << "  -bc1        Use BC1 instead of BC7 for color textures\n";
+  std::cout << "  -h          Print this help" << std::endl;
+}
+
+// Bakes an image used as a texture of the given type.
+static void bake(std::string const &filename, TextureType type, bool useBC1,
+                 bool force) {
+  std::string out = bakedTexturePath(filename, type);
+
+  std::error_code ec;
+  if (!force && std::filesystem::exists(out) &&
+      std::filesystem::last_write_time(out) >=
+          std::filesystem::last_write_time(filename, ec)) {
+    std::cout << "Up to date: " << out << "\n";
+    return;
+  }
+
+  ImageInfo info;
+  std::vector<uint8_t> const pixels = decodeImageFile(filename, info);
+  int const width = info.width;
+  int const height = info.height;
+
+  MipFilter filter = (type == TEXTURE_TYPE_ALBEDO)   ? MIP_FILTER_SRGB
+                     : (type == TEXTURE_TYPE_NORMAL) ? MIP_FILTER_NORMAL
+                                                     : MIP_FILTER_LINEAR;
+  std::vector<MipLevel> mips =
+      generateMipChain(pixels.data(), width, height, filter);
+
+  KTX2Image img;
+  img.format = (type == TEXTURE_TYPE_NORMAL) ? PIXEL_FORMAT_BC5
+               : useBC1                      ? PIXEL_FORMAT_BC1
+                                             : PIXEL_FORMAT_BC7;
+  img.width = width;
+  img.height = height;
+
+  for (auto const &mip : mips) {
+    std::vector<uint8_t> blocks =
+        compressImage(img.format, mip.pixels.data(), mip.width, mip.height);
+    img.levels.push_back({img.data.size(), blocks.size(), mip.width,
+                          mip.height});
+    img.data.insert(img.data.end(), blocks.begin(), blocks.end());
+  }
+
+  std::filesystem::create_directories(dirPart(out));
+  saveKTX2(out, img, type == TEXTURE_TYPE_ALBEDO);
+
+  std::cout << "Baked " << filename << " -> " << out << " (" << width << "x"
+            << height << ", " << mips.size() << " levels, " << img.data.size()
+            << " bytes)\n";
+}
+
+int main(int argc, char **argv) {
+  bool force = false;
+  bool useBC1 = false;
+  bool doPrintHelp = false;
+  std::string modelName;
+
+  for (int i = 1; i < argc; i++) {
+    std::string const arg(argv[i]);
+
+    if (arg == "-f")
+      force = true;
+    else if (arg == "-bc1")
+      useBC1 = true;
+    else if (arg == "-h")
+      doPrintHelp = true;
+    else if (arg[0] != '-')
+      modelName = arg;
+  }
+
+  if (doPrintHelp || modelName.empty()) {
+    printHelp(argv[0]);
+    return 0;
+  }
+
+  try {
+    tinygltf::TinyGLTF tiny;
+    tinygltf::Model model;
+    std::string err, warn;
+
+    std::string const gltf_ext = ".gltf";
+    bool ok;
+    if (modelName.size() > gltf_ext.size() &&
+        std::equal(gltf_ext.rbegin(), gltf_ext.rend(), modelName.rbegin()))
+      ok = tiny.LoadASCIIFromFile(&model, &err, &warn, modelName);
+    else
+      ok = tiny.LoadBinaryFromFile(&model, &err, &warn, modelName);
+
+    if (!ok)
+      throw std::runtime_error("failed to load GLTF model " + modelName);
+
+    // Collect the images by the texture types they are used as.
+    std::string const dirPath = dirPart(modelName);
+    std::set<std::pair<std::string, TextureType>> jobs;
+
+    for (auto const &tm : model.materials) {
+      jobs.insert({textureFilename(model, dirPath,
+                                   tm.pbrMetallicRoughness.baseColorTexture.index),
+                   TEXTURE_TYPE_ALBEDO});
+      jobs.insert({textureFilename(
+                       model, dirPath,
+                       tm.pbrMetallicRoughness.metallicRoughnessTexture.index),
+                   TEXTURE_TYPE_ROUGHNESS});
+      jobs.insert({textureFilename(model, dirPath, tm.normalTexture.index),
+                   TEXTURE_TYPE_NORMAL});
+    }
+
+    for (auto const &[filename, type] : jobs) {
+      if (filename.empty() || isKTX2File(filename))
+        continue;
+      bake(filename, type, useBC1, force);
+    }
+  } catch (std::runtime_error const &error) {
+    std::cerr << "Runtime error: " << error.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -27,6 +27,7 @@
 #include "sg/empty.h"
 #include "sg/light.h"
 #include "sg/nodeutil.h"
+#include "sg/texture_cache.h"
 
 #include <filesystem>
 #include <functional>
@@ -46,6 +47,14 @@ using std::filesystem::is_directory;
 static const vec4 DEFAULT_CLEAR_COLOR = vec4(0.28f, 0.38f, 0.48f, 1.0f);
 
 bool ViewerApp::doLoadTextures = true;
+std::string ViewerApp::recordPathFile;
+
+// Interval of the keys of a recorded camera path in seconds.
+static const float RECORD_INTERVAL = 0.25f;
+
+// Duration of the orbit around the model used by benchmarks without a
+// camera path.
+static const float BENCHMARK_ORBIT_TIME = 10.0f;
 
 ViewerApp::ViewerApp(int reqWidth, int reqHeight,
                      std::string const &programPath)
@@ -62,7 +71,18 @@ ViewerApp::ViewerApp(int reqWidth, int reqHeight,
   setScene(std::make_shared<EmptyScene>());
 }
 
-ViewerApp::~ViewerApp() {}
+ViewerApp::~ViewerApp() {
+  if (!recordPathFile.empty() && !recordedPath.empty()) {
+    try {
+      recordedPath.save(recordPathFile);
+      std::cout << "Camera path saved to " << recordPathFile << "\n";
+    } catch (std::runtime_error const &e) {
+      std::cerr << e.what() << "\n";
+    }
+  }
+}
+
+void ViewerApp::setCameraPath(CameraPath const &path) { cameraPath = path; }
 
 void ViewerApp::setScene(scene_ptr scene) {
   if (this->scene != nullptr)
@@ -97,6 +117,8 @@ void ViewerApp::loadModel(std::string const &modelName,
 
   getDispatcher()->add([this, modelName, cb, flatShading,
                         deduplicateVertices]() {
+    benchmark.setInfo("model", modelName);
+
     GLTFLoader loader(flatShading, deduplicateVertices, doLoadTextures, true);
     auto model = loader.load(modelName);
 
@@ -108,6 +130,10 @@ void ViewerApp::loadModel(std::string const &modelName,
 
     root = stageAllAndCollect(root);
     skyBox = root->find("skybox");
+
+    TextureCacheStats const cs = getTextureCache().getStats();
+    std::cout << "Textures loaded: " << cs.misses << ", cache hits: "
+              << cs.hits << "\n";
   });
 }
 
@@ -139,15 +165,36 @@ void ViewerApp::addLights() {
 }
 
 void ViewerApp::update(float elapsed, float delta) {
+  // Benchmarks without a path circle the model once it has been staged.
+  if (cameraPath.empty() && isBenchmarking() && isStaged())
+    cameraPath = CameraPath::orbit(getSceneBounds(), BENCHMARK_ORBIT_TIME);
+
+  vec3 pathPos;
+  if (!cameraPath.empty()) {
+    CameraPath::Key const key = cameraPath.sample(elapsed);
+    pathPos = key.position;
+    yaw = key.yaw;
+    pitch = key.pitch;
+  }
+
   mat4 rot = mat4::rot_y(yaw) * mat4::rot_x(pitch);
 
   {
     std::scoped_lock lock(camera->mutex());
 
     camera->setPerspective(70.0f, 0.1f, 500.0f);
-    camera->setLocalTransform(mat4::translate(camera->getLocalPosition()) *
-                              rot);
-    camera->move(vel * delta * speed * (fastMode ? 2.0f : 1.0f), walkMode);
+    if (!cameraPath.empty()) {
+      camera->setLocalTransform(mat4::translate(pathPos) * rot);
+    } else {
+      camera->setLocalTransform(mat4::translate(camera->getLocalPosition()) *
+                                rot);
+      camera->move(vel * delta * speed * (fastMode ? 2.0f : 1.0f), walkMode);
+    }
+
+    if (!recordPathFile.empty() && elapsed - recordPrev >= RECORD_INTERVAL) {
+      recordedPath.addKey({elapsed, camera->getLocalPosition(), yaw, pitch});
+      recordPrev = elapsed;
+    }
   }
 
   if (skyBox != nullptr) {
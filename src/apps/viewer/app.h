@@ -24,6 +24,7 @@
 
 #include "app/appbase.h"
 #include "sg/camera.h"
+#include "sg/camera_path.h"
 
 namespace cst::app {
 
@@ -42,10 +43,14 @@ public:
   // Add lights if not already present
   void addLights();
 
+  // Moves the camera along the path instead of by user input.
+  void setCameraPath(CameraPath const &path);
+
   void main();
 
   // Public settings
   static bool doLoadTextures; // Load and use textures
+  static std::string recordPathFile; // record the camera path here
 private:
   void update(float elapsed, float delta);
   void paint();
@@ -72,6 +77,13 @@ private:
 
   node_ptr lights[MAX_LIGHTS];
   vec3 vel;
+
+  // Path followed by the camera, empty if moved by the user.
+  CameraPath cameraPath;
+
+  // Path recorded from the movements of the camera.
+  CameraPath recordedPath;
+  float recordPrev = 0.0f;
 };
 
 } // namespace cst::app
@@ -33,10 +33,20 @@ static void printHelp(std::string const &progname) {
   std::cout << "  -s [path]   Use a skybox from the given directory\n";
   std::cout << "              Uses the following filenames: px.jpg, nx.jpg, py.jpg, ny.jpg, pz.jpg, ng.jp\n";
   std::cout << "  -l          Do not add extra lights\n";
-  std::cout << "  -fps        Print FPS to stdout\n";
+  std::cout << "  -fps        Print FPS and memory use to stdout\n";
+  std::cout << "  -vram [MB]  Limit texture memory, drop mip levels to fit\n";
   std::cout << "  -n          Force flat shading\n";
   std::cout << "  -x          Deduplicate vertices\n";
   std::cout << "  -t          Do not load textures\n";
+  std::cout << "  -o [file]   Render offscreen, save a frame as PNG and quit\n";
+  std::cout << "  -offscreen  Render offscreen, without a window\n";
+  std::cout << "  -bench [file]  Run a benchmark, write frame times as JSON\n";
+  std::cout << "  -frames [n] Frames rendered by a benchmark (default 1000)\n";
+  std::cout << "  -gpuscopes  Time each material on the GPU in benchmarks\n";
+  std::cout << "  -threads [n]   Threads recording commands (default all)\n";
+  std::cout << "  -bindless   Bind all materials with one descriptor set\n";
+  std::cout << "  -path [file]   Move the camera along a recorded path\n";
+  std::cout << "  -record [file] Record the camera path into a file\n";
   std::cout << "  -h          Print this help" << std::endl;
 }
 
@@ -51,6 +61,16 @@ int main(int argc, char **argv) {
   bool doAddExtraLights = true;
   bool doPrintHelp = false;
   bool doPrintFPS = false;
+  size_t textureBudget = 0;
+  std::string saveFrameFile;
+  bool offscreen = false;
+  std::string benchmarkFile;
+  int benchmarkFrames = 1000;
+  bool profileMaterials = false;
+  size_t recordThreads = 0;
+  bool bindless = false;
+  std::string cameraPathFile;
+  std::string recordPathFile;
   std::string modelName;
   std::string skyboxPath;
 
@@ -79,6 +99,27 @@ int main(int argc, char **argv) {
       doPrintHelp = true;
     } else if (arg == "-fps") {
       doPrintFPS = !doPrintFPS;
+    } else if (arg == "-vram" && argc > i + 1) {
+      textureBudget = size_t(std::strtoul(argv[++i], nullptr, 10)) << 20;
+    } else if (arg == "-o" && argc > i + 1) {
+      saveFrameFile = argv[++i];
+      offscreen = true;
+    } else if (arg == "-offscreen") {
+      offscreen = true;
+    } else if (arg == "-bench" && argc > i + 1) {
+      benchmarkFile = argv[++i];
+    } else if (arg == "-frames" && argc > i + 1) {
+      benchmarkFrames = std::max(1, std::atoi(argv[++i]));
+    } else if (arg == "-gpuscopes") {
+      profileMaterials = true;
+    } else if (arg == "-threads" && argc > i + 1) {
+      recordThreads = std::strtoul(argv[++i], nullptr, 10);
+    } else if (arg == "-bindless") {
+      bindless = true;
+    } else if (arg == "-path" && argc > i + 1) {
+      cameraPathFile = argv[++i];
+    } else if (arg == "-record" && argc > i + 1) {
+      recordPathFile = argv[++i];
     } else if (arg[0] != '-') {
       modelName = arg;
     }
@@ -98,6 +139,15 @@ int main(int argc, char **argv) {
   ViewerApp::borderless = borderless;
   ViewerApp::grabMouse = grabMouse;
   ViewerApp::doPrintFPS = doPrintFPS;
+  ViewerApp::textureBudget = textureBudget;
+  ViewerApp::offscreen = offscreen;
+  ViewerApp::saveFrameFile = saveFrameFile;
+  ViewerApp::benchmarkFile = benchmarkFile;
+  ViewerApp::benchmarkFrames = benchmarkFrames;
+  ViewerApp::profileMaterials = profileMaterials;
+  ViewerApp::recordThreads = recordThreads;
+  ViewerApp::bindless = bindless;
+  ViewerApp::recordPathFile = recordPathFile;
   ViewerApp::doLoadTextures = doLoadTextures;
 
   try {
@@ -108,13 +158,18 @@ int main(int argc, char **argv) {
     if (doAddExtraLights)
       cb = std::bind(&ViewerApp::addLights, &app);
 
+    if (!cameraPathFile.empty())
+      app.setCameraPath(CameraPath::load(cameraPathFile));
+
     if (skyboxPath != "")
       app.loadSkybox(skyboxPath);
     app.loadModel(modelName, cb, flatShading, deduplicateVertices);
 
     app.run();
   } catch (std::runtime_error const &error) {
+    // E.g. scripted offscreen runs fail on validation errors.
     std::cerr << "Runtime error: " << error.what() << std::endl;
+    return 1;
   }
   return 0;
 }
@@ -0,0 +1,73 @@
+/*
+ Copyright (c) 2022 Tero Oinas
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+#ifndef _CST_BENCH_BENCH_H
+#define _CST_BENCH_BENCH_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <limits>
+
+// Timing helpers for the microbenchmarks. Each benchmark is run a few
+// times and the fastest run is reported, which filters out most of the
+// noise of a desktop machine.
+
+namespace bench {
+
+// Keeps the compiler from optimizing away a computed value.
+template <typename T> inline void keep(T const &value) {
+  asm volatile("" : : "r"(&value) : "memory");
+}
+
+// Returns the fastest time in nanoseconds of runs calls of f, divided by
+// items, e.g. the number of matrices processed by one call.
+template <typename F> double nsPerItem(F &&f, double items, int runs = 7) {
+  double best = std::numeric_limits<double>::max();
+  for (int r = 0; r < runs; r++) {
+    auto const start = std::chrono::steady_clock::now();
+    f();
+    std::chrono::duration<double, std::nano> const t =
+        std::chrono::steady_clock::now() - start;
+    best = std::min(best, t.count());
+  }
+  return best / items;
+}
+
+// Prints a result line, with the speedup against a baseline if given.
+inline void report(char const *name, double ns, double baseline = 0.0) {
+  if (baseline > 0.0)
+    std::printf("%-40s %10.2f ns  %5.2fx\n", name, ns, baseline / ns);
+  else
+    std::printf("%-40s %10.2f ns\n", name, ns);
+}
+
+// Prints a result line of a time in milliseconds.
+inline void reportMs(char const *name, double ms, double baseline = 0.0) {
+  if (baseline > 0.0)
+    std::printf("%-40s %10.3f ms  %5.2fx\n", name, ms, baseline / ms);
+  else
+    std::printf("%-40s %10.3f ms\n", name, ms);
+}
+
+} // namespace bench
+
+#endif // _CST_BENCH_BENCH_H
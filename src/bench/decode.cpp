@@ -0,0 +1,165 @@
+/*
+ Copyright (c) 2022 Tero Oinas
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+// Benchmark of the image decoders: the decoder chosen for each file, e.g.
+// libjpeg-turbo or libspng, against stb_image. The output of the decoder is
+// compared with stb_image's, as libjpeg-turbo decodes with the fast integer
+// DCT, which rounds differently.
+//
+// Textures are decoded straight into the staging ring. The time that saves
+// is measured against decoding into a new buffer and copying that into
+// staging memory, as textures were staged before. Lavapipe's staging memory
+// is ordinary system memory, like the buffers here.
+//
+// Usage: walk-bench-decode [image files]
+// Without files, a generated 2048x2048 image is encoded as PNG and JPEG.
+
+#include "bench.h"
+#include "core/fileutil.h"
+#include "image/decoder.h"
+#include "support/stb_image.h"
+#include "support/stb_image_write.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace cst;
+
+static const int GENERATED_SIZE = 2048;
+
+struct EncodedImage {
+  std::string name;
+  std::vector<uint8_t> data;
+};
+
+static void append(void *context, void *data, int size) {
+  auto *out = static_cast<std::vector<uint8_t> *>(context);
+  uint8_t const *bytes = static_cast<uint8_t const *>(data);
+  out->insert(out->end(), bytes, bytes + size);
+}
+
+// Returns a smooth image with some noise, encoded as PNG and JPEG.
+static std::vector<EncodedImage> generateImages() {
+  int const n = GENERATED_SIZE;
+  std::vector<uint8_t> pixels(size_t(n) * n * 4);
+  std::mt19937 rng(1);
+  std::uniform_int_distribution<int> noise(-8, 8);
+  for (int y = 0; y < n; y++) {
+    for (int x = 0; x < n; x++) {
+      uint8_t *p = &pixels[(size_t(y) * n + x) * 4];
+      float const s = std::sin(x * 0.01f) * std::cos(y * 0.013f);
+      p[0] = std::clamp(int(128 + 100 * s) + noise(rng), 0, 255);
+      p[1] = std::clamp(x * 255 / n + noise(rng), 0, 255);
+      p[2] = std::clamp(y * 255 / n + noise(rng), 0, 255);
+      p[3] = 255;
+    }
+  }
+
+  std::vector<EncodedImage> images(2);
+  images[0].name = "generated.png";
+  stbi_write_png_to_func(append, &images[0].data, n, n, 4, pixels.data(),
+                         n * 4);
+  images[1].name = "generated.jpg";
+  stbi_write_jpg_to_func(append, &images[1].data, n, n, 4, pixels.data(), 90);
+  return images;
+}
+
+// Decodes with stb_image into dst, as the stb_image decoder does.
+static void decodeStb(EncodedImage const &img, uint8_t *dst) {
+  int width, height, comp;
+  stbi_uc *pix = stbi_load_from_memory(img.data.data(), img.data.size(),
+                                       &width, &height, &comp, 4);
+  if (pix == nullptr) {
+    std::fprintf(stderr, "%s: %s\n", img.name.c_str(), stbi_failure_reason());
+    std::exit(1);
+  }
+  std::memcpy(dst, pix, size_t(width) * height * 4);
+  stbi_image_free(pix);
+}
+
+static void run(EncodedImage const &img) {
+  ImageDecoder const &decoder =
+      findImageDecoder(img.data.data(), img.data.size());
+  ImageInfo const info = decoder.readInfo(img.data.data(), img.data.size());
+  size_t const size = size_t(info.width) * info.height * 4;
+  std::vector<uint8_t> stb(size), out(size);
+
+  std::printf("%s: %dx%d, %zu kB, %s\n", img.name.c_str(), info.width,
+              info.height, img.data.size() >> 10, decoder.getName());
+
+  double const base =
+      bench::nsPerItem([&] { decodeStb(img, stb.data()); }, 1e6, 3);
+  bench::reportMs("  stb_image", base);
+  double const ms = bench::nsPerItem(
+      [&] {
+        decoder.decode(img.data.data(), img.data.size(), info, out.data());
+      },
+      1e6, 3);
+  bench::reportMs((std::string("  ") + decoder.getName()).c_str(), ms, base);
+
+  int maxDiff = 0;
+  uint64_t sumDiff = 0;
+  for (size_t i = 0; i < size; i++) {
+    int const d = std::abs(int(out[i]) - int(stb[i]));
+    maxDiff = std::max(maxDiff, d);
+    sumDiff += d;
+  }
+  std::printf("  difference from stb_image: max %d, mean %.3f\n", maxDiff,
+              double(sumDiff) / size);
+
+  std::vector<uint8_t> staging(size);
+  double const copied = bench::nsPerItem(
+      [&] {
+        std::vector<uint8_t> pixels(size);
+        decoder.decode(img.data.data(), img.data.size(), info, pixels.data());
+        std::memcpy(staging.data(), pixels.data(), size);
+        bench::keep(staging);
+      },
+      1e6, 3);
+  bench::reportMs("  decode, copy into staging", copied);
+  bench::reportMs("  decode into staging",
+                  bench::nsPerItem(
+                      [&] {
+                        decoder.decode(img.data.data(), img.data.size(), info,
+                                       staging.data());
+                        bench::keep(staging);
+                      },
+                      1e6, 3),
+                  copied);
+}
+
+int main(int argc, char **argv) {
+  std::vector<EncodedImage> images;
+  for (int i = 1; i < argc; i++)
+    images.push_back({argv[i], loadFile(argv[i])});
+  if (images.empty())
+    images = generateImages();
+
+  std::printf("Fastest of 3 decodes per image\n");
+  for (EncodedImage const &img : images)
+    run(img);
+  return 0;
+}
@@ -0,0 +1,337 @@
+/*
+ Copyright (c) 2022 Tero Oinas
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+// Microbenchmarks of the math kernels against plain scalar versions of the
+// same operations, and of calcTangents on large meshes. Build with
+// -DWALK_BUILD_BENCH=ON and a release build type.
+
+#include "bench.h"
+#include "core/memusage.h"
+#include "math/mat4.h"
+#include "math/mathutil.h"
+
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace cst;
+
+static const size_t N = 1 << 16;
+
+namespace scalar {
+
+mat4 mul(mat4 const &a, mat4 const &b) {
+  mat4 r;
+  for (int c = 0; c < 4; c++)
+    for (int row = 0; row < 4; row++) {
+      float s = 0.0f;
+      for (int k = 0; k < 4; k++)
+        s += a.m[k * 4 + row] * b.m[c * 4 + k];
+      r.m[c * 4 + row] = s;
+    }
+  return r;
+}
+
+vec4 mul(mat4 const &a, vec4 const &v) {
+  vec4 r;
+  for (int row = 0; row < 4; row++) {
+    float s = 0.0f;
+    for (int k = 0; k < 4; k++)
+      s += a.m[k * 4 + row] * v.d[k];
+    r.d[row] = s;
+  }
+  return r;
+}
+
+mat4 transpose(mat4 const &a) {
+  mat4 r;
+  for (int c = 0; c < 4; c++)
+    for (int row = 0; row < 4; row++)
+      r.m[row * 4 + c] = a.m[c * 4 + row];
+  return r;
+}
+
+// The cofactor expansion mat4::invert used before the SIMD version.
+mat4 invert(mat4 const &a) {
+  float const *m = a.m;
+  float b00 = m[0] * m[5] - m[1] * m[4];
+  float b01 = m[0] * m[6] - m[2] * m[4];
+  float b02 = m[0] * m[7] - m[3] * m[4];
+  float b03 = m[1] * m[6] - m[2] * m[5];
+  float b04 = m[1] * m[7] - m[3] * m[5];
+  float b05 = m[2] * m[7] - m[3] * m[6];
+  float b06 = m[8] * m[13] - m[9] * m[12];
+  float b07 = m[8] * m[14] - m[10] * m[12];
+  float b08 = m[8] * m[15] - m[11] * m[12];
+  float b09 = m[9] * m[14] - m[10] * m[13];
+  float b10 = m[9] * m[15] - m[11] * m[13];
+  float b11 = m[10] * m[15] - m[11] * m[14];
+  float det =
+      1.0f / (b00 * b11 - b01 * b10 + b02 * b09 + b03 * b08 - b04 * b07 +
+              b05 * b06);
+
+  mat4 r;
+  float *o = r.m;
+  o[0] = (m[5] * b11 - m[6] * b10 + m[7] * b09) * det;
+  o[1] = (m[2] * b10 - m[1] * b11 - m[3] * b09) * det;
+  o[2] = (m[13] * b05 - m[14] * b04 + m[15] * b03) * det;
+  o[3] = (m[10] * b04 - m[9] * b05 - m[11] * b03) * det;
+  o[4] = (m[6] * b08 - m[4] * b11 - m[7] * b07) * det;
+  o[5] = (m[0] * b11 - m[2] * b08 + m[3] * b07) * det;
+  o[6] = (m[14] * b02 - m[12] * b05 - m[15] * b01) * det;
+  o[7] = (m[8] * b05 - m[10] * b02 + m[11] * b01) * det;
+  o[8] = (m[4] * b10 - m[5] * b08 + m[7] * b06) * det;
+  o[9] = (m[1] * b08 - m[0] * b10 - m[3] * b06) * det;
+  o[10] = (m[12] * b04 - m[13] * b02 + m[15] * b00) * det;
+  o[11] = (m[9] * b02 - m[8] * b04 - m[11] * b00) * det;
+  o[12] = (m[5] * b07 - m[4] * b09 - m[6] * b06) * det;
+  o[13] = (m[0] * b09 - m[1] * b07 + m[2] * b06) * det;
+  o[14] = (m[13] * b01 - m[12] * b03 - m[14] * b00) * det;
+  o[15] = (m[8] * b03 - m[9] * b01 + m[10] * b00) * det;
+  return r;
+}
+
+} // namespace scalar
+
+// Returns n random rigid transforms with a scale, which are invertible.
+static std::vector<mat4> randomMatrices(size_t n, std::mt19937 &rng) {
+  std::uniform_real_distribution<float> u(-1.0f, 1.0f);
+  std::vector<mat4> ms(n);
+  for (mat4 &m : ms)
+    m = mat4::translate(vec3(u(rng), u(rng), u(rng)) * 10.0f) *
+        mat4::rot_axis(u(rng) * 3.0f, vec3(u(rng), u(rng), 1.0f)) *
+        mat4::scale(1.5f + u(rng));
+  return ms;
+}
+
+static bool near(mat4 const &a, mat4 const &b) {
+  for (int i = 0; i < 16; i++)
+    if (std::abs(a.m[i] - b.m[i]) > 1e-3f * (1.0f + std::abs(b.m[i])))
+      return false;
+  return true;
+}
+
+// Checks the kernels against the scalar versions so that a fast but wrong
+// kernel is not reported as a speedup.
+static bool check(std::vector<mat4> const &a, std::vector<mat4> const &b) {
+  for (size_t i = 0; i < 256; i++)
+    if (!near(a[i] * b[i], scalar::mul(a[i], b[i])) ||
+        !near(a[i].transpose(), scalar::transpose(a[i])) ||
+        !near(a[i].invert(), scalar::invert(a[i])))
+      return false;
+  return true;
+}
+
+// Returns a wavy grid of size * size vertices.
+static void gridMesh(int size, std::vector<vertex> &vertices,
+                     std::vector<uint32_t> &indices) {
+  vertices.resize(size_t(size) * size);
+  for (int z = 0; z < size; z++) {
+    for (int x = 0; x < size; x++) {
+      vertex &v = vertices[size_t(z) * size + x];
+      v.pos = vec3(float(x), std::sin(x * 0.1f) * std::cos(z * 0.1f),
+                   float(z));
+      v.normal = vec3(0.0f, 1.0f, 0.0f);
+      v.texcoord = vec2(float(x) / size, float(z) / size);
+    }
+  }
+
+  indices.clear();
+  indices.reserve(size_t(size - 1) * (size - 1) * 6);
+  for (int z = 0; z < size - 1; z++) {
+    for (int x = 0; x < size - 1; x++) {
+      uint32_t const i = z * size + x;
+      indices.insert(indices.end(), {i, i + size, i + 1, i + 1, i + size,
+                                     i + size + 1});
+    }
+  }
+}
+
+// Times calcTangents on a grid mesh and reports how much the peak memory
+// use grew while it ran, if it did.
+static void benchTangents(int size) {
+  std::vector<vertex> vertices;
+  std::vector<uint32_t> indices;
+  gridMesh(size, vertices, indices);
+
+  size_t const rss = currentRSS();
+  size_t const peak = peakRSS();
+  calcTangents(vertices, indices);
+  size_t const newPeak = peakRSS();
+
+  double const ms =
+      bench::nsPerItem([&] { calcTangents(vertices, indices); }, 1e6, 3);
+  std::string const name = "calcTangents, " + std::to_string(size) + "^2" +
+                           " vertices";
+  bench::reportMs(name.c_str(), ms);
+  if (newPeak > peak)
+    std::printf("%-40s %10zu MB\n", "  peak memory growth",
+                (newPeak - rss) >> 20);
+}
+
+int main() {
+  std::mt19937 rng(1);
+  std::vector<mat4> const a = randomMatrices(N, rng);
+  std::vector<mat4> const b = randomMatrices(N, rng);
+  std::vector<mat4> out(N);
+  if (!check(a, b)) {
+    std::fprintf(stderr, "math kernels differ from the scalar versions\n");
+    return 1;
+  }
+
+  std::vector<vec4> vecs(N), vout(N);
+  std::uniform_real_distribution<float> u(-10.0f, 10.0f);
+  for (vec4 &v : vecs)
+    v = vec4(u(rng), u(rng), u(rng), 1.0f);
+
+  std::printf("%zu items per run, time per item\n", N);
+
+  double base = bench::nsPerItem(
+      [&] {
+        for (size_t i = 0; i < N; i++)
+          out[i] = scalar::mul(a[i], b[i]);
+        bench::keep(out);
+      },
+      N);
+  bench::report("mat4 * mat4, scalar", base);
+  bench::report("mat4 * mat4",
+                bench::nsPerItem(
+                    [&] {
+                      for (size_t i = 0; i < N; i++)
+                        out[i] = a[i] * b[i];
+                      bench::keep(out);
+                    },
+                    N),
+                base);
+  bench::report("mulMatrices(a[], b[])",
+                bench::nsPerItem(
+                    [&] {
+                      mulMatrices(a.data(), b.data(), out.data(), N);
+                      bench::keep(out);
+                    },
+                    N),
+                base);
+  bench::report("mulMatrices(a, b[])",
+                bench::nsPerItem(
+                    [&] {
+                      mulMatrices(a[0], b.data(), out.data(), N);
+                      bench::keep(out);
+                    },
+                    N),
+                base);
+
+  base = bench::nsPerItem(
+      [&] {
+        for (size_t i = 0; i < N; i++)
+          vout[i] = scalar::mul(a[i], vecs[i]);
+        bench::keep(vout);
+      },
+      N);
+  bench::report("mat4 * vec4, scalar", base);
+  bench::report("mat4 * vec4",
+                bench::nsPerItem(
+                    [&] {
+                      for (size_t i = 0; i < N; i++)
+                        vout[i] = a[i] * vecs[i];
+                      bench::keep(vout);
+                    },
+                    N),
+                base);
+
+  base = bench::nsPerItem(
+      [&] {
+        for (size_t i = 0; i < N; i++)
+          out[i] = scalar::transpose(a[i]);
+        bench::keep(out);
+      },
+      N);
+  bench::report("transpose, scalar", base);
+  bench::report("transpose",
+                bench::nsPerItem(
+                    [&] {
+                      for (size_t i = 0; i < N; i++)
+                        out[i] = a[i].transpose();
+                      bench::keep(out);
+                    },
+                    N),
+                base);
+
+  base = bench::nsPerItem(
+      [&] {
+        for (size_t i = 0; i < N; i++)
+          out[i] = scalar::invert(a[i]);
+        bench::keep(out);
+      },
+      N);
+  bench::report("invert, scalar", base);
+  bench::report("invert",
+                bench::nsPerItem(
+                    [&] {
+                      for (size_t i = 0; i < N; i++)
+                        out[i] = a[i].invert();
+                      bench::keep(out);
+                    },
+                    N),
+                base);
+
+  // Points, one at a time (AoS) against the SoA batch.
+  std::vector<float> x(N), y(N), z(N), ox(N), oy(N), oz(N);
+  for (size_t i = 0; i < N; i++) {
+    x[i] = vecs[i].d[0];
+    y[i] = vecs[i].d[1];
+    z[i] = vecs[i].d[2];
+  }
+  mat4 const &m = a[0];
+
+  base = bench::nsPerItem(
+      [&] {
+        for (size_t i = 0; i < N; i++)
+          vout[i] = scalar::mul(m, vecs[i]);
+        bench::keep(vout);
+      },
+      N);
+  bench::report("transform points, scalar", base);
+  bench::report("transform points, mat4 * vec4",
+                bench::nsPerItem(
+                    [&] {
+                      for (size_t i = 0; i < N; i++)
+                        vout[i] = m * vecs[i];
+                      bench::keep(vout);
+                    },
+                    N),
+                base);
+  bench::report("transformPoints (SoA)",
+                bench::nsPerItem(
+                    [&] {
+                      transformPoints(m, x.data(), y.data(), z.data(),
+                                      ox.data(), oy.data(), oz.data(), N);
+                      bench::keep(ox);
+                    },
+                    N),
+                base);
+
+  // The largest first, so that its temporary memory raises the peak.
+  std::printf("\n");
+  for (int size : {2048, 1024, 256})
+    benchTangents(size);
+  return 0;
+}
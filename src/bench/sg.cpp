@@ -0,0 +1,282 @@
+/*
+ Copyright (c) 2022 Tero Oinas
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+// Benchmarks of the scene graph: updating the world transforms of deep and
+// wide hierarchies with the TransformStore against the recursive
+// Node::updateGlobalTransform, culling with the BVH against testing
+// every node, and the frustum tests of single boxes.
+
+#include "bench.h"
+#include "sg/bvh.h"
+#include "sg/node.h"
+#include "sg/transform_store.h"
+
+#include <algorithm>
+#include <functional>
+#include <random>
+
+using namespace cst;
+
+static const int NUM_NODES = 1 << 16;
+static const int NUM_CULLED_NODES = 100000;
+
+// Returns a root with chains of length nodes below it.
+static node_ptr deepHierarchy(int chains, int length) {
+  node_ptr root = std::make_shared<Node>("root");
+  for (int c = 0; c < chains; c++) {
+    node_ptr parent = root;
+    for (int i = 0; i < length; i++) {
+      node_ptr node = std::make_shared<Node>();
+      node->setLocalTransform(mat4::translate(vec3(0.0f, 1.0f, 0.0f)) *
+                              mat4::rot_y(0.01f * i));
+      parent = parent->addChild(node);
+    }
+  }
+  return root;
+}
+
+// Returns a root with all the nodes as its direct children.
+static node_ptr wideHierarchy(int nodes) {
+  node_ptr root = std::make_shared<Node>("root");
+  for (int i = 0; i < nodes; i++) {
+    node_ptr node = std::make_shared<Node>();
+    node->setLocalTransform(mat4::translate(vec3(float(i % 256), 0.0f,
+                                                 float(i / 256))));
+    root->addChild(node);
+  }
+  return root;
+}
+
+static void collect(node_ptr const &root, std::vector<node_ptr> &nodes) {
+  root->forEach([&](node_ptr node) { nodes.push_back(node); }, true);
+}
+
+// Times updating all the transforms after the root has moved, and after
+// every hundredth node has moved.
+static void run(char const *name,
+                std::function<node_ptr()> const &makeHierarchy) {
+  node_ptr rec = makeHierarchy();
+  node_ptr flat = makeHierarchy();
+  TransformStore store;
+  store.build(flat);
+  store.update();
+  rec->updateGlobalTransform(mat4());
+
+  std::vector<node_ptr> recNodes, flatNodes;
+  collect(rec, recNodes);
+  collect(flat, flatNodes);
+
+  float angle = 0.0f;
+  auto moveRoot = [&](node_ptr const &root) {
+    angle += 0.01f;
+    root->setLocalTransform(mat4::rot_y(angle));
+  };
+  auto moveSome = [&](std::vector<node_ptr> const &nodes) {
+    angle += 0.01f;
+    for (size_t i = 0; i < nodes.size(); i += 100)
+      nodes[i]->setLocalTransform(nodes[i]->getLocalTransform() *
+                                  mat4::rot_y(angle));
+  };
+
+  std::string const prefix = std::string(name) + ", ";
+  double base = bench::nsPerItem(
+      [&] {
+        moveRoot(rec);
+        rec->updateGlobalTransform(mat4());
+      },
+      NUM_NODES);
+  bench::report((prefix + "all moved, recursive").c_str(), base);
+  bench::report((prefix + "all moved, store").c_str(),
+                bench::nsPerItem(
+                    [&] {
+                      moveRoot(flat);
+                      store.update();
+                    },
+                    NUM_NODES),
+                base);
+
+  base = bench::nsPerItem(
+      [&] {
+        moveSome(recNodes);
+        rec->updateGlobalTransform(mat4());
+      },
+      NUM_NODES);
+  bench::report((prefix + "1% moved, recursive").c_str(), base);
+  bench::report((prefix + "1% moved, store").c_str(),
+                bench::nsPerItem(
+                    [&] {
+                      moveSome(flatNodes);
+                      store.update();
+                    },
+                    NUM_NODES),
+                base);
+}
+
+// Times culling boxes scattered over a large area, seen from the middle
+// of it, with the BVH and by testing every node as done before it. The
+// moving nodes are refitted each frame from the log of the store.
+static void runCull(int numMoving) {
+  std::mt19937 rng(1);
+  std::uniform_real_distribution<float> u(-500.0f, 500.0f);
+  std::vector<vertex> vertices(2);
+  vertices[0].pos = vec3(-1.0f, -1.0f, -1.0f);
+  vertices[1].pos = vec3(1.0f, 1.0f, 1.0f);
+  mesh_ptr mesh = std::make_shared<MeshStd>(vertices,
+                                            std::vector<uint32_t>{}, nullptr);
+
+  node_ptr root = std::make_shared<Node>("root");
+  std::vector<node_ptr> nodes;
+  for (int i = 0; i < NUM_CULLED_NODES; i++) {
+    node_ptr node = std::make_shared<Node>(mesh);
+    node->setLocalPosition(vec3(u(rng), u(rng) * 0.05f, u(rng)));
+    nodes.push_back(root->addChild(node));
+  }
+
+  TransformStore store;
+  store.build(root);
+  store.update();
+  BVH bvh;
+  bvh.build(nodes);
+  bvh.refit(store);
+
+  mat4 const view = mat4::rot_y(0.5f).invert();
+  Frustum const frustum(mat4::project(16.0f / 9.0f, 60.0f, 0.1f, 1000.0f) *
+                        view);
+
+  float step = 0.0f;
+  auto move = [&] {
+    step = -step + 0.5f;
+    for (int i = 0; i < numMoving; i++) {
+      node_ptr const &node = nodes[i * (NUM_CULLED_NODES / numMoving)];
+      node->setLocalPosition(node->getLocalPosition() + vec3(step));
+    }
+    store.update();
+  };
+
+  std::vector<uint32_t> visible, bvhVisible;
+  auto linearCull = [&] {
+    visible.clear();
+    for (uint32_t i = 0; i < nodes.size(); i++) {
+      if (!nodes[i]->isCulled(frustum))
+        visible.push_back(i);
+    }
+  };
+  auto bvhCull = [&] {
+    bvhVisible.clear();
+    bvh.refit(store);
+    bvh.cull(frustum, bvhVisible);
+  };
+
+  double const base = bench::nsPerItem(
+      [&] {
+        move();
+        linearCull();
+        bench::keep(visible);
+      },
+      1e6);
+  double const ms = bench::nsPerItem(
+      [&] {
+        move();
+        bvhCull();
+        bench::keep(bvhVisible);
+      },
+      1e6);
+
+  linearCull();
+  std::sort(bvhVisible.begin(), bvhVisible.end());
+  if (bvhVisible != visible)
+    std::printf("BVH found %zu visible nodes instead of %zu\n",
+                bvhVisible.size(), visible.size());
+
+  std::string const prefix = std::to_string(numMoving) + " moving, ";
+  bench::reportMs((prefix + "linear cull").c_str(), base);
+  bench::reportMs((prefix + "BVH refit and cull").c_str(), ms, base);
+}
+
+// Times the frustum tests per box: transforming the eight corners to clip
+// space, Frustum::isVisible and Frustum::testBoxes. src/tests/frustum.cpp
+// checks that they agree.
+static void runBoxes() {
+  std::mt19937 rng(1);
+  std::uniform_real_distribution<float> u(-500.0f, 500.0f);
+  std::vector<float> cx(NUM_CULLED_NODES), cy(NUM_CULLED_NODES),
+      cz(NUM_CULLED_NODES), ex(NUM_CULLED_NODES), ey(NUM_CULLED_NODES),
+      ez(NUM_CULLED_NODES);
+  for (int i = 0; i < NUM_CULLED_NODES; i++) {
+    cx[i] = u(rng), cy[i] = u(rng) * 0.05f, cz[i] = u(rng);
+    ex[i] = ey[i] = ez[i] = 1.0f;
+  }
+
+  mat4 const projView = mat4::project(16.0f / 9.0f, 60.0f, 0.1f, 1000.0f) *
+                        mat4::rot_y(0.5f).invert();
+  Frustum const frustum(projView);
+  std::vector<uint8_t> visible(NUM_CULLED_NODES);
+
+  auto corners = [&] {
+    for (int i = 0; i < NUM_CULLED_NODES; i++) {
+      vec4 clip[8];
+      for (int j = 0; j < 8; j++)
+        clip[j] = projView * vec3(cx[i] + ((j & 1) ? ex[i] : -ex[i]),
+                                  cy[i] + ((j & 2) ? ey[i] : -ey[i]),
+                                  cz[i] + ((j & 4) ? ez[i] : -ez[i]));
+      int outside = 0x3f;
+      for (vec4 const &c : clip) {
+        float const w = c.d[3];
+        outside &= (c.d[0] < -w) | (c.d[0] > w) << 1 | (c.d[1] < -w) << 2 |
+                   (c.d[1] > w) << 3 | (c.d[2] < 0.0f) << 4 | (c.d[2] > w) << 5;
+      }
+      visible[i] = outside == 0;
+    }
+    bench::keep(visible);
+  };
+  auto single = [&] {
+    for (int i = 0; i < NUM_CULLED_NODES; i++)
+      visible[i] = frustum.isVisible(vec3(cx[i], cy[i], cz[i]),
+                                     vec3(ex[i], ey[i], ez[i]));
+    bench::keep(visible);
+  };
+  auto batch = [&] {
+    frustum.testBoxes(cx.data(), cy.data(), cz.data(), ex.data(), ey.data(),
+                      ez.data(), NUM_CULLED_NODES, visible.data());
+    bench::keep(visible);
+  };
+
+  double const base = bench::nsPerItem(corners, NUM_CULLED_NODES);
+  double const ns = bench::nsPerItem(single, NUM_CULLED_NODES);
+  double const batchNs = bench::nsPerItem(batch, NUM_CULLED_NODES);
+  bench::report("8 corners in clip space", base);
+  bench::report("Frustum::isVisible", ns, base);
+  bench::report("Frustum::testBoxes", batchNs, base);
+}
+
+int main() {
+  std::printf("%d nodes, time per node\n", NUM_NODES);
+  run("deep", [] { return deepHierarchy(64, NUM_NODES / 64); });
+  run("wide", [] { return wideHierarchy(NUM_NODES); });
+
+  std::printf("\n%d nodes, time per frame\n", NUM_CULLED_NODES);
+  runCull(1);
+  runCull(1000);
+
+  std::printf("\n%d boxes, time per box\n", NUM_CULLED_NODES);
+  runBoxes();
+  return 0;
+}
@@ -21,11 +21,14 @@
  */
 #include "appbase.h"
 #include "core/dispatcher_instance.h"
+#include "core/parallel.h"
+#include "core/memusage.h"
 #include "gfx/vlk/renderer.h"
 #include "loader/gltf.h"
 #include "math/geometry.h"
 #include "sg/empty.h"
 #include "sg/light.h"
+#include "sg/texture_cache.h"
 
 #include <functional>
 #include <iostream>
@@ -40,10 +43,39 @@ bool AppBase::fullscreen = false;
 bool AppBase::borderless = false;
 bool AppBase::grabMouse = true;
 bool AppBase::doPrintFPS = false;
+size_t AppBase::textureBudget = 0;
+bool AppBase::offscreen = false;
+std::string AppBase::saveFrameFile;
+std::string AppBase::benchmarkFile;
+int AppBase::benchmarkFrames = 1000;
+bool AppBase::profileMaterials = false;
+size_t AppBase::recordThreads = 0;
+bool AppBase::bindless = false;
+
+// Frames rendered after staging before a frame is saved, so that the
+// textures have settled within the budget.
+static const int SAVE_AFTER_FRAMES = 10;
+
+// Frames rendered after staging before a benchmark starts.
+static const int BENCHMARK_WARMUP_FRAMES = 30;
+
+// Time step of a benchmark frame in seconds.
+static const float BENCHMARK_TIME_STEP = 1.0f / 60.0f;
+
+// Returns the milliseconds elapsed since start.
+static float msSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<float, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
 
 AppBase::AppBase(int reqWidth, int reqHeight) {
   auto vlkRenderer = std::make_unique<vlk::RendererVlk>(
-      reqWidth, reqHeight, fullscreen, borderless, grabMouse);
+      reqWidth, reqHeight, fullscreen, borderless, grabMouse, offscreen,
+      bindless);
+  vlkRenderer->setTextureBudget(textureBudget);
+  vlkRenderer->setRecordThreads(recordThreads);
+  vlkRenderer->setTransformStore(&transforms);
   setupInput();
   renderer = std::move(vlkRenderer);
 }
@@ -51,7 +83,7 @@ AppBase::AppBase(int reqWidth, int reqHeight) {
 AppBase::~AppBase() {
   std::this_thread::sleep_for(100ms);
   renderer->flush();
-  Texture::clearCache();
+  getTextureCache().clear();
 
   destroyQueueDispatcher();
   destroyDispatcher();
@@ -74,38 +106,89 @@ node_ptr AppBase::stageAllAndCollect(node_ptr root) {
   std::scoped_lock lock(new_root->mutex(), visuals_mux);
   new_root->collectStaged(&visuals);
 
-  sortNodes(visuals);
+  // Skyboxes follow the camera, so they would be refitted every frame, and
+  // they are always drawn.
+  std::vector<uint32_t> bounded;
+  unbounded.clear();
+  for (uint32_t i = 0; i < visuals.size(); i++) {
+    if (visuals[i]->getName() == "skybox")
+      unbounded.push_back(i);
+    else
+      bounded.push_back(i);
+  }
+  std::shared_lock tlock(transforms.mutex());
+  bvh.build(visuals, bounded);
+  staged = true;
   return new_root;
 }
 
-void AppBase::sortNodes(std::vector<node_ptr> &visuals) {
-  // Move any skybox to the end of the list
-  std::sort(visuals.begin(), visuals.end(),
-            [](node_ptr const &a, node_ptr const &b) {
-              bool a_skybox = a->getName() == "skybox";
-              bool b_skybox = b->getName() == "skybox";
-              if (!a_skybox && b_skybox) {
-                return true;
-              }
-              return false;
-            });
-}
-
 void AppBase::updateAll(node_ptr root) {
   Renderer *rend = renderer.get();
   root->forEach([rend](node_ptr child) { child->update(rend); }, true);
-  root->updateGlobalTransform(mat4());
+
+  // Skip the update while the hierarchy is being changed, e.g. staged.
+  std::unique_lock lock(root->mutex(), std::try_to_lock);
+  if (!lock.owns_lock())
+    return;
+
+  if (!transforms.isValid() || transforms.getRoot() != root.get())
+    transforms.build(root);
+  transforms.update();
 }
 
 void AppBase::cull(std::vector<node_ptr> const &src,
                    std::vector<node_ptr> &out) {
-  mat4 const &viewProj = renderer->getProjectionView();
+  Frustum const frustum(renderer->getProjectionView());
+
+  // The main thread updates the transforms while the frame is culled.
+  std::shared_lock lock(transforms.mutex());
+  bvh.refit(transforms);
+  cullIndices.clear();
+  bvh.cull(frustum, cullIndices);
+  cullIndices.insert(cullIndices.end(), unbounded.begin(), unbounded.end());
+
+  // Keep the order of src.
+  std::sort(cullIndices.begin(), cullIndices.end());
+  for (uint32_t i : cullIndices) {
+    if (src[i]->isVisible())
+      out.push_back(src[i]);
+  }
+}
 
-  for (auto &v : src) {
-    if (v->isVisible() && !v->isCulled(viewProj)) {
-      out.push_back(v);
-    }
+AABB AppBase::getSceneBounds() {
+  std::scoped_lock lock(visuals_mux);
+  std::shared_lock tlock(transforms.mutex());
+  AABB bounds;
+  bool first = true;
+  for (node_ptr const &node : visuals) {
+    if (node->getName() == "skybox")
+      continue;
+
+    AABB const box = node->getWorldAABB();
+    if (first)
+      bounds = box;
+    else
+      bounds.extend(box);
+    first = false;
   }
+  return bounds;
+}
+
+void AppBase::finishBenchmark(int frames) {
+  renderer->setRecordTimings(false);
+  for (FrameTimings const &t : renderer->takeFrameTimings())
+    benchmark.add(t);
+
+  ivec2 const &size = renderer->getViewSize();
+  benchmark.setInfo("frames", frames);
+  benchmark.setInfo("timeStep", BENCHMARK_TIME_STEP);
+  benchmark.setInfo("width", size.width());
+  benchmark.setInfo("height", size.height());
+  benchmark.setInfo("offscreen", offscreen ? "yes" : "no");
+  benchmark.setInfo("recordThreads",
+                    recordThreads > 0 ? recordThreads : parallelism());
+  benchmark.write(benchmarkFile);
+  std::cout << "Benchmark results written to " << benchmarkFile << "\n";
 }
 
 void AppBase::run() {
@@ -128,6 +211,11 @@ void AppBase::run() {
   float fps_prev = 0.0f;
 
   const size_t RUNNING_FRAMES = 5;
+  int stagedFrames = 0;
+
+  // Frames of the benchmark rendered so far, -1 before it has started.
+  int benchFrame = -1;
+  auto benchPrev = start;
 
   GatedDispatcher<bool> dispatcher;
   std::condition_variable cv;
@@ -139,24 +227,45 @@ void AppBase::run() {
     std::chrono::steady_clock::time_point now =
         std::chrono::steady_clock::now();
     std::chrono::duration<float, std::milli> elapsed_dur = now - start;
-    float elapsed = elapsed_dur.count() / 1000.0f;
+    float const wallTime = elapsed_dur.count() / 1000.0f;
+
+    // Benchmarks advance by a fixed step per frame, so that every run
+    // renders the same views.
+    float elapsed = wallTime;
+    if (isBenchmarking())
+      elapsed = std::max(benchFrame, 0) * BENCHMARK_TIME_STEP;
 
     float delta = elapsed - update_prev;
     update_prev = elapsed;
 
+    bool const timed = benchFrame >= 0;
     update(elapsed, delta);
+    if (timed)
+      benchmark.add("update", msSince(now));
 
     if (do_paint) {
-      if (s.try_acquire()) {
+      // Benchmark frames wait for a free frame, one frame per update.
+      bool acquired = s.try_acquire();
+      if (!acquired && timed) {
+        s.acquire();
+        acquired = true;
+      }
+
+      if (acquired) {
+        if (staged)
+          stagedFrames++;
 
         dispatcher.add(
-            [this, &s, &cv]() {
+            [this, &s, &cv, timed]() {
               {
                 std::vector<node_ptr> visible;
                 {
                   std::scoped_lock lock(visuals_mux);
                   frames++;
+                  auto const cullStart = std::chrono::steady_clock::now();
                   cull(visuals, visible);
+                  if (timed)
+                    benchmark.add("cull", msSince(cullStart));
                 }
                 renderer->render(visible);
               }
@@ -164,17 +273,62 @@ void AppBase::run() {
               s.release();
             },
             true, "paint");
+
+        if (timed) {
+          benchmark.add("frame", msSince(benchPrev));
+          benchPrev = std::chrono::steady_clock::now();
+          benchFrame++;
+        }
       } else {
         std::this_thread::sleep_for(5ms);
       }
     }
 
-    if (elapsed - fps_prev > 1.0f) {
-      int fps = frames / (elapsed - fps_prev);
+    if (isBenchmarking() && benchFrame < 0 &&
+        stagedFrames >= BENCHMARK_WARMUP_FRAMES) {
+      std::cout << "Benchmark started\n";
+      renderer->setProfileMaterials(profileMaterials);
+      renderer->setRecordTimings(true);
+      benchFrame = 0;
+      benchPrev = std::chrono::steady_clock::now();
+    }
+
+    bool const benchDone = benchFrame >= benchmarkFrames;
+    bool const saveDone = !isBenchmarking() && !saveFrameFile.empty() &&
+                          stagedFrames >= SAVE_AFTER_FRAMES;
+    if (benchDone || saveDone) {
+      // Wait for the frames in progress.
+      for (size_t i = 0; i < RUNNING_FRAMES; i++)
+        s.acquire();
+
+      if (benchDone)
+        finishBenchmark(benchFrame);
+
+      if (!saveFrameFile.empty()) {
+        renderer->saveFrame(saveFrameFile);
+        std::cout << "Frame saved to " << saveFrameFile << "\n";
+      }
+      running = false;
+    }
+
+    if (wallTime - fps_prev > 1.0f) {
+      int fps = frames / (wallTime - fps_prev);
       frames = 0;
-      fps_prev = elapsed;
-      if (doPrintFPS)
-        std::cout << "FPS: " << fps << "\n";
+      fps_prev = wallTime;
+      if (doPrintFPS) {
+        TextureStats const ts = renderer->getTextureStats();
+        DrawStats const ds = renderer->getDrawStats();
+        std::cout << "FPS: " << fps << ", draws: " << ds.draws
+                  << " (instances " << ds.instances << ", pipelines "
+                  << ds.pipelineSwaps << ", materials " << ds.materialSwaps
+                  << "), textures: " << ts.numTextures
+                  << ", " << (ts.deviceBytes >> 20) << " MB";
+        if (ts.budget > 0)
+          std::cout << " / " << (ts.budget >> 20) << " MB budget, "
+                    << ts.numReduced << " reduced";
+        std::cout << ", RSS " << (currentRSS() >> 20) << " MB (peak "
+                  << (peakRSS() >> 20) << " MB)\n";
+      }
     }
   }
 }
@@ -22,12 +22,18 @@
 #ifndef _CST_LIB_APP_APP_H
 #define _CST_LIB_APP_APP_H
 
+#include "benchmark.h"
 #include "core/dispatcher.h"
 #include "gfx/renderer.h"
 #include "gfx/shader_data.h"
 #include "input/events.h"
+#include "sg/bvh.h"
 #include "sg/node.h"
 #include "sg/scene.h"
+#include "sg/transform_store.h"
+
+#include <atomic>
+#include <string>
 
 namespace cst {
 
@@ -37,7 +43,8 @@ public:
   ~AppBase();
 
   // Calls update(Renderer *) for root and all its child nodes recursively.
-  // After this it calls root->updateGlobalTransform(mat4());
+  // After this it updates the global transforms of the nodes that have moved,
+  // rebuilding the transform store if the hierarchy has changed.
   void updateAll(node_ptr root);
 
   // Stage root and all nodes under it. Returns the new staged root.
@@ -58,15 +65,40 @@ public:
   static bool borderless;
   static bool grabMouse;
   static bool doPrintFPS;
+  static size_t textureBudget; // bytes, 0 for unlimited
+  static bool offscreen;       // render without a window
+  static std::string saveFrameFile; // save a frame here and quit
+  static std::string benchmarkFile; // run a benchmark, write results here
+  static int benchmarkFrames;       // frames rendered by a benchmark
+  static bool profileMaterials;     // time materials on the GPU in benchmarks
+  static size_t recordThreads; // threads recording commands, 0 for all
+  static bool bindless;        // use bindless materials when supported
+
+protected:
+  // Returns true once the scene has been staged.
+  bool isStaged() const { return staged; }
+
+  // Returns true if running a benchmark. The elapsed time passed to
+  // update() then advances by a fixed step per frame.
+  bool isBenchmarking() const { return !benchmarkFile.empty(); }
+
+  // Returns the world space bounds of the staged visual nodes, excluding
+  // skyboxes.
+  AABB getSceneBounds();
+
+  // Results of the benchmark, see benchmarkFile.
+  Benchmark benchmark;
+
 private:
   void setupInput();
 
-  // Sort a list of rendederable nodes.
-  // Currently skyboxes are moved to the back of the list.
-  void sortNodes(std::vector<node_ptr> &visuals);
-
+  // Collects the visible nodes of src inside the view frustum into out.
+  // src must be the visuals the BVH was built from.
   void cull(std::vector<node_ptr> const &src, std::vector<node_ptr> &out);
 
+  // Collects the timings of the renderer and writes the benchmark results.
+  void finishBenchmark(int frames);
+
   virtual void keyDown(SDL_Keycode key) = 0;
   virtual void keyUp(SDL_Keycode key) = 0;
   virtual void mouseMove(int mx, int my) = 0;
@@ -76,9 +108,20 @@ private:
 
   bool running = true;
   int frames = 0;
+  std::atomic<bool> staged = false;
+
+  // Transforms of the hierarchy passed to updateAll(). Declared before the
+  // nodes below, so it outlives them.
+  TransformStore transforms;
 
   std::mutex visuals_mux;
   std::vector<node_ptr> visuals;
+
+  // Hierarchy over visuals for culling and the culling results, kept
+  // between frames. Guarded by visuals_mux.
+  BVH bvh;
+  std::vector<uint32_t> cullIndices;
+  std::vector<uint32_t> unbounded; // visuals not in bvh, never culled
 };
 
 } // namespace cst
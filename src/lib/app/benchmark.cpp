@@ -0,0 +1,159 @@
+/*
+ Copyright (c) 2022 Tero Oinas
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+#include "benchmark.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+using namespace cst;
+
+// Percentiles written for each stage.
+static const int PERCENTILES[] = {50, 90, 95, 99};
+
+static std::string quote(std::string const &str) {
+  std::string out = "\"";
+  for (char c : str) {
+    if (c == '"' || c == '\\')
+      out += '\\';
+    if ((unsigned char)c < 0x20)
+      c = ' ';
+    out += c;
+  }
+  return out + "\"";
+}
+
+// Returns the nearest-rank percentile p of sorted samples.
+static double percentile(std::vector<double> const &sorted, int p) {
+  size_t rank = size_t(std::ceil(p / 100.0 * sorted.size()));
+  return sorted[std::clamp(rank, size_t(1), sorted.size()) - 1];
+}
+
+void Benchmark::add(std::vector<Series> &series, std::string const &name,
+                    double value) {
+  auto it = std::find_if(series.begin(), series.end(),
+                         [&name](Series const &s) { return s.name == name; });
+  if (it == series.end())
+    it = series.insert(series.end(), Series{name, {}});
+  it->samples.push_back(value);
+}
+
+void Benchmark::write(std::ostream &out, std::vector<Series> const &series) {
+  for (size_t i = 0; i < series.size(); i++) {
+    std::vector<double> sorted = series[i].samples;
+    std::sort(sorted.begin(), sorted.end());
+
+    double sum = 0.0;
+    for (double v : sorted)
+      sum += v;
+
+    out << (i > 0 ? "," : "") << "\n    " << quote(series[i].name)
+        << ": {\"samples\": " << sorted.size()
+        << ", \"mean\": " << sum / sorted.size()
+        << ", \"min\": " << sorted.front();
+    for (int p : PERCENTILES)
+      out << ", \"p" << p << "\": " << percentile(sorted, p);
+    out << ", \"max\": " << sorted.back() << "}";
+  }
+}
+
+void Benchmark::add(std::string const &stage, float ms) {
+  std::scoped_lock lock(mux);
+  add(stages, stage, ms);
+}
+
+void Benchmark::addCount(std::string const &counter, double value) {
+  std::scoped_lock lock(mux);
+  add(counters, counter, value);
+}
+
+void Benchmark::add(FrameTimings const &t) {
+  std::pair<char const *, float> const times[] = {
+      {"buildCommands", t.buildCommands},
+      {"submit", t.submit},
+      {"presentWait", t.presentWait},
+      {"gpu", t.gpu}};
+
+  for (auto [stage, ms] : times) {
+    if (ms >= 0.0f)
+      add(stage, ms);
+  }
+
+  std::pair<char const *, int> const draws[] = {
+      {"draws", t.draws.draws},
+      {"instances", t.draws.instances},
+      {"pipelineSwaps", t.draws.pipelineSwaps},
+      {"materialSwaps", t.draws.materialSwaps}};
+
+  for (auto [counter, value] : draws)
+    addCount(counter, value);
+
+  for (GpuScopeTimings const &g : t.gpuScopes) {
+    add("gpu " + g.name, g.ms);
+
+    std::pair<char const *, int64_t> const counts[] = {
+        {"vertices", g.vertices},
+        {"primitives", g.primitives},
+        {"vertexShaders", g.vertexShaders},
+        {"clippedPrimitives", g.clippedPrimitives},
+        {"fragmentShaders", g.fragmentShaders}};
+
+    for (auto [counter, value] : counts) {
+      if (value >= 0)
+        addCount(g.name + " " + counter, value);
+    }
+  }
+}
+
+void Benchmark::setInfo(std::string const &key, std::string const &value) {
+  std::scoped_lock lock(mux);
+  info.emplace_back(key, quote(value));
+}
+
+void Benchmark::setInfo(std::string const &key, double value) {
+  std::ostringstream os;
+  os << value;
+  std::scoped_lock lock(mux);
+  info.emplace_back(key, os.str());
+}
+
+void Benchmark::write(std::string const &filename) const {
+  std::ofstream out(filename);
+  if (!out)
+    throw std::runtime_error("failed to create " + filename);
+
+  std::scoped_lock lock(mux);
+  out << "{\n  \"info\": {";
+  for (size_t i = 0; i < info.size(); i++)
+    out << (i > 0 ? "," : "") << "\n    " << quote(info[i].first) << ": "
+        << info[i].second;
+  out << "\n  },\n  \"stages\": {";
+  write(out, stages);
+  out << "\n  },\n  \"counters\": {";
+  write(out, counters);
+  out << "\n  }\n}\n";
+
+  if (!out)
+    throw std::runtime_error("failed to write " + filename);
+}
@@ -0,0 +1,80 @@
+/*
+ Copyright (c) 2022 Tero Oinas
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+#ifndef _CST_LIB_APP_BENCHMARK_H
+#define _CST_LIB_APP_BENCHMARK_H
+
+#include "gfx/renderer.h"
+
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace cst {
+
+/**
+ * Benchmark collects the times spent on the stages of each frame, and
+ * counters such as pipeline statistics, and writes their distributions
+ * (mean and percentiles) into a JSON file, so that runs can be compared
+ * across builds.
+ */
+class Benchmark {
+public:
+  // Adds the time of a stage of one frame in milliseconds. The stages are
+  // written in the order they were first added. Thread safe.
+  void add(std::string const &stage, float ms);
+
+  // Adds a value of a counter of one frame. Thread safe.
+  void addCount(std::string const &counter, double value);
+
+  // Adds the measured times of a frame reported by the renderer. GPU
+  // scopes are added as "gpu " + name stages, their pipeline statistics
+  // as counters.
+  void add(FrameTimings const &t);
+
+  // Sets a value describing the run, e.g. the name of the model.
+  void setInfo(std::string const &key, std::string const &value);
+  void setInfo(std::string const &key, double value);
+
+  // Writes the results. Throws std::runtime_error on failure.
+  void write(std::string const &filename) const;
+
+private:
+  struct Series {
+    std::string name;
+    std::vector<double> samples;
+  };
+
+  static void add(std::vector<Series> &series, std::string const &name,
+                  double value);
+  static void write(std::ostream &out, std::vector<Series> const &series);
+
+  mutable std::mutex mux;
+  std::vector<Series> stages;   // milliseconds
+  std::vector<Series> counters;
+  std::vector<std::pair<std::string, std::string>> info; // JSON values
+};
+
+} // namespace cst
+
+#endif // _CST_LIB_APP_BENCHMARK_H
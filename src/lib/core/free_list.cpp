@@ -0,0 +1,80 @@
+/*
+ Copyright (c) 2022 Tero Oinas
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+#include "free_list.h"
+
+#include <cassert>
+
+using namespace cst;
+
+FreeList::FreeList(uint64_t capacity) : capacity(capacity), numFree(capacity) {
+  if (capacity > 0)
+    ranges[0] = capacity;
+}
+
+int64_t FreeList::alloc(uint64_t count) {
+  if (count == 0)
+    return 0;
+
+  for (auto it = ranges.begin(); it != ranges.end(); it++) {
+    if (it->second < count)
+      continue;
+
+    uint64_t offset = it->first;
+    uint64_t rest = it->second - count;
+    ranges.erase(it);
+    if (rest > 0)
+      ranges[offset + count] = rest;
+
+    numFree -= count;
+    return offset;
+  }
+  return -1;
+}
+
+void FreeList::release(uint64_t offset, uint64_t count) {
+  if (count == 0)
+    return;
+  assert(offset + count <= capacity);
+  numFree += count;
+
+  auto next = ranges.lower_bound(offset);
+  assert(next == ranges.end() || next->first >= offset + count);
+
+  // Merge with the free range ending at offset.
+  if (next != ranges.begin()) {
+    auto prev = std::prev(next);
+    assert(prev->first + prev->second <= offset);
+    if (prev->first + prev->second == offset) {
+      offset = prev->first;
+      count += prev->second;
+      ranges.erase(prev);
+    }
+  }
+
+  // Merge with the free range starting at the end of the range.
+  if (next != ranges.end() && next->first == offset + count) {
+    count += next->second;
+    ranges.erase(next);
+  }
+
+  ranges[offset] = count;
+}
@@ -0,0 +1,60 @@
+/*
+ Copyright (c) 2022 Tero Oinas
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+#ifndef _CST_LIB_CORE_FREE_LIST_H
+#define _CST_LIB_CORE_FREE_LIST_H
+
+#include <cstdint>
+#include <map>
+
+namespace cst {
+
+/**
+ * FreeList suballocates ranges of a space of a fixed number of units, e.g.
+ * elements of a buffer. Ranges are taken first fit from the lowest offset,
+ * and a released range is merged with its free neighbours so that the
+ * space does not fragment into small pieces. Not thread safe.
+ */
+class FreeList {
+public:
+  FreeList(uint64_t capacity);
+
+  // Returns the offset of count free units or -1 if no free range is large
+  // enough. A range of 0 units is at offset 0 and needs no release.
+  int64_t alloc(uint64_t count);
+
+  // Returns the range [offset, offset + count) from alloc() to the space.
+  void release(uint64_t offset, uint64_t count);
+
+  uint64_t getCapacity() const { return capacity; }
+
+  // Returns the number of free units, possibly in several ranges.
+  uint64_t getFree() const { return numFree; }
+
+private:
+  uint64_t capacity;
+  uint64_t numFree;
+  std::map<uint64_t, uint64_t> ranges; // offset -> size of free ranges
+};
+
+} // namespace cst
+
+#endif // _CST_LIB_CORE_FREE_LIST_H
@@ -0,0 +1,163 @@
+/*
+ Copyright (c) 2022 Tero Oinas
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+#include "parallel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace cst;
+
+/**
+ * ThreadPool keeps a set of worker threads sleeping until a parallelFor
+ * job is published. Each job is split into tasks that are claimed by
+ * the workers and the calling thread through an atomic counter.
+ */
+class ThreadPool {
+public:
+  ThreadPool(size_t numThreads) {
+    for (size_t i = 0; i < numThreads; i++)
+      threads.emplace_back(&ThreadPool::run, this);
+  }
+
+  ~ThreadPool() {
+    {
+      std::scoped_lock lock(mux);
+      quit = true;
+    }
+    jobCV.notify_all();
+    for (auto &t : threads)
+      t.join();
+  }
+
+  size_t size() const { return threads.size() + 1; }
+
+  // Runs the job or returns false if the pool is in use.
+  bool tryRun(size_t n, size_t numTasks, range_fn const &f) {
+    std::unique_lock callLock(callMux, std::try_to_lock);
+    if (!callLock.owns_lock())
+      return false;
+
+    {
+      std::scoped_lock lock(mux);
+      fn = &f;
+      numItems = n;
+      this->numTasks = numTasks;
+      nextTask = 0;
+      running = threads.size();
+      error = nullptr;
+      generation++;
+    }
+    jobCV.notify_all();
+
+    work();
+
+    std::unique_lock lock(mux);
+    doneCV.wait(lock, [this] { return running == 0; });
+    fn = nullptr;
+
+    if (error)
+      std::rethrow_exception(error);
+    return true;
+  }
+
+private:
+  // Claims and processes tasks until none are left.
+  void work() {
+    for (;;) {
+      size_t task = nextTask.fetch_add(1);
+      if (task >= numTasks)
+        break;
+
+      size_t begin = numItems * task / numTasks;
+      size_t end = numItems * (task + 1) / numTasks;
+      try {
+        (*fn)(begin, end, task);
+      } catch (...) {
+        std::scoped_lock lock(mux);
+        if (!error)
+          error = std::current_exception();
+      }
+    }
+  }
+
+  void run() {
+    uint64_t seen = 0;
+    for (;;) {
+      {
+        std::unique_lock lock(mux);
+        jobCV.wait(lock, [&] { return quit || generation != seen; });
+        if (quit)
+          return;
+        seen = generation;
+      }
+
+      work();
+
+      std::scoped_lock lock(mux);
+      if (--running == 0)
+        doneCV.notify_all();
+    }
+  }
+
+  std::vector<std::thread> threads;
+  std::mutex callMux, mux;
+  std::condition_variable jobCV, doneCV;
+
+  range_fn const *fn = nullptr;
+  size_t numItems = 0, numTasks = 0, running = 0;
+  std::atomic<size_t> nextTask = 0;
+  std::exception_ptr error;
+  uint64_t generation = 0;
+  bool quit = false;
+};
+
+static ThreadPool &getPool() {
+  static ThreadPool pool(std::max(1u, std::thread::hardware_concurrency()) -
+                         1);
+  return pool;
+}
+
+size_t cst::parallelism() { return getPool().size(); }
+
+size_t cst::parallelTasks(size_t n, size_t minPerTask) {
+  size_t tasks = n / std::max<size_t>(minPerTask, 1);
+  return std::clamp<size_t>(tasks, 1, parallelism());
+}
+
+void cst::parallelFor(size_t n, size_t minPerTask, range_fn const &f) {
+  if (n == 0)
+    return;
+
+  size_t numTasks = parallelTasks(n, minPerTask);
+  if (numTasks > 1 && getPool().tryRun(n, numTasks, f))
+    return;
+
+  // Serial fallback keeps the same task split so that callers using
+  // per-task scratch data see identical ranges.
+  for (size_t task = 0; task < numTasks; task++)
+    f(n * task / numTasks, n * (task + 1) / numTasks, task);
+}
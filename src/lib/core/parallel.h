@@ -0,0 +1,52 @@
+/*
+ Copyright (c) 2022 Tero Oinas
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+#ifndef _CST_LIB_CORE_PARALLEL_H
+#define _CST_LIB_CORE_PARALLEL_H
+
+#include <cstddef>
+#include <functional>
+
+namespace cst {
+
+// Function run by parallelFor for the range [begin, end). The task index is
+// in [0, number of tasks) and can be used to select per-task scratch data.
+typedef std::function<void(size_t begin, size_t end, size_t task)> range_fn;
+
+// Returns the number of threads parallelFor may use, including the caller.
+size_t parallelism();
+
+// Returns the number of tasks parallelFor will split n items into when each
+// task should get at least minPerTask items.
+size_t parallelTasks(size_t n, size_t minPerTask);
+
+/**
+ * Splits [0, n) into parallelTasks(n, minPerTask) contiguous ranges and runs
+ * f on each of them using a persistent pool of worker threads. The calling
+ * thread takes part in the work and the function returns when all ranges
+ * have been processed. If the pool is already busy (nested or concurrent
+ * use) the ranges are run on the calling thread.
+ */
+void parallelFor(size_t n, size_t minPerTask, range_fn const &f);
+
+} // namespace cst
+
+#endif // _CST_LIB_CORE_PARALLEL_H
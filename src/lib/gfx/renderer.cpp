@@ -44,6 +44,11 @@ void cst::setRenderer(Renderer *renderer) {
 node_ptr cst::stageAll(node_ptr root, renderer_ptr renderer) {
   Renderer *rend = renderer.get();
 
+  {
+    std::scoped_lock lock(root->mutex());
+    rend->stageMeshes(root);
+  }
+
   root->mapChildren([rend](node_ptr child) {
     return rend->stage(child);
   });
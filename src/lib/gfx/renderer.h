@@ -30,6 +30,57 @@
 
 namespace cst {
 
+// Memory used by staged textures.
+struct TextureStats {
+  size_t budget = 0;      // device memory budget, 0 if unlimited
+  size_t deviceBytes = 0; // device memory used
+  int numTextures = 0;
+  int numReduced = 0; // textures that have dropped mip levels
+  int numDropped = 0; // mip levels dropped in total
+};
+
+// Draws recorded for a frame and the state changes between them.
+struct DrawStats {
+  int draws = 0;         // draw calls
+  int instances = 0;     // meshes drawn by the draw calls
+  int pipelineSwaps = 0; // pipelines bound
+  int materialSwaps = 0; // material descriptor sets bound
+
+  DrawStats &operator+=(DrawStats const &s) {
+    draws += s.draws;
+    instances += s.instances;
+    pipelineSwaps += s.pipelineSwaps;
+    materialSwaps += s.materialSwaps;
+    return *this;
+  }
+};
+
+// GPU time and pipeline statistics of a named part of a frame. The
+// statistics are negative if they were not collected for the scope.
+struct GpuScopeTimings {
+  std::string name;
+  float ms = 0.0f;
+  int64_t vertices = -1;          // input assembly vertices
+  int64_t primitives = -1;        // input assembly primitives
+  int64_t vertexShaders = -1;     // vertex shader invocations
+  int64_t clippedPrimitives = -1; // primitives output by clipping
+  int64_t fragmentShaders = -1;   // fragment shader invocations
+};
+
+// Times spent on one frame in milliseconds, negative if not measured.
+struct FrameTimings {
+  uint64_t frame = 0;
+  float buildCommands = -1.0f; // recording the command buffer
+  float submit = -1.0f;        // submitting it to the queue
+  float presentWait = -1.0f;   // acquiring and presenting the image
+  float gpu = -1.0f;           // executing the commands on the GPU
+  DrawStats draws;
+
+  // Parts of the frame on the GPU, e.g. the render pass. Scopes with the
+  // same name are summed.
+  std::vector<GpuScopeTimings> gpuScopes;
+};
+
 /**
  * Renderer is a base class for all renderers.
  */
@@ -57,6 +108,27 @@ public:
   // NOTE: the node must be locked before calling this function.
   virtual node_ptr stage(node_ptr node) = 0;
 
+  // Stages the meshes of root and its descendants together, so that
+  // stage() finds them staged. Meshes shared by nodes are staged once.
+  // NOTE: root must be locked before calling this function.
+  virtual void stageMeshes(node_ptr root) = 0;
+
+  // Sets the device memory budget for textures in bytes, 0 for unlimited.
+  // Top mip levels of least recently used textures are dropped to stay
+  // within the budget.
+  virtual void setTextureBudget(size_t bytes) = 0;
+
+  // Returns the memory used by staged textures.
+  virtual TextureStats getTextureStats() const = 0;
+
+  // Returns the draws of the last recorded frame.
+  virtual DrawStats getDrawStats() const = 0;
+
+  // Sets the store holding the transforms of the rendered nodes, or
+  // nullptr if they are not in one. The renderer reads the transforms with
+  // the mutex of the store locked shared.
+  virtual void setTransformStore(TransformStore const *store) = 0;
+
   /** Called when the window was resized. */
   virtual void windowResized() = 0;
 
@@ -72,6 +144,24 @@ public:
    */
   virtual void flush() = 0;
 
+  // Starts or stops recording the timings of the rendered frames.
+  virtual void setRecordTimings(bool record) = 0;
+
+  // Times each run of draws with the same material as a GPU scope named
+  // after the material, when recording timings.
+  virtual void setProfileMaterials(bool profile) = 0;
+
+  // Returns the timings recorded since the previous call, in frame order.
+  // GPU times are read a few frames late, so flush() first to get them for
+  // all of the frames.
+  virtual std::vector<FrameTimings> takeFrameTimings() = 0;
+
+  /**
+   * Writes the last rendered frame into a PNG file. Supported only when
+   * rendering offscreen. No frame may be in progress.
+   */
+  virtual void saveFrame(std::string const &filename) = 0;
+
 private:
 };
 
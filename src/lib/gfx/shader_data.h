@@ -26,16 +26,19 @@
 
 #define DESC_SET_GLOBAL 0
 #define DESC_SET_MATERIAL 1
-#define DESC_SET_NODE 2
 
 #define BIND_GLOBAL_UBO 0
+#define BIND_GLOBAL_INSTANCES 1
 #define BIND_MAT_UBO 0
 #define BIND_MAT_ALBEDO_TEXTURE 1
 #define BIND_MAT_ROUGHNESS_TEXTURE 2
 #define BIND_MAT_NORMAL_TEXTURE 3
 #define BIND_MAT_CUBEMAP 4
 
-#define BIND_NODE_UBO 0
+// Bindings of the material set of the bindless path.
+#define BIND_BINDLESS_MATERIALS 0
+#define BIND_BINDLESS_TEXTURES 1
+#define BIND_BINDLESS_CUBEMAPS 2
 
 #define MAX_LIGHTS 8
 
@@ -62,11 +65,21 @@ struct MaterialData {
   alignas(4) float metallic;
   alignas(4) float roughness;
   alignas(4) float ao;
+
+  // Indices of the textures in the arrays of the bindless material set. The
+  // albedo of a cubemap indexes the cubemap array.
+  alignas(4) uint32_t albedoTex;
+  alignas(4) uint32_t roughnessTex;
+  alignas(4) uint32_t normalTex;
 };
 
-// NodeData is in format of the node UBOs.
-struct NodeData {
-  alignas(16) mat4 transform; 
+// The stride of the std430 material array of the bindless shaders.
+static_assert(sizeof(MaterialData) == 64);
+
+// InstanceData is in the format of the elements of the instance storage
+// buffer.
+struct InstanceData {
+  alignas(16) mat4 transform;
 };
 
 } // namespace cst::vlk
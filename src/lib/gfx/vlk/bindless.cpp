@@ -0,0 +1,151 @@
+/*
+ Copyright (c) 2022 Tero Oinas
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+#include "bindless.h"
+
+#include <cassert>
+#include <cstring>
+#include <string>
+
+using namespace cst::vlk;
+using namespace cst;
+
+uint32_t BindlessTable::Slots::alloc(char const *what) {
+  if (!free.empty()) {
+    uint32_t const slot = free.back();
+    free.pop_back();
+    return slot;
+  }
+
+  if (used == capacity)
+    throw std::runtime_error(std::string("too many bindless ") + what);
+  return used++;
+}
+
+BindlessTable::BindlessTable(device_ptr dev, uint32_t maxTextures,
+                             uint32_t maxCubeMaps, uint32_t maxMaterials)
+    : dev(dev), materials{maxMaterials}, textures{maxTextures},
+      cubeMaps{maxCubeMaps} {
+  createLayout();
+
+  pool = std::make_shared<DescPool>(
+      dev, layout, 1, 0, maxTextures + maxCubeMaps, 1,
+      VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT);
+  set = allocSets(1, pool)[0];
+
+  materialBuf =
+      createMappedBuffer(dev, sizeof(MaterialData) * maxMaterials,
+                         VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+  set->bind(BIND_BINDLESS_MATERIALS, materialBuf,
+            VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+}
+
+BindlessTable::~BindlessTable() {}
+
+void BindlessTable::createLayout() {
+  VkDescriptorSetLayoutBinding bindings[3]{};
+  bindings[0].binding = BIND_BINDLESS_MATERIALS;
+  bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  bindings[0].descriptorCount = 1;
+  bindings[0].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+  bindings[1].binding = BIND_BINDLESS_TEXTURES;
+  bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+  bindings[1].descriptorCount = textures.capacity;
+  bindings[1].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+  bindings[2].binding = BIND_BINDLESS_CUBEMAPS;
+  bindings[2].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+  bindings[2].descriptorCount = cubeMaps.capacity;
+  bindings[2].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+  // Texture slots are written while frames sampling other slots run and
+  // are left unwritten until used.
+  VkDescriptorBindingFlags const arrayFlags =
+      VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT |
+      VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+      VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT;
+  VkDescriptorBindingFlags const flags[3] = {0, arrayFlags, arrayFlags};
+
+  VkDescriptorSetLayoutBindingFlagsCreateInfo flagsInfo{};
+  flagsInfo.sType =
+      VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+  flagsInfo.bindingCount = 3;
+  flagsInfo.pBindingFlags = flags;
+
+  VkDescriptorSetLayoutCreateInfo info{};
+  info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  info.pNext = &flagsInfo;
+  info.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+  info.bindingCount = 3;
+  info.pBindings = bindings;
+
+  VkDescriptorSetLayout l;
+  if (vkCreateDescriptorSetLayout(*dev, &info, nullptr, &l) != VK_SUCCESS)
+    throw std::runtime_error(
+        "failed to create bindless descriptor set layout.");
+
+  device_ptr d = dev;
+  layout = std::shared_ptr<VkDescriptorSetLayout>(
+      new VkDescriptorSetLayout(l), [d](VkDescriptorSetLayout *layout) {
+        vkDestroyDescriptorSetLayout(*d, *layout, nullptr);
+        delete layout;
+      });
+}
+
+uint32_t BindlessTable::addMaterial() {
+  std::scoped_lock lock(mux);
+  return materials.alloc("materials");
+}
+
+void BindlessTable::removeMaterial(uint32_t slot) {
+  std::scoped_lock lock(mux);
+  materials.release(slot);
+}
+
+void BindlessTable::writeMaterial(uint32_t slot, MaterialData const &data) {
+  assert(slot < materials.capacity);
+  MaterialData *dst = static_cast<MaterialData *>(materialBuf->getMapped());
+  memcpy(dst + slot, &data, sizeof(MaterialData));
+}
+
+uint32_t BindlessTable::addTexture(texture_ptr tex) {
+  bool const cubeMap = tex->isCubeMap();
+
+  std::scoped_lock lock(mux);
+  uint32_t const slot = cubeMap ? cubeMaps.alloc("cubemaps")
+                                : textures.alloc("textures");
+  set->bindTexture(cubeMap ? BIND_BINDLESS_CUBEMAPS : BIND_BINDLESS_TEXTURES,
+                   tex, slot);
+  return slot;
+}
+
+void BindlessTable::removeTexture(uint32_t slot, bool cubeMap) {
+  std::scoped_lock lock(mux);
+  (cubeMap ? cubeMaps : textures).release(slot);
+}
+
+std::shared_ptr<void> BindlessTable::retireTexture(uint32_t slot,
+                                                   bool cubeMap) {
+  return std::shared_ptr<void>(nullptr, [this, slot, cubeMap](void *) {
+    removeTexture(slot, cubeMap);
+  });
+}
@@ -0,0 +1,100 @@
+/*
+ Copyright (c) 2022 Tero Oinas
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+#ifndef _CST_LIB_GFX_VLK_BINDLESS_H
+#define _CST_LIB_GFX_VLK_BINDLESS_H
+
+#include "gfx/shader_data.h"
+#include "impl/buffer.h"
+#include "impl/descs.h"
+#include "sg/texture.h"
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace cst::vlk {
+
+/**
+ * BindlessTable holds the materials of the bindless path in a single
+ * descriptor set: a storage buffer of MaterialData and arrays of textures
+ * and cubemaps indexed by it. Draws select their material with a push
+ * constant, so the set is bound once per command buffer.
+ */
+class BindlessTable {
+public:
+  BindlessTable(device_ptr dev, uint32_t maxTextures, uint32_t maxCubeMaps,
+                uint32_t maxMaterials);
+  ~BindlessTable();
+
+  desclayout_ptr getLayout() const { return layout; }
+  DescriptorSet const &getSet() const { return *set; }
+
+  // Allocates the slot of a material. Throws if all slots are in use.
+  uint32_t addMaterial();
+
+  // Frees the slot of a material no running frame draws.
+  void removeMaterial(uint32_t slot);
+
+  // Writes the data of the material in a slot.
+  void writeMaterial(uint32_t slot, MaterialData const &data);
+
+  // Writes a staged texture into a free slot of the texture or the cubemap
+  // array and returns the slot. Throws if all slots are in use.
+  uint32_t addTexture(texture_ptr tex);
+
+  // Frees the slot of a texture no running frame samples.
+  void removeTexture(uint32_t slot, bool cubeMap);
+
+  // Returns an object that frees the slot of a texture when released,
+  // e.g. by a DeletionQueue once the frames sampling it have completed.
+  std::shared_ptr<void> retireTexture(uint32_t slot, bool cubeMap);
+
+private:
+  // Slots of an array, freed slots are reused first.
+  struct Slots {
+    uint32_t capacity;
+    uint32_t used = 0;
+    std::vector<uint32_t> free;
+
+    uint32_t alloc(char const *what);
+    void release(uint32_t slot) { free.push_back(slot); }
+  };
+
+  void createLayout();
+
+  device_ptr dev;
+  desclayout_ptr layout;
+  descpool_ptr pool;
+  descset_ptr set;
+  buffer_ptr materialBuf;
+
+  std::mutex mux;
+  Slots materials;
+  Slots textures;
+  Slots cubeMaps;
+};
+
+typedef std::shared_ptr<BindlessTable> bindless_ptr;
+
+} // namespace cst::vlk
+
+#endif // _CST_LIB_GFX_VLK_BINDLESS_H
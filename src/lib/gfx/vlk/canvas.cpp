@@ -36,6 +36,7 @@ Canvas::Canvas(device_ptr dev, ivec2 const &wndSize, bool forceImmediate)
 
 Canvas::~Canvas() {
   swapchain = nullptr;
+  offscreen = nullptr;
 
   for (auto fence : frameFences) {
     vkDestroyFence(*dev, fence, nullptr);
@@ -53,7 +54,22 @@ void Canvas::waitFences() const {
                   UINT64_MAX);
 }
 
+void Canvas::waitFrame(int frame) const {
+  vkWaitForFences(*dev, 1, &frameFences[frame % runningFrames], VK_TRUE,
+                  UINT64_MAX);
+}
+
 void Canvas::resized(VkSurfaceKHR surface, ivec2 const &newSize) {
+  if (surface == VK_NULL_HANDLE) {
+    if (offscreen == nullptr || newSize != wndSize) {
+      wndSize = newSize;
+      VkExtent2D const size{(uint32_t)wndSize.width(),
+                            (uint32_t)wndSize.height()};
+      offscreen = std::make_shared<OffscreenChain>(dev, size, runningFrames);
+      createSyncs(runningFrames);
+    }
+    return;
+  }
 
   if (swapchain == nullptr || (newSize != wndSize)) {
     if (newSize.x() != 0 || newSize.y() == 0)
@@ -62,6 +78,12 @@ void Canvas::resized(VkSurfaceKHR surface, ivec2 const &newSize) {
   wndSize = newSize;
 }
 
+std::vector<framebuffer_ptr>
+Canvas::createFramebuffers(renderpass_ptr renderPass) {
+  return offscreen ? offscreen->createFramebuffers(renderPass)
+                   : swapchain->createFramebuffers(renderPass);
+}
+
 void Canvas::createSwapchain(VkSurfaceKHR surface) {
   swapchain_ptr new_chain = std::make_shared<Swapchain>(
       dev, dev->getPhysicalDevice(), surface, dev->getQueueFamilyIndices(),
@@ -119,8 +141,18 @@ void Canvas::createSyncs(int numImages) {
 int Canvas::acquireImage(int frame) {
   uint32_t fr = frame % runningFrames;
 
-  // Acquire an image
+  // Offscreen images are used in turn.
   uint32_t imageIndex;
+  if (offscreen != nullptr) {
+    imageIndex = nextImage;
+    nextImage = (nextImage + 1) % offscreen->getNumImages();
+    if (imageFences[imageIndex] != VK_NULL_HANDLE)
+      vkWaitForFences(*dev, 1, &imageFences[imageIndex], VK_TRUE, UINT64_MAX);
+    imageFences[imageIndex] = frameFences[fr];
+    return imageIndex;
+  }
+
+  // Acquire an image
   VkResult res =
       vkAcquireNextImageKHR(*dev, *swapchain, INT64_MAX, imageAvailableSems[fr],
                             VK_NULL_HANDLE, &imageIndex);
@@ -146,11 +178,17 @@ int Canvas::acquireImage(int frame) {
 void Canvas::draw(int frame, cmdbuf_ptr cmd, queue_ptr gfxQueue) {
   uint32_t fr = frame % runningFrames;
   vkResetFences(*dev, 1, &frameFences[fr]);
-  cmd->submit(gfxQueue, imageAvailableSems[fr], renderFinishedSems[fr],
-              frameFences[fr]);
+  if (offscreen != nullptr)
+    cmd->submit(gfxQueue, VK_NULL_HANDLE, VK_NULL_HANDLE, frameFences[fr]);
+  else
+    cmd->submit(gfxQueue, imageAvailableSems[fr], renderFinishedSems[fr],
+                frameFences[fr]);
 }
 
 void Canvas::present(int frame, uint32_t imageIndex, VkQueue presentQueue) {
+  if (offscreen != nullptr)
+    return;
+
   uint32_t fr = frame % runningFrames;
 
   // Present the image
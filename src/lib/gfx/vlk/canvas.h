@@ -25,6 +25,7 @@
 #include "core/worker.h"
 #include "impl/commands.h"
 #include "impl/device.h"
+#include "impl/offscreen.h"
 #include "impl/renderpass.h"
 #include "impl/swapchain.h"
 #include "math/ivec2.h"
@@ -36,7 +37,8 @@ typedef void (*drawCallable)(int imageIndex);
 
 /**
  * Canvas handles images and swap chains and does the
- * actual drawing operations.
+ * actual drawing operations. If the device has no surface, the canvas
+ * renders into offscreen images instead of a swap chain.
  */
 class Canvas : public Lockable {
 public:
@@ -44,17 +46,42 @@ public:
   ~Canvas();
 
   // Returns the size of the framebuffer.
-  VkExtent2D getSize() const { return swapchain->getSize(); }
+  VkExtent2D getSize() const {
+    return offscreen ? offscreen->getSize() : swapchain->getSize();
+  }
 
   // Returns the number of swap chain images in this canvas.
-  size_t getNumImages() const { return swapchain->getNumImages(); }
+  size_t getNumImages() const {
+    return offscreen ? offscreen->getNumImages() : swapchain->getNumImages();
+  }
+
+  // Returns the format of the images.
+  VkFormat getFormat() const {
+    return offscreen ? offscreen->getFormat() : swapchain->getFormat();
+  }
 
   size_t getRunningFrames() const { return runningFrames; }
 
   swapchain_ptr getSwapchain() const { return swapchain; }
 
+  // Returns the offscreen images, or nullptr if rendering to a window.
+  offscreen_ptr getOffscreen() const { return offscreen; }
+
+  // Returns the layout the render pass must leave the images in.
+  VkImageLayout getFinalLayout() const {
+    return offscreen ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
+                     : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+  }
+
+  // Create framebuffers for the images.
+  std::vector<framebuffer_ptr> createFramebuffers(renderpass_ptr renderPass);
+
   void waitFences() const;
 
+  // Waits until the commands last submitted for the running frame have
+  // completed.
+  void waitFrame(int frame) const;
+
   // Called when canvas has to resized. The new size might not differ.
   void resized(VkSurfaceKHR surface, ivec2 const &newSize);
 
@@ -76,6 +103,8 @@ private:
   bool forceImmediate;
 
   swapchain_ptr swapchain;
+  offscreen_ptr offscreen;
+  uint32_t nextImage = 0; // offscreen only
 
   int runningFrames;
   std::vector<VkSemaphore> imageAvailableSems;
@@ -115,3 +115,13 @@ buffer_ptr cst::vlk::createUniformBuffer(device_ptr dev, size_t size,
 
   return std::make_shared<Buffer>(dev, size, usage, allocInfo);
 }
+
+buffer_ptr cst::vlk::createMappedBuffer(device_ptr dev, size_t size,
+                                        VkBufferUsageFlags usage) {
+  VmaAllocationCreateInfo allocInfo{};
+  allocInfo.requiredFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+  allocInfo.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
+  allocInfo.usage = VMA_MEMORY_USAGE_CPU_TO_GPU;
+
+  return std::make_shared<Buffer>(dev, size, usage, allocInfo);
+}
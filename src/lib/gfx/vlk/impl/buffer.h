@@ -38,6 +38,10 @@ public:
 
   operator VkBuffer() const { return buf; }
 
+  // Returns the mapped memory of a buffer allocated with
+  // VMA_ALLOCATION_CREATE_MAPPED_BIT.
+  void *getMapped() const { return dst; }
+
   /**
    * Copies data from src to this buffer.
    * This buffer must be memory mappable.
@@ -92,6 +96,13 @@ buffer_ptr createBufferFrom(device_ptr dev, cmdpool_ptr pool, queue_ptr queue,
 buffer_ptr createUniformBuffer(device_ptr dev, size_t size,
                                bool alwaysMapped = false);
 
+/**
+ * Creates a buffer in host visible memory that stays mapped, for data
+ * written by the CPU every frame.
+ */
+buffer_ptr createMappedBuffer(device_ptr dev, size_t size,
+                              VkBufferUsageFlags usage);
+
 } // namespace cst::vlk
 
 #endif // _CST_LIB_GFX_VLK_IMPL_BUFFER_H
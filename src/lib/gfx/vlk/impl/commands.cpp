@@ -20,6 +20,7 @@
  SOFTWARE.
  */
 #include "commands.h"
+#include "buffer.h"
 #include "descs.h"
 #include "pipeline.h"
 
@@ -38,8 +39,13 @@ CommandPool::CommandPool(device_ptr dev, uint32_t queueFamily) : dev(dev) {
 
 CommandPool::~CommandPool() { vkDestroyCommandPool(*dev, pool, nullptr); }
 
-CommandBuffer::CommandBuffer(cmdpool_ptr pool, bool fenced)
-    : pool(pool), cmd(VK_NULL_HANDLE) {
+void CommandPool::reset() {
+  if (vkResetCommandPool(*dev, pool, 0) != VK_SUCCESS)
+    throw std::runtime_error("failed to reset a command pool");
+}
+
+CommandBuffer::CommandBuffer(cmdpool_ptr pool, bool fenced, bool secondary)
+    : pool(pool), secondary(secondary), cmd(VK_NULL_HANDLE) {
   create();
 
   if (fenced) {
@@ -63,14 +69,11 @@ void CommandBuffer::create() {
   if (cmd != VK_NULL_HANDLE)
     vkFreeCommandBuffers(*pool->dev, *pool, 1, &cmd);
 
-  descs.clear();
-  buffers.clear();
-  pipelines.clear();
-
   VkCommandBufferAllocateInfo info{};
   info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
   info.commandPool = *pool;
-  info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  info.level = secondary ? VK_COMMAND_BUFFER_LEVEL_SECONDARY
+                         : VK_COMMAND_BUFFER_LEVEL_PRIMARY;
   info.commandBufferCount = 1;
   if (vkAllocateCommandBuffers(*pool->dev, &info, &cmd) != VK_SUCCESS)
     throw std::runtime_error("failed to allocate command buffers");
@@ -83,15 +86,40 @@ void CommandBuffer::begin(bool onetime) {
   vkBeginCommandBuffer(cmd, &begin);
 }
 
+void CommandBuffer::beginSecondary(VkRenderPass pass, VkFramebuffer fb,
+                                   VkQueryPipelineStatisticFlags stats) {
+  assert(secondary);
+
+  VkCommandBufferInheritanceInfo inherit{};
+  inherit.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+  inherit.renderPass = pass;
+  inherit.framebuffer = fb;
+  inherit.pipelineStatistics = stats;
+
+  VkCommandBufferBeginInfo begin{};
+  begin.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  begin.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT |
+                VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+  begin.pInheritanceInfo = &inherit;
+  vkBeginCommandBuffer(cmd, &begin);
+}
+
 void CommandBuffer::copyBuffer(VkBuffer src, VkBuffer dst, VkDeviceSize size) {
   VkBufferCopy region{};
   region.size = size;
   vkCmdCopyBuffer(cmd, src, dst, 1, &region);
 }
 
+void CommandBuffer::copyBuffer(VkBuffer src, VkBuffer dst,
+                               VkBufferCopy const &region) {
+  vkCmdCopyBuffer(cmd, src, dst, 1, &region);
+}
+
 void CommandBuffer::copyBuffer(VkBuffer src, VkImage dst, uint32_t width,
-                               uint32_t height, uint32_t layers) {
+                               uint32_t height, uint32_t layers,
+                               VkDeviceSize offset) {
   VkBufferImageCopy region{};
+  region.bufferOffset = offset;
   region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
   region.imageSubresource.layerCount = layers;
   region.imageExtent = {width, height, 1};
@@ -99,11 +127,61 @@ void CommandBuffer::copyBuffer(VkBuffer src, VkImage dst, uint32_t width,
                          &region);
 }
 
+void CommandBuffer::copyBuffer(VkBuffer src, VkImage dst,
+                               std::vector<VkBufferImageCopy> const &regions) {
+  vkCmdCopyBufferToImage(cmd, src, dst, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                         regions.size(), regions.data());
+}
+
+void CommandBuffer::copyImage(VkImage src, VkImage dst,
+                              std::vector<VkImageCopy> const &regions) {
+  vkCmdCopyImage(cmd, src, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, dst,
+                 VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, regions.size(),
+                 regions.data());
+}
+
+void CommandBuffer::copyImage(VkImage src, VkBuffer dst, uint32_t width,
+                              uint32_t height) {
+  VkBufferImageCopy region{};
+  region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  region.imageSubresource.layerCount = 1;
+  region.imageExtent = {width, height, 1};
+  vkCmdCopyImageToBuffer(cmd, src, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, dst, 1,
+                         &region);
+
+  VkMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+  vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &barrier, 0, nullptr,
+                       0, nullptr);
+}
+
+void CommandBuffer::resetQueries(VkQueryPool pool, uint32_t first,
+                                 uint32_t count) {
+  vkCmdResetQueryPool(cmd, pool, first, count);
+}
+
+void CommandBuffer::writeTimestamp(VkQueryPool pool, uint32_t query,
+                                   VkPipelineStageFlagBits stage) {
+  vkCmdWriteTimestamp(cmd, stage, pool, query);
+}
+
+void CommandBuffer::beginQuery(VkQueryPool pool, uint32_t query) {
+  vkCmdBeginQuery(cmd, pool, query, 0);
+}
+
+void CommandBuffer::endQuery(VkQueryPool pool, uint32_t query) {
+  vkCmdEndQuery(cmd, pool, query);
+}
+
 void CommandBuffer::transitionImageLayout(VkImage image,
                                           VkImageLayout oldLayout,
                                           VkImageLayout newLayout,
                                           int layers,
-                                          int mipLevels) {
+                                          int mipLevels,
+                                          int baseMipLevel) {
   VkImageMemoryBarrier b{};
   b.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
   b.image = image;
@@ -113,6 +191,7 @@ void CommandBuffer::transitionImageLayout(VkImage image,
   b.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
 
   b.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  b.subresourceRange.baseMipLevel = baseMipLevel;
   b.subresourceRange.levelCount = mipLevels;
   b.subresourceRange.layerCount = layers;
 
@@ -125,7 +204,19 @@ void CommandBuffer::transitionImageLayout(VkImage image,
   } else if (oldLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL &&
              newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) {
     b.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-    b.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    b.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    srcStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+    dstStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+  } else if (oldLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL &&
+             newLayout == VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL) {
+    b.srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    b.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    srcStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+    dstStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+  } else if (oldLayout == VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL &&
+             newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) {
+    b.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    b.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
     srcStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
     dstStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
   } else {
@@ -138,7 +229,7 @@ void CommandBuffer::transitionImageLayout(VkImage image,
 
 void CommandBuffer::beginRenderPass(VkRenderPass pass, VkFramebuffer fb,
                                     VkExtent2D const &size,
-                                    vec4 const &clearColor) {
+                                    vec4 const &clearColor, bool secondaries) {
   VkRenderPassBeginInfo beginPass{};
   beginPass.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
   beginPass.renderPass = pass;
@@ -154,33 +245,52 @@ void CommandBuffer::beginRenderPass(VkRenderPass pass, VkFramebuffer fb,
 
   beginPass.clearValueCount = clears.size();
   beginPass.pClearValues = clears.data();
-  vkCmdBeginRenderPass(cmd, &beginPass, VK_SUBPASS_CONTENTS_INLINE);
+  vkCmdBeginRenderPass(cmd, &beginPass,
+                       secondaries ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS
+                                   : VK_SUBPASS_CONTENTS_INLINE);
 }
 
 void CommandBuffer::endRenderPass() { vkCmdEndRenderPass(cmd); }
 
-void CommandBuffer::bindPipeline(pipeline_ptr pipeline) {
-  vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, *pipeline);
-  pipelines.push_back(pipeline);
+void CommandBuffer::executeCommands(
+    std::vector<cmdbuf_ptr> const &secondaries) {
+  std::vector<VkCommandBuffer> handles;
+  handles.reserve(secondaries.size());
+  for (cmdbuf_ptr const &c : secondaries)
+    handles.push_back(*c);
+  vkCmdExecuteCommands(cmd, handles.size(), handles.data());
 }
 
-void CommandBuffer::drawIndexed(buffer_ptr vertexBuf, buffer_ptr indexBuf,
-                                unsigned int numIndices) {
+void CommandBuffer::bindPipeline(Pipeline const &pipeline) {
+  vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+}
 
-  buffers.push_back(vertexBuf);
-  buffers.push_back(indexBuf);
+void CommandBuffer::pushConstants(VkPipelineLayout layout,
+                                  VkShaderStageFlags stages, void const *data,
+                                  uint32_t size) {
+  vkCmdPushConstants(cmd, layout, stages, 0, size, data);
+}
 
+void CommandBuffer::bindVertexBuffer(uint32_t binding, Buffer const &buf) {
   VkDeviceSize offsets{0};
-  VkBuffer vbuf = *vertexBuf;
-  vkCmdBindVertexBuffers(cmd, 0, 1, &vbuf, &offsets);
-  vkCmdBindIndexBuffer(cmd, *indexBuf, 0, VK_INDEX_TYPE_UINT32);
-  vkCmdDrawIndexed(cmd, numIndices, 1, 0, 0, 0);
+  VkBuffer vbuf = buf;
+  vkCmdBindVertexBuffers(cmd, binding, 1, &vbuf, &offsets);
+}
+
+void CommandBuffer::bindIndexBuffer(Buffer const &buf) {
+  vkCmdBindIndexBuffer(cmd, buf, 0, VK_INDEX_TYPE_UINT32);
 }
 
-void CommandBuffer::bindDescriptorSet(uint32_t index, descset_ptr set,
+void CommandBuffer::drawIndexed(unsigned int numIndices, uint32_t numInstances,
+                                uint32_t firstInstance, uint32_t firstIndex,
+                                int32_t vertexOffset) {
+  vkCmdDrawIndexed(cmd, numIndices, numInstances, firstIndex, vertexOffset,
+                   firstInstance);
+}
+
+void CommandBuffer::bindDescriptorSet(uint32_t index, DescriptorSet const &set,
                                       VkPipelineLayout layout) {
-  descs.push_back(set);
-  VkDescriptorSet s[] = {*set};
+  VkDescriptorSet s[] = {set};
   vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, index,
                           1, s, 0, nullptr);
 }
@@ -203,10 +313,6 @@ void CommandBuffer::submit(queue_ptr queue, bool wait) {
       throw std::runtime_error("failed to wait for fence");
     vkResetFences(*pool->dev, 1, &fence);
     signaled = true;
-
-    descs.clear();
-    buffers.clear();
-    pipelines.clear();
   }
 }
 
@@ -219,14 +325,18 @@ void CommandBuffer::submit(queue_ptr queue, VkSemaphore wait, VkSemaphore signal
 
   VkPipelineStageFlags waitStages[] = {
       VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-  submit.waitSemaphoreCount = 1;
-  submit.pWaitSemaphores = &wait;
-  submit.pWaitDstStageMask = waitStages;
+  if (wait != VK_NULL_HANDLE) {
+    submit.waitSemaphoreCount = 1;
+    submit.pWaitSemaphores = &wait;
+    submit.pWaitDstStageMask = waitStages;
+  }
   submit.commandBufferCount = 1;
 
   submit.pCommandBuffers = &cmd;
-  submit.signalSemaphoreCount = 1;
-  submit.pSignalSemaphores = &signal;
+  if (signal != VK_NULL_HANDLE) {
+    submit.signalSemaphoreCount = 1;
+    submit.pSignalSemaphores = &signal;
+  }
 
   if (vkQueueSubmit(*queue, 1, &submit, frameFence) != VK_SUCCESS)
     throw std::runtime_error("failed to submit a command buffer");
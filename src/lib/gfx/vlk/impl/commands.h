@@ -32,13 +32,11 @@
 namespace cst::vlk {
 
 class Buffer;
-typedef std::shared_ptr<Buffer> buffer_ptr;
-
 class DescriptorSet;
-typedef std::shared_ptr<DescriptorSet> descset_ptr;
-
 class Pipeline;
-typedef std::shared_ptr<Pipeline> pipeline_ptr;
+
+class CommandBuffer;
+typedef std::shared_ptr<CommandBuffer> cmdbuf_ptr;
 
 /**
  * CommandPool
@@ -50,6 +48,10 @@ public:
 
   operator VkCommandPool() const { return pool; }
 
+  /** Resets all command buffers allocated from the pool for recording
+   * again. None of them may be pending execution. */
+  void reset();
+
   device_ptr dev;
 
 private:
@@ -59,73 +61,128 @@ private:
 typedef std::shared_ptr<CommandPool> cmdpool_ptr;
 
 /**
- * CommandBuffer
+ * CommandBuffer. It does not keep the objects it refers to alive, they
+ * must outlive the execution of the commands, see DeletionQueue.
  */
 class CommandBuffer {
 public:
-  CommandBuffer(cmdpool_ptr pool, bool fenced);
+  /** A secondary command buffer records commands to be executed from a
+   * render pass of a primary one. */
+  CommandBuffer(cmdpool_ptr pool, bool fenced, bool secondary = false);
   ~CommandBuffer();
 
   operator VkCommandBuffer() const { return cmd; }
 
-  /** Creates a new VkCommandBuffer */
+  cmdpool_ptr getPool() const { return pool; }
+
+  /** Creates a new VkCommandBuffer. Command buffers recorded every frame
+   * are instead reused after resetting their pool. */
   void create();
 
   /** Begins command buffer recording. */
   void begin(bool onetime = false);
 
+  /** Begins recording a secondary command buffer for one use inside the
+   * render pass and framebuffer. stats are the pipeline statistics of the
+   * queries active in the primary command buffer when it is executed. */
+  void beginSecondary(VkRenderPass pass, VkFramebuffer fb,
+                      VkQueryPipelineStatisticFlags stats = 0);
+
   /** Copies a buffer into another buffer. */
   void copyBuffer(VkBuffer src, VkBuffer dst, VkDeviceSize size);
 
+  /** Copies a region of a buffer into another buffer. */
+  void copyBuffer(VkBuffer src, VkBuffer dst, VkBufferCopy const &region);
+
   /**
    * Copies a buffer into an image.
    * The receiving image must be in correct layout.
    */
   void copyBuffer(VkBuffer src, VkImage dst, uint32_t width, uint32_t height,
-                  uint32_t layers);
+                  uint32_t layers, VkDeviceSize offset = 0);
+
+  /** Copies regions of a buffer into an image, e.g. several mip levels. */
+  void copyBuffer(VkBuffer src, VkImage dst,
+                  std::vector<VkBufferImageCopy> const &regions);
+
+  /** Copies regions of an image into another image. The images must be in
+   * TRANSFER_SRC and TRANSFER_DST layouts. */
+  void copyImage(VkImage src, VkImage dst,
+                 std::vector<VkImageCopy> const &regions);
+
+  /** Copies a color image into a buffer with tightly packed rows, to be read
+   * by the host. The image must be in TRANSFER_SRC layout. */
+  void copyImage(VkImage src, VkBuffer dst, uint32_t width, uint32_t height);
+
+  /** Resets queries [first, first + count) of a query pool. Must be called
+   * outside of a render pass. */
+  void resetQueries(VkQueryPool pool, uint32_t first, uint32_t count);
+
+  /** Writes a timestamp into a query once the commands before it have
+   * completed the given stage. */
+  void writeTimestamp(VkQueryPool pool, uint32_t query,
+                      VkPipelineStageFlagBits stage);
+
+  /** Begins and ends a query, e.g. of pipeline statistics. */
+  void beginQuery(VkQueryPool pool, uint32_t query);
+  void endQuery(VkQueryPool pool, uint32_t query);
 
   void transitionImageLayout(VkImage image, VkImageLayout oldLayout,
                              VkImageLayout newLayout, int layers,
-                             int mipLevels);
+                             int mipLevels, int baseMipLevel = 0);
 
-  /** Begins a render pass. */
+  /** Begins a render pass. With secondaries the contents of the pass are
+   * recorded in secondary command buffers, see executeCommands(). */
   void beginRenderPass(VkRenderPass pass, VkFramebuffer db,
-                       VkExtent2D const &size, cst::vec4 const &clearColor);
+                       VkExtent2D const &size, cst::vec4 const &clearColor,
+                       bool secondaries = false);
+
+  /** Executes secondary command buffers. */
+  void executeCommands(std::vector<cmdbuf_ptr> const &secondaries);
 
   /** Ends a renderpass. */
   void endRenderPass();
 
   /** Bind a descriptor set using the given pipeline layout. */
-  void bindDescriptorSet(uint32_t index, descset_ptr set,
+  void bindDescriptorSet(uint32_t index, DescriptorSet const &set,
                          VkPipelineLayout layout);
 
   /** Ends command buffer recording. */
   void end();
 
-  void bindPipeline(pipeline_ptr pipeline);
+  void bindPipeline(Pipeline const &pipeline);
 
-  void drawIndexed(buffer_ptr vertexBuf, buffer_ptr indexBuf,
-                   unsigned int numIndices);
+  /** Writes push constants of the given stages from offset 0. */
+  void pushConstants(VkPipelineLayout layout, VkShaderStageFlags stages,
+                     void const *data, uint32_t size);
+
+  void bindVertexBuffer(uint32_t binding, Buffer const &buf);
+  void bindIndexBuffer(Buffer const &buf);
+
+  // Draws instances [firstInstance, firstInstance + numInstances) of the
+  // numIndices indices from firstIndex of the bound index buffer.
+  // vertexOffset is added to the indices.
+  void drawIndexed(unsigned int numIndices, uint32_t numInstances = 1,
+                   uint32_t firstInstance = 0, uint32_t firstIndex = 0,
+                   int32_t vertexOffset = 0);
 
   /** Submits command buffer.
    * If queue is VK_NULL_HANDLE, graphics queue is used. */
   void submit(queue_ptr queue, bool wait);
 
+  /** Submits command buffer. The semaphores may be VK_NULL_HANDLE, e.g.
+   * when rendering offscreen. */
   void submit(queue_ptr queue, VkSemaphore wait, VkSemaphore signal,
               VkFence frameFence);
 
 private:
   cmdpool_ptr pool;
+  bool secondary;
   VkFence fence = VK_NULL_HANDLE;
   bool signaled = true;
   VkCommandBuffer cmd = VK_NULL_HANDLE;
-  std::vector<descset_ptr> descs;
-  std::vector<buffer_ptr> buffers;
-  std::vector<pipeline_ptr> pipelines;
 };
 
-typedef std::shared_ptr<CommandBuffer> cmdbuf_ptr;
-
 } // namespace cst::vlk
 
 #endif // _CST_LIB_GFX_VLK_IMPL_COMMANDS_H
@@ -0,0 +1,49 @@
+/*
+ Copyright (c) 2022 Tero Oinas
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+#include "deletion.h"
+
+using namespace cst::vlk;
+
+void DeletionQueue::beginFrame(uint64_t frame) {
+  std::deque<std::shared_ptr<void>> released;
+  {
+    std::scoped_lock lock(mux);
+    this->frame = frame;
+
+    while (!retired.empty() && retired.front().first + keepFrames < frame) {
+      released.push_back(std::move(retired.front().second));
+      retired.pop_front();
+    }
+  }
+  // Objects are destroyed outside of the lock, they may retire others.
+}
+
+void DeletionQueue::retire(std::shared_ptr<void> obj) {
+  std::scoped_lock lock(mux);
+  retired.push_back({frame, std::move(obj)});
+}
+
+void DeletionQueue::clear() {
+  std::deque<std::pair<uint64_t, std::shared_ptr<void>>> released;
+  std::scoped_lock lock(mux);
+  released.swap(retired);
+}
@@ -0,0 +1,61 @@
+/*
+ Copyright (c) 2022 Tero Oinas
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+#ifndef _CST_LIB_GFX_VLK_IMPL_DELETION_H
+#define _CST_LIB_GFX_VLK_IMPL_DELETION_H
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+
+namespace cst::vlk {
+
+/**
+ * DeletionQueue keeps objects that frames in flight may still use, e.g.
+ * replaced descriptor sets or image views, alive until those frames have
+ * completed. Command buffers do not hold references to what they use.
+ */
+class DeletionQueue {
+public:
+  // keepFrames is the number of frames that can be in flight.
+  DeletionQueue(size_t keepFrames) : keepFrames(keepFrames) {}
+
+  // Starts recording a frame, once the frame keepFrames before it has
+  // completed. Releases the objects no running frame can use anymore.
+  void beginFrame(uint64_t frame);
+
+  // Keeps obj alive until the frames recorded so far have completed.
+  void retire(std::shared_ptr<void> obj);
+
+  // Releases all objects. The device must be idle.
+  void clear();
+
+private:
+  std::mutex mux;
+  std::deque<std::pair<uint64_t, std::shared_ptr<void>>> retired;
+  size_t keepFrames;
+  uint64_t frame = 0;
+};
+
+} // namespace cst::vlk
+
+#endif // _CST_LIB_GFX_VLK_IMPL_DELETION_H
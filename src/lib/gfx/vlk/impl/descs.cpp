@@ -28,7 +28,8 @@
 using namespace cst::vlk;
 
 DescPool::DescPool(device_ptr dev, desclayout_ptr layout, size_t numSets,
-                   size_t numUniforms, size_t numSamplers)
+                   size_t numUniforms, size_t numSamplers, size_t numStorage,
+                   VkDescriptorPoolCreateFlags flags)
     : dev(dev), layout(layout) {
   std::vector<VkDescriptorPoolSize> sizes;
 
@@ -46,9 +47,16 @@ DescPool::DescPool(device_ptr dev, desclayout_ptr layout, size_t numSets,
     sizes.push_back(size_samplers);
   }
 
+  if (numStorage > 0) {
+    VkDescriptorPoolSize size_storage{};
+    size_storage.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    size_storage.descriptorCount = numStorage * numSets;
+    sizes.push_back(size_storage);
+  }
+
   VkDescriptorPoolCreateInfo info{};
   info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-  info.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
+  info.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT | flags;
   info.poolSizeCount = sizes.size();
   info.pPoolSizes = sizes.data();
   info.maxSets = numSets;
@@ -68,7 +76,7 @@ DescriptorSet::~DescriptorSet() {
   }
 }
 
-void DescriptorSet::bind(int binding, buffer_ptr buf) {
+void DescriptorSet::bind(int binding, buffer_ptr buf, VkDescriptorType type) {
   VkDescriptorBufferInfo info{};
   VkWriteDescriptorSet write{};
 
@@ -78,14 +86,15 @@ void DescriptorSet::bind(int binding, buffer_ptr buf) {
   write.dstSet = set;
 
   write.dstBinding = binding;
-  write.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+  write.descriptorType = type;
   write.descriptorCount = 1;
   write.pBufferInfo = &info;
 
   vkUpdateDescriptorSets(*pool->getDevice(), 1, &write, 0, nullptr);
 }
 
-void DescriptorSet::bindTexture(int binding, texture_ptr tex) {
+void DescriptorSet::bindTexture(int binding, texture_ptr tex,
+                                uint32_t element) {
   VkWriteDescriptorSet write{};
 
   VkDescriptorImageInfo info{};
@@ -95,12 +104,14 @@ void DescriptorSet::bindTexture(int binding, texture_ptr tex) {
   std::shared_ptr<TextureVlk> vtex = std::dynamic_pointer_cast<TextureVlk>(tex);
   assert(vtex != nullptr);
 
+  std::scoped_lock lock(vtex->mutex());
   info.imageView = vtex->getImageView();
   info.sampler = *vtex->getSampler();
 
   write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
   write.dstSet = set;
   write.dstBinding = binding;
+  write.dstArrayElement = element;
   write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
   write.descriptorCount = 1;
   write.pImageInfo = &info;
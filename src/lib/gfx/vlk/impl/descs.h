@@ -53,10 +53,12 @@ public:
   descpool_ptr getPool() const { return pool; }
 
   // Bind a buffer to this descriptor.
-  void bind(int binding, buffer_ptr buf);
+  void bind(int binding, buffer_ptr buf,
+            VkDescriptorType type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
 
-  // Bind a texture image to this descriptor);
-  void bindTexture(int binding, texture_ptr tex);
+  // Bind a texture image to this descriptor, or to an element of an array
+  // of them.
+  void bindTexture(int binding, texture_ptr tex, uint32_t element = 0);
 
 private:
   VkDescriptorSet set;
@@ -73,7 +75,8 @@ typedef std::shared_ptr<DescriptorSet> descset_ptr;
 class DescPool {
 public:
   DescPool(device_ptr dev, desclayout_ptr layout, size_t numSets,
-           size_t numUniforms, size_t numSamplers);
+           size_t numUniforms, size_t numSamplers, size_t numStorage = 0,
+           VkDescriptorPoolCreateFlags flags = 0);
   ~DescPool();
 
   operator VkDescriptorPool() const { return pool; }
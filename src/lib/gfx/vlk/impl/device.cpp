@@ -27,6 +27,7 @@
 
 #include <SDL_vulkan.h>
 
+#include <algorithm>
 #include <cassert>
 #include <iostream>
 #include <vector>
@@ -34,11 +35,15 @@
 using namespace cst::vlk;
 using namespace std::literals::chrono_literals;
 
+// Resources of the fragment stage other than the bindless images, with room
+// to spare.
+static const uint32_t BINDLESS_OTHER_RESOURCES = 16;
+
 Device::Device(SDL_Window *window, bool validationLayers) : wnd(window) {
   createInstance(validationLayers);
   setupDebugCallback();
 
-  if (!SDL_Vulkan_CreateSurface(wnd, instance, &surface))
+  if (wnd != nullptr && !SDL_Vulkan_CreateSurface(wnd, instance, &surface))
     throw std::runtime_error("failed to create a surface");
 
   setupPhysicalDevice();
@@ -52,7 +57,8 @@ Device::~Device() {
   vmaDestroyAllocator(allocator);
 
   vkDestroyDevice(device, nullptr);
-  vkDestroySurfaceKHR(instance, surface, nullptr);
+  if (surface != VK_NULL_HANDLE)
+    vkDestroySurfaceKHR(instance, surface, nullptr);
 
   auto destroyDebugUtilsMessenger =
       (PFN_vkDestroyDebugUtilsMessengerEXT)vkGetInstanceProcAddr(
@@ -64,13 +70,18 @@ Device::~Device() {
 }
 
 void Device::createInstance(bool validation) {
-  uint32_t num;
-  if (SDL_Vulkan_GetInstanceExtensions(wnd, &num, nullptr) == SDL_FALSE)
-    throw std::runtime_error("failed to query number of instance extenstions");
-
-  std::vector<const char *> exts(num);
-  if (!SDL_Vulkan_GetInstanceExtensions(wnd, &num, exts.data()))
-    throw std::runtime_error("failed to query instance extensions");
+  // Offscreen rendering needs no surface extensions.
+  std::vector<const char *> exts;
+  if (wnd != nullptr) {
+    uint32_t num;
+    if (SDL_Vulkan_GetInstanceExtensions(wnd, &num, nullptr) == SDL_FALSE)
+      throw std::runtime_error(
+          "failed to query number of instance extenstions");
+
+    exts.resize(num);
+    if (!SDL_Vulkan_GetInstanceExtensions(wnd, &num, exts.data()))
+      throw std::runtime_error("failed to query instance extensions");
+  }
 
   exts.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
 
@@ -125,8 +136,84 @@ void Device::setupPhysicalDevice() {
 
   vkGetPhysicalDeviceMemoryProperties(physDev, &memProps);
 
+  // E.g. software rasterizers support fewer samples than GPUs.
+  VkPhysicalDeviceProperties props;
+  vkGetPhysicalDeviceProperties(physDev, &props);
+  VkSampleCountFlags counts = props.limits.framebufferColorSampleCounts &
+                              props.limits.framebufferDepthSampleCounts;
+  for (VkSampleCountFlagBits s :
+       {VK_SAMPLE_COUNT_8_BIT, VK_SAMPLE_COUNT_4_BIT, VK_SAMPLE_COUNT_2_BIT}) {
+    if (counts & s) {
+      samples = s;
+      break;
+    }
+  }
+
+  if (props.limits.timestampComputeAndGraphics)
+    timestampPeriod = props.limits.timestampPeriod;
+
   VkPhysicalDeviceFeatures feats;
   vkGetPhysicalDeviceFeatures(physDev, &feats);
+
+  // Compressed texture formats are enabled when available.
+  features.samplerAnisotropy = VK_TRUE;
+  features.sampleRateShading = VK_TRUE;
+  features.textureCompressionBC = feats.textureCompressionBC;
+  features.textureCompressionETC2 = feats.textureCompressionETC2;
+  features.textureCompressionASTC_LDR = feats.textureCompressionASTC_LDR;
+
+  // For profiling, when available. Inherited queries let pipeline
+  // statistics count commands recorded in secondary command buffers.
+  features.pipelineStatisticsQuery = feats.pipelineStatisticsQuery;
+  features.inheritedQueries = feats.inheritedQueries;
+
+  // Descriptor indexing (core in Vulkan 1.2) for bindless materials, when
+  // available. Texture descriptors are written after the set is bound and
+  // while frames using other descriptors of it are running.
+  VkPhysicalDeviceDescriptorIndexingFeatures indexing{};
+  indexing.sType =
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+  VkPhysicalDeviceFeatures2 feats2{};
+  feats2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+  feats2.pNext = &indexing;
+  vkGetPhysicalDeviceFeatures2(physDev, &feats2);
+
+  if (props.apiVersion >= VK_API_VERSION_1_2 &&
+      feats.shaderSampledImageArrayDynamicIndexing &&
+      indexing.runtimeDescriptorArray &&
+      indexing.descriptorBindingPartiallyBound &&
+      indexing.descriptorBindingSampledImageUpdateAfterBind &&
+      indexing.descriptorBindingUpdateUnusedWhilePending) {
+    features.shaderSampledImageArrayDynamicIndexing = VK_TRUE;
+    indexingFeatures.sType =
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+    indexingFeatures.runtimeDescriptorArray = VK_TRUE;
+    indexingFeatures.descriptorBindingPartiallyBound = VK_TRUE;
+    indexingFeatures.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+    indexingFeatures.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+    descriptorIndexing = true;
+
+    VkPhysicalDeviceDescriptorIndexingProperties iprops{};
+    iprops.sType =
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+    VkPhysicalDeviceProperties2 props2{};
+    props2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    props2.pNext = &iprops;
+    vkGetPhysicalDeviceProperties2(physDev, &props2);
+    // The images are combined image samplers, counted both as samplers and
+    // as sampled images. The fragment stage also has the uniform and
+    // storage buffers and the color attachment, which count against
+    // maxPerStageUpdateAfterBindResources too.
+    uint32_t const resources = iprops.maxPerStageUpdateAfterBindResources;
+    maxBindlessImages =
+        std::min({iprops.maxPerStageDescriptorUpdateAfterBindSamplers,
+                  iprops.maxPerStageDescriptorUpdateAfterBindSampledImages,
+                  iprops.maxDescriptorSetUpdateAfterBindSamplers,
+                  iprops.maxDescriptorSetUpdateAfterBindSampledImages,
+                  resources > BINDLESS_OTHER_RESOURCES
+                      ? resources - BINDLESS_OTHER_RESOURCES
+                      : 0});
+  }
 }
 
 enum QueueType { QueueGfx = 0, QueuePresent, QueueTransfer };
@@ -142,17 +229,17 @@ void Device::createLogicalDevice() {
   std::vector<float> pris;
   auto qcreates = setupCreateQueues(qinfos, pris);
 
-  VkPhysicalDeviceFeatures feats{};
-  feats.samplerAnisotropy = VK_TRUE;
-  feats.sampleRateShading = VK_TRUE;
-
   VkDeviceCreateInfo create{};
   create.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
   create.pQueueCreateInfos = qinfos.data();
   create.queueCreateInfoCount = qinfos.size();
-  create.pEnabledFeatures = &feats;
+  create.pEnabledFeatures = &features;
+  if (descriptorIndexing)
+    create.pNext = &indexingFeatures;
 
-  std::vector<const char *> exts = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
+  std::vector<const char *> exts;
+  if (surface != VK_NULL_HANDLE)
+    exts.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
   create.enabledExtensionCount = exts.size();
   create.ppEnabledExtensionNames = exts.data();
 
@@ -169,6 +256,11 @@ void Device::createLogicalDevice() {
     else if (q.type == QueueGfx)
       gfxQueues.push_back(queue);
   }
+
+  // Without a surface, the tasks of the present queue run on a graphics
+  // queue.
+  if (presentQueue == nullptr)
+    presentQueue = gfxQueues[0];
 }
 
 static VKAPI_ATTR VkBool32 VKAPI_CALL
@@ -247,7 +339,8 @@ Device::setupCreateQueues(std::vector<VkDeviceQueueCreateInfo> &qinfos,
 
   for (uint32_t i = 0; i < numFamilies; i++) {
     VkBool32 present = false;
-    vkGetPhysicalDeviceSurfaceSupportKHR(physDev, i, surface, &present);
+    if (surface != VK_NULL_HANDLE)
+      vkGetPhysicalDeviceSurfaceSupportKHR(physDev, i, surface, &present);
     gfx_queues_left.push_back(qfs[i].queueCount);
     has_present.push_back(present);
   }
@@ -297,7 +390,7 @@ Device::setupCreateQueues(std::vector<VkDeviceQueueCreateInfo> &qinfos,
     throw std::runtime_error(
         "no suitable graphics queue family found for painting");
 
-  if (!presentFound)
+  if (!presentFound && surface != VK_NULL_HANDLE)
     throw std::runtime_error("no suitable presentation queue family found");
 
   pris.reserve(numGfxFound + 1);
@@ -40,6 +40,8 @@ struct QueueCreateInfo;
  */
 class Device {
 public:
+  // Creates a device that presents to the window. If window is nullptr, the
+  // device has no surface nor swap chain support and renders offscreen.
   Device(SDL_Window *window, bool validationLayers = true);
   ~Device();
 
@@ -48,6 +50,28 @@ public:
   VkPhysicalDevice getPhysicalDevice() const { return physDev; }
   VmaAllocator getAllocator() const { return allocator; }
 
+  // Returns the optional features that are enabled on the device.
+  VkPhysicalDeviceFeatures const &getFeatures() const { return features; }
+
+  // Returns true if the descriptor indexing features used by bindless
+  // materials are enabled.
+  bool hasDescriptorIndexing() const { return descriptorIndexing; }
+
+  // Returns the number of sampled images a descriptor set created for
+  // updates after binding can hold, 0 without descriptor indexing.
+  uint32_t getMaxBindlessImages() const { return maxBindlessImages; }
+
+  // Returns the number of samples used for multisampled rendering, the
+  // largest supported count up to 8.
+  VkSampleCountFlagBits getSampleCount() const { return samples; }
+
+  // Returns the nanoseconds per timestamp query tick, or 0 if the graphics
+  // queues do not support timestamps.
+  float getTimestampPeriod() const { return timestampPeriod; }
+
+  // Returns true if the device was created without a surface.
+  bool isOffscreen() const { return surface == VK_NULL_HANDLE; }
+
   // Canvas needs this to create a swap chain.
   std::vector<uint32_t> getQueueFamilyIndices() const;
 
@@ -59,7 +83,8 @@ public:
 
   queue_ptr getPresentQueue() const { return presentQueue; }
 
-  // Canvas needs this to create a swap chain.
+  // Canvas needs this to create a swap chain. VK_NULL_HANDLE when
+  // rendering offscreen.
   VkSurfaceKHR getSurface() const { return surface; }
 
 private:
@@ -87,6 +112,12 @@ private:
 
   VkDevice device = VK_NULL_HANDLE;
   VkPhysicalDeviceMemoryProperties memProps;
+  VkPhysicalDeviceFeatures features{};
+  VkPhysicalDeviceDescriptorIndexingFeatures indexingFeatures{};
+  bool descriptorIndexing = false;
+  uint32_t maxBindlessImages = 0;
+  VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+  float timestampPeriod = 0.0f;
   VmaAllocator allocator = VK_NULL_HANDLE;
 
   std::vector<queue_ptr> gfxQueues;
@@ -21,19 +21,21 @@
  */
 #include "image.h"
 
+#include <algorithm>
 #include <iostream>
 #include <map>
 #include <string>
 
 #include "buffer.h"
 #include "commands.h"
+#include "staging.h"
 #include "support/stb_image.h"
 
 using namespace cst::vlk;
 
 ImageVlk::ImageVlk(device_ptr dev, VkExtent2D const &size, VkFormat format,
                    VkImageUsageFlagBits usage, VkSampleCountFlagBits samples)
-    : dev(dev) {
+    : dev(dev), width(size.width), height(size.height), format(format) {
   VkImageCreateInfo info{};
   info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
   info.imageType = VK_IMAGE_TYPE_2D;
@@ -59,14 +61,14 @@ ImageVlk::ImageVlk(device_ptr dev, VkExtent2D const &size, VkFormat format,
 }
 
 ImageVlk::ImageVlk(device_ptr dev, cmdpool_ptr pool, queue_ptr queue,
-                   uint8_t *pix, int width, int height, int depth, int layers,
-                   VkFormat format, int mipLevels)
-    : dev(dev) {
+                   StagingAllocation const &src, int width, int height,
+                   int depth, int layers, VkFormat format, int mipLevels)
+    : dev(dev), width(width), height(height), layers(layers),
+      mipLevels(mipLevels), format(format) {
 
   assert(depth == 4);
   assert(layers == 1 || layers == 6);
-  VkDeviceSize size = width * height * depth * layers;
-  buffer_ptr buf = createStagingBufferFrom(dev, pix, size);
+  assert(src.getSize() >= VkDeviceSize(width) * height * depth * layers);
 
   VkImageCreateInfo info{};
   info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
@@ -99,7 +101,8 @@ ImageVlk::ImageVlk(device_ptr dev, cmdpool_ptr pool, queue_ptr queue,
   cmd.begin(true);
   cmd.transitionImageLayout(img, VK_IMAGE_LAYOUT_UNDEFINED,
                             VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, layers, mipLevels);
-  cmd.copyBuffer(*buf, img, width, height, layers);
+  cmd.copyBuffer(src.getBuffer(), img, width, height, layers,
+                 src.getOffset());
 
   cmd.end();
   cmd.submit(queue, false);
@@ -107,6 +110,141 @@ ImageVlk::ImageVlk(device_ptr dev, cmdpool_ptr pool, queue_ptr queue,
   generateMipmaps(pool, queue, width, height, layers, mipLevels);
 }
 
+ImageVlk::ImageVlk(device_ptr dev, cmdpool_ptr pool, queue_ptr queue,
+                   StagingAllocation const &src,
+                   std::vector<TextureLevel> const &levels, int layers,
+                   VkFormat format)
+    : dev(dev), width(levels[0].width), height(levels[0].height),
+      layers(layers), mipLevels(levels.size()), format(format) {
+
+  assert(!levels.empty());
+  assert(layers == 1 || layers == 6);
+
+  assert(src.getSize() >= levels.back().offset + levels.back().size * layers);
+
+  VkImageCreateInfo info{};
+  info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+  info.imageType = VK_IMAGE_TYPE_2D;
+  info.extent.width = levels[0].width;
+  info.extent.height = levels[0].height;
+  info.extent.depth = 1;
+  info.mipLevels = levels.size();
+  info.arrayLayers = layers;
+  info.format = format;
+  info.tiling = VK_IMAGE_TILING_OPTIMAL;
+  info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  info.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT |
+               VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+  info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+  info.samples = VK_SAMPLE_COUNT_1_BIT;
+  info.flags = (layers == 6) ? VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT : 0;
+
+  VmaAllocationCreateInfo allocInfo{};
+  allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+
+  if (vmaCreateImage(dev->getAllocator(), &info, &allocInfo, &img, &mem,
+                     nullptr) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create an image");
+  }
+
+  // One copy per mip level, each covering all layers.
+  std::vector<VkBufferImageCopy> regions;
+  for (size_t i = 0; i < levels.size(); i++) {
+    VkBufferImageCopy region{};
+    region.bufferOffset = src.getOffset() + levels[i].offset;
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.mipLevel = i;
+    region.imageSubresource.layerCount = layers;
+    region.imageExtent = {uint32_t(levels[i].width),
+                          uint32_t(levels[i].height), 1};
+    regions.push_back(region);
+  }
+
+  CommandBuffer cmd(pool, true);
+  cmd.begin(true);
+  cmd.transitionImageLayout(img, VK_IMAGE_LAYOUT_UNDEFINED,
+                            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, layers,
+                            levels.size());
+  cmd.copyBuffer(src.getBuffer(), img, regions);
+  cmd.transitionImageLayout(img, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, layers,
+                            levels.size());
+  cmd.end();
+  cmd.submit(queue, true);
+}
+
+ImageVlk::ImageVlk(device_ptr dev, cmdpool_ptr pool, queue_ptr queue,
+                   ImageVlk const &src, int firstLevel)
+    : dev(dev), width(std::max(1, src.width >> firstLevel)),
+      height(std::max(1, src.height >> firstLevel)), layers(src.layers),
+      mipLevels(src.mipLevels - firstLevel), format(src.format) {
+
+  assert(firstLevel > 0 && firstLevel < src.mipLevels);
+
+  VkImageCreateInfo info{};
+  info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+  info.imageType = VK_IMAGE_TYPE_2D;
+  info.extent.width = width;
+  info.extent.height = height;
+  info.extent.depth = 1;
+  info.mipLevels = mipLevels;
+  info.arrayLayers = layers;
+  info.format = format;
+  info.tiling = VK_IMAGE_TILING_OPTIMAL;
+  info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  info.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT |
+               VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+  info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+  info.samples = VK_SAMPLE_COUNT_1_BIT;
+  info.flags = (layers == 6) ? VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT : 0;
+
+  VmaAllocationCreateInfo allocInfo{};
+  allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+
+  if (vmaCreateImage(dev->getAllocator(), &info, &allocInfo, &img, &mem,
+                     nullptr) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create an image");
+  }
+
+  std::vector<VkImageCopy> regions;
+  for (int i = 0; i < mipLevels; i++) {
+    VkImageCopy region{};
+    region.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.srcSubresource.mipLevel = firstLevel + i;
+    region.srcSubresource.layerCount = layers;
+    region.dstSubresource = region.srcSubresource;
+    region.dstSubresource.mipLevel = i;
+    region.extent = {uint32_t(std::max(1, width >> i)),
+                     uint32_t(std::max(1, height >> i)), 1};
+    regions.push_back(region);
+  }
+
+  // The source stays readable by shaders of frames still in flight.
+  CommandBuffer cmd(pool, true);
+  cmd.begin(true);
+  cmd.transitionImageLayout(src, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                            VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, layers,
+                            mipLevels, firstLevel);
+  cmd.transitionImageLayout(img, VK_IMAGE_LAYOUT_UNDEFINED,
+                            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, layers,
+                            mipLevels);
+  cmd.copyImage(src, img, regions);
+  cmd.transitionImageLayout(src, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, layers,
+                            mipLevels, firstLevel);
+  cmd.transitionImageLayout(img, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, layers,
+                            mipLevels);
+  cmd.end();
+  cmd.submit(queue, true);
+}
+
+VkDeviceSize ImageVlk::getMemorySize() const {
+  VmaAllocationInfo info;
+  vmaGetAllocationInfo(dev->getAllocator(), mem, &info);
+  return info.size;
+}
+
 void ImageVlk::generateMipmaps(cmdpool_ptr pool, queue_ptr queue, int width,
                                int height, int layers, int mipLevels) {
   CommandBuffer cmd(pool, true);
@@ -29,11 +29,13 @@
 
 #include "commands.h"
 #include "device.h"
+#include "sg/texture.h"
 #include "support/vk_mem_alloc.h"
 
 namespace cst::vlk {
 
 class ImageVlk;
+class StagingAllocation;
 typedef std::shared_ptr<ImageVlk> image_ptr;
 
 class ImageVlk {
@@ -42,13 +44,36 @@ public:
   ImageVlk(device_ptr dev, VkExtent2D const &size, VkFormat format,
            VkImageUsageFlagBits usage, VkSampleCountFlagBits samples);
 
-  ImageVlk(device_ptr dev, cmdpool_ptr pool, queue_ptr queue, uint8_t *pix,
-           int width, int height, int depth, int layers, VkFormat format,
-           int mipLevels);
+  // Create a sampled image from the base level in staging memory and
+  // generate the rest of the mip levels.
+  ImageVlk(device_ptr dev, cmdpool_ptr pool, queue_ptr queue,
+           StagingAllocation const &src, int width, int height, int depth,
+           int layers, VkFormat format, int mipLevels);
+
+  // Create a sampled image from pixel data in staging memory that contains
+  // all of its mip levels, e.g. a block compressed texture.
+  ImageVlk(device_ptr dev, cmdpool_ptr pool, queue_ptr queue,
+           StagingAllocation const &src,
+           std::vector<TextureLevel> const &levels, int layers,
+           VkFormat format);
+
+  // Create a sampled image from the mip levels of src starting at
+  // firstLevel. Used to drop the top levels of a texture.
+  ImageVlk(device_ptr dev, cmdpool_ptr pool, queue_ptr queue,
+           ImageVlk const &src, int firstLevel);
   ~ImageVlk();
 
   operator VkImage() const { return img; }
 
+  int getWidth() const { return width; }
+  int getHeight() const { return height; }
+  int getLayers() const { return layers; }
+  int getMipLevels() const { return mipLevels; }
+  VkFormat getFormat() const { return format; }
+
+  // Returns the size of the device memory allocated for the image.
+  VkDeviceSize getMemorySize() const;
+
 private:
   void generateMipmaps(cmdpool_ptr pool, queue_ptr queue, int width, int height,
                        int layers, int mipLevels);
@@ -56,6 +81,11 @@ private:
   device_ptr dev;
   VkImage img = VK_NULL_HANDLE;
   VmaAllocation mem = VK_NULL_HANDLE;
+  int width = 0;
+  int height = 0;
+  int layers = 1;
+  int mipLevels = 1;
+  VkFormat format = VK_FORMAT_UNDEFINED;
 };
 
 } // namespace cst::vlk
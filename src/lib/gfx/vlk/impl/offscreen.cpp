@@ -0,0 +1,94 @@
+/*
+ Copyright (c) 2022 Tero Oinas
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+#include "offscreen.h"
+#include "buffer.h"
+#include "image.h"
+
+#include <cstring>
+
+using namespace cst::vlk;
+
+OffscreenChain::OffscreenChain(device_ptr dev, VkExtent2D const &size,
+                               size_t numImages)
+    : dev(dev), size(size) {
+  for (size_t i = 0; i < numImages; i++) {
+    images.push_back(std::make_unique<ImageVlk>(
+        dev, size, format,
+        (VkImageUsageFlagBits)(VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+                               VK_IMAGE_USAGE_TRANSFER_SRC_BIT),
+        VK_SAMPLE_COUNT_1_BIT));
+
+    VkImageViewCreateInfo info = {};
+    info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    info.image = *images.back();
+    info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    info.format = format;
+    info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    info.subresourceRange.levelCount = 1;
+    info.subresourceRange.layerCount = 1;
+
+    VkImageView view;
+    if (vkCreateImageView(*dev, &info, nullptr, &view) != VK_SUCCESS)
+      throw std::runtime_error("failed to create an image view");
+    imageViews.push_back(view);
+  }
+}
+
+OffscreenChain::~OffscreenChain() {
+  for (auto iv : imageViews)
+    vkDestroyImageView(*dev, iv, nullptr);
+}
+
+std::vector<framebuffer_ptr>
+OffscreenChain::createFramebuffers(renderpass_ptr renderPass) {
+  std::vector<framebuffer_ptr> fbs(imageViews.size());
+
+  for (size_t i = 0; i < imageViews.size(); i++) {
+    fbs[i] = std::make_shared<Framebuffer>(
+        dev, size, format, dev->getSampleCount(), *renderPass, imageViews[i]);
+  }
+
+  return fbs;
+}
+
+std::vector<uint8_t> OffscreenChain::readPixels(cmdpool_ptr pool,
+                                                queue_ptr queue,
+                                                size_t imageIdx) const {
+  size_t const bytes = size_t(size.width) * size.height * 4;
+
+  VmaAllocationCreateInfo allocInfo{};
+  allocInfo.usage = VMA_MEMORY_USAGE_GPU_TO_CPU;
+  allocInfo.requiredFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                            VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+  allocInfo.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
+  Buffer buf(dev, bytes, VK_BUFFER_USAGE_TRANSFER_DST_BIT, allocInfo);
+
+  CommandBuffer cmd(pool, true);
+  cmd.begin(true);
+  cmd.copyImage(*images[imageIdx], buf, size.width, size.height);
+  cmd.end();
+  cmd.submit(queue, true);
+
+  std::vector<uint8_t> pixels(bytes);
+  memcpy(pixels.data(), buf.getMapped(), bytes);
+  return pixels;
+}
@@ -0,0 +1,72 @@
+/*
+ Copyright (c) 2022 Tero Oinas
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+#ifndef _CST_LIB_GFX_VLK_IMPL_OFFSCREEN_H
+#define _CST_LIB_GFX_VLK_IMPL_OFFSCREEN_H
+
+#include <vulkan/vulkan.h>
+
+#include <memory>
+#include <vector>
+
+#include "commands.h"
+#include "framebuffer.h"
+#include "renderpass.h"
+
+namespace cst::vlk {
+
+class ImageVlk;
+
+/**
+ * OffscreenChain replaces a swap chain when rendering without a window. It
+ * holds the color images the frames are resolved into, and reads them back
+ * into system memory.
+ */
+class OffscreenChain {
+public:
+  OffscreenChain(device_ptr dev, VkExtent2D const &size, size_t numImages);
+  ~OffscreenChain();
+
+  size_t getNumImages() const { return images.size(); }
+  VkExtent2D getSize() const { return size; }
+  VkFormat getFormat() const { return format; }
+
+  // Create framebuffers for the images. The render pass must leave the
+  // images in TRANSFER_SRC layout.
+  std::vector<framebuffer_ptr> createFramebuffers(renderpass_ptr renderPass);
+
+  // Returns the pixels of a rendered image as RGBA8 rows.
+  std::vector<uint8_t> readPixels(cmdpool_ptr pool, queue_ptr queue,
+                                  size_t imageIdx) const;
+
+private:
+  device_ptr dev;
+  VkExtent2D size;
+  VkFormat format = VK_FORMAT_R8G8B8A8_UNORM;
+  std::vector<std::unique_ptr<ImageVlk>> images;
+  std::vector<VkImageView> imageViews;
+};
+
+typedef std::shared_ptr<OffscreenChain> offscreen_ptr;
+
+} // namespace cst::vlk
+
+#endif // _CST_LIB_GFX_VLK_IMPL_OFFSCREEN_H
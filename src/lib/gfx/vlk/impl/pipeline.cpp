@@ -22,6 +22,7 @@
 #include "pipeline.h"
 #include "math/vertex.h"
 
+#include <atomic>
 #include <iostream>
 #include <map>
 #include <memory>
@@ -32,6 +33,8 @@ static std::string shaderPath = "./shaders/bin";
 
 static std::map<std::string, shader_ptr> shaders;
 
+static std::atomic<uint32_t> nextPipelineId = 1;
+
 void cst::vlk::setShaderPath(std::string const &path) { shaderPath = path; }
 
 static shader_ptr shaderFromCache(device_ptr dev, std::string const &name) {
@@ -51,7 +54,7 @@ Pipeline::Pipeline(device_ptr dev, VkExtent2D const &size,
                    std::string const &vertShaderName,
                    std::string const &fragShaderName, bool doubleSided,
                    VkCompareOp depthCompareOp)
-    : dev(dev) {
+    : dev(dev), id(nextPipelineId++) {
   vertShader = shaderFromCache(dev, vertShaderName + ".vert.spv").get();
   fragShader = shaderFromCache(dev, fragShaderName + ".frag.spv").get();
   auto stages = setupShaderStages(*vertShader, *fragShader);
@@ -73,7 +76,7 @@ Pipeline::Pipeline(device_ptr dev, VkExtent2D const &size,
       {1, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(vertex, normal)});
   adescs.push_back({2, 0, VK_FORMAT_R32G32_SFLOAT, offsetof(vertex, texcoord)});
   adescs.push_back(
-      {3, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(vertex, tangent)});
+      {3, 0, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(vertex, tangent)});
 
   VkPipelineVertexInputStateCreateInfo input{};
   input.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
@@ -172,7 +175,7 @@ void Pipeline::setupFixed(VkExtent2D const &size,
   vps.pScissors = &scissor;
 
   ms.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-  ms.rasterizationSamples = VK_SAMPLE_COUNT_8_BIT;
+  ms.rasterizationSamples = dev->getSampleCount();
   ms.sampleShadingEnable = VK_TRUE;
   ms.minSampleShading = 0.2f; // 1.0f;
 
@@ -44,6 +44,9 @@ public:
 
   operator VkPipeline() const { return pipeline; }
 
+  // Returns a number identifying the pipeline, e.g. in sort keys.
+  uint32_t getId() const { return id; }
+
 private:
   std::vector<VkPipelineShaderStageCreateInfo>
   setupShaderStages(VkShaderModule vertModule, VkShaderModule fragModule);
@@ -57,6 +60,7 @@ private:
                   VkPipelineColorBlendStateCreateInfo &blend);
 
   device_ptr dev;
+  uint32_t id;
   Shader *vertShader = nullptr; // An unowned reference
   Shader *fragShader = nullptr; // An unowned reference
   VkPipeline pipeline = VK_NULL_HANDLE;
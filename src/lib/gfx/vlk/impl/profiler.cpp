@@ -0,0 +1,178 @@
+/*
+ Copyright (c) 2022 Tero Oinas
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+#include "profiler.h"
+
+#include <algorithm>
+#include <cassert>
+
+using namespace cst::vlk;
+using namespace cst;
+
+// Pipeline statistics counted, in the order of GpuScopeTimings.
+static const VkQueryPipelineStatisticFlags PIPELINE_STATS =
+    VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_VERTICES_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+
+static const int NUM_PIPELINE_STATS = 5;
+
+GpuProfiler::GpuProfiler(device_ptr dev, size_t numSlots)
+    : dev(dev), period(dev->getTimestampPeriod()) {
+  if (period <= 0.0f)
+    return;
+
+  bool const withStats = dev->getFeatures().pipelineStatisticsQuery &&
+                         dev->getFeatures().inheritedQueries;
+  slots.resize(numSlots);
+  for (Slot &slot : slots) {
+    slot.timestamps = std::make_shared<QueryPool>(
+        dev, VK_QUERY_TYPE_TIMESTAMP, 2 + 2 * MAX_SCOPES);
+    if (withStats)
+      slot.stats = std::make_shared<QueryPool>(
+          dev, VK_QUERY_TYPE_PIPELINE_STATISTICS, MAX_SCOPES, PIPELINE_STATS);
+    slot.scopes.reserve(MAX_SCOPES);
+  }
+}
+
+void GpuProfiler::beginFrame(CommandBuffer *cmd, int slot,
+                             uint64_t frameNumber) {
+  if (slots.empty())
+    return;
+
+  Slot &s = slots[slot];
+  s.frame = frameNumber;
+  s.scopes.clear();
+  s.open.clear();
+  s.statsActive = false;
+  if (frameNumber == 0)
+    return;
+
+  cmd->resetQueries(*s.timestamps, 0, s.timestamps->size());
+  if (s.stats != nullptr)
+    cmd->resetQueries(*s.stats, 0, s.stats->size());
+  cmd->writeTimestamp(*s.timestamps, 0, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+}
+
+void GpuProfiler::endFrame(CommandBuffer *cmd, int slot) {
+  if (slots.empty() || slots[slot].frame == 0)
+    return;
+
+  Slot &s = slots[slot];
+  while (!s.open.empty())
+    endScope(cmd, slot, s.open.back());
+  cmd->writeTimestamp(*s.timestamps, 1, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+}
+
+int GpuProfiler::beginScope(CommandBuffer *cmd, int slot,
+                            std::string const &name) {
+  if (slots.empty())
+    return -1;
+
+  Slot &s = slots[slot];
+  if (s.frame == 0 || s.scopes.size() >= MAX_SCOPES)
+    return -1;
+
+  int const scope = s.scopes.size();
+  bool const stats = s.stats != nullptr && !s.statsActive;
+  s.scopes.push_back({name, stats});
+  s.open.push_back(scope);
+
+  cmd->writeTimestamp(*s.timestamps, 2 + 2 * scope,
+                      VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+  if (stats) {
+    cmd->beginQuery(*s.stats, scope);
+    s.statsActive = true;
+  }
+  return scope;
+}
+
+void GpuProfiler::endScope(CommandBuffer *cmd, int slot, int scope) {
+  if (scope < 0)
+    return;
+
+  Slot &s = slots[slot];
+  assert(!s.open.empty() && s.open.back() == scope);
+  s.open.pop_back();
+
+  if (s.scopes[scope].stats) {
+    cmd->endQuery(*s.stats, scope);
+    s.statsActive = false;
+  }
+  cmd->writeTimestamp(*s.timestamps, 3 + 2 * scope,
+                      VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+}
+
+VkQueryPipelineStatisticFlags
+GpuProfiler::getActiveStatistics(int slot) const {
+  if (slots.empty() || !slots[slot].statsActive)
+    return 0;
+  return PIPELINE_STATS;
+}
+
+bool GpuProfiler::resolve(int slot, FrameTimings &t) {
+  if (slots.empty() || slots[slot].frame == 0)
+    return false;
+
+  Slot &s = slots[slot];
+  uint64_t const frameNumber = s.frame;
+  s.frame = 0;
+
+  uint32_t const numScopes = s.scopes.size();
+  std::vector<uint64_t> ticks(2 + 2 * numScopes);
+  if (!s.timestamps->getResults(0, ticks.size(), ticks.data()))
+    return false;
+
+  auto ms = [this](uint64_t begin, uint64_t end) {
+    return float(end - begin) * period * 1e-6f;
+  };
+
+  t.frame = frameNumber;
+  t.gpu = ms(ticks[0], ticks[1]);
+  t.gpuScopes.clear();
+
+  for (uint32_t i = 0; i < numScopes; i++) {
+    Scope const &scope = s.scopes[i];
+
+    auto it = std::find_if(
+        t.gpuScopes.begin(), t.gpuScopes.end(),
+        [&scope](GpuScopeTimings const &g) { return g.name == scope.name; });
+    if (it == t.gpuScopes.end()) {
+      GpuScopeTimings g;
+      g.name = scope.name;
+      it = t.gpuScopes.insert(t.gpuScopes.end(), g);
+    }
+    it->ms += ms(ticks[2 + 2 * i], ticks[3 + 2 * i]);
+
+    uint64_t st[NUM_PIPELINE_STATS];
+    if (!scope.stats || !s.stats->getResults(i, 1, st))
+      continue;
+
+    int64_t *const counts[NUM_PIPELINE_STATS] = {
+        &it->vertices, &it->primitives, &it->vertexShaders,
+        &it->clippedPrimitives, &it->fragmentShaders};
+    for (int j = 0; j < NUM_PIPELINE_STATS; j++)
+      *counts[j] = std::max(*counts[j], int64_t(0)) + int64_t(st[j]);
+  }
+  return true;
+}
@@ -0,0 +1,101 @@
+/*
+ Copyright (c) 2022 Tero Oinas
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+#ifndef _CST_LIB_GFX_VLK_IMPL_PROFILER_H
+#define _CST_LIB_GFX_VLK_IMPL_PROFILER_H
+
+#include "commands.h"
+#include "gfx/renderer.h"
+#include "query.h"
+
+#include <string>
+#include <vector>
+
+namespace cst::vlk {
+
+/**
+ * GpuProfiler times frames and named scopes of them on the GPU with
+ * timestamp queries, and counts pipeline statistics of the outermost
+ * scopes, if the device supports inherited queries so that the statistics
+ * include secondary command buffers. Each running frame (slot) has its own
+ * queries. The results of
+ * a slot are read without waiting when the slot is next used, a few
+ * frames later, so profiling never stalls the pipeline. Does nothing if
+ * the device does not support timestamps.
+ *
+ * The functions are not thread safe. They are called from the thread
+ * recording the command buffers.
+ */
+class GpuProfiler {
+public:
+  // Scopes recorded per frame. Scopes opened after these are not timed.
+  static constexpr uint32_t MAX_SCOPES = 256;
+
+  GpuProfiler(device_ptr dev, size_t numSlots);
+
+  // Begins profiling the frame recorded into cmd for the slot, outside of
+  // a render pass. A frame number of 0 disables profiling of the frame.
+  void beginFrame(CommandBuffer *cmd, int slot, uint64_t frameNumber);
+
+  // Ends profiling the frame. Open scopes are closed.
+  void endFrame(CommandBuffer *cmd, int slot);
+
+  // Opens a named scope. Scopes nest and are closed in reverse order.
+  // Pipeline statistics are counted for a scope if no enclosing scope
+  // counts them. Returns the scope for endScope(), -1 if not recorded.
+  // Scopes are recorded into cmd, so a render pass executing secondary
+  // command buffers must be enclosed in the scope, not contain it.
+  int beginScope(CommandBuffer *cmd, int slot, std::string const &name);
+  void endScope(CommandBuffer *cmd, int slot, int scope);
+
+  // Returns the pipeline statistics counted by the open scopes of the
+  // slot. Secondary command buffers executed in them must inherit these.
+  VkQueryPipelineStatisticFlags getActiveStatistics(int slot) const;
+
+  // Reads the results of the frame last profiled in the slot into t: the
+  // frame number, the GPU time and the scopes. Returns false if there is
+  // no frame or its results are not available yet. Either way the results
+  // are forgotten.
+  bool resolve(int slot, FrameTimings &t);
+
+private:
+  struct Scope {
+    std::string name;
+    bool stats; // pipeline statistics counted into query index
+  };
+
+  struct Slot {
+    querypool_ptr timestamps; // frame begin, end and two per scope
+    querypool_ptr stats;      // one per scope, nullptr if not supported
+    uint64_t frame = 0;       // frame profiled, 0 if none
+    std::vector<Scope> scopes;
+    std::vector<int> open; // open scopes, innermost last
+    bool statsActive = false;
+  };
+
+  device_ptr dev;
+  float period; // nanoseconds per timestamp tick
+  std::vector<Slot> slots;
+};
+
+} // namespace cst::vlk
+
+#endif // _CST_LIB_GFX_VLK_IMPL_PROFILER_H
@@ -0,0 +1,58 @@
+/*
+ Copyright (c) 2022 Tero Oinas
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+#include "query.h"
+
+#include <bit>
+#include <stdexcept>
+
+using namespace cst::vlk;
+
+QueryPool::QueryPool(device_ptr dev, VkQueryType type, uint32_t count,
+                     VkQueryPipelineStatisticFlags stats)
+    : dev(dev), count(count) {
+  VkQueryPoolCreateInfo info{};
+  info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+  info.queryType = type;
+  info.queryCount = count;
+  info.pipelineStatistics = stats;
+
+  if (type == VK_QUERY_TYPE_PIPELINE_STATISTICS)
+    valuesPerQuery = std::popcount(stats);
+
+  if (vkCreateQueryPool(*dev, &info, nullptr, &pool) != VK_SUCCESS)
+    throw std::runtime_error("failed to create a query pool");
+}
+
+QueryPool::~QueryPool() { vkDestroyQueryPool(*dev, pool, nullptr); }
+
+bool QueryPool::getResults(uint32_t first, uint32_t n,
+                           uint64_t *results) const {
+  VkDeviceSize const stride = valuesPerQuery * sizeof(uint64_t);
+  VkResult res =
+      vkGetQueryPoolResults(*dev, pool, first, n, n * stride, results, stride,
+                            VK_QUERY_RESULT_64_BIT);
+  if (res == VK_NOT_READY)
+    return false;
+  if (res != VK_SUCCESS)
+    throw std::runtime_error("failed to read query results");
+  return true;
+}
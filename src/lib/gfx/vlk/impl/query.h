@@ -0,0 +1,68 @@
+/*
+ Copyright (c) 2022 Tero Oinas
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+#ifndef _CST_LIB_GFX_VLK_IMPL_QUERY_H
+#define _CST_LIB_GFX_VLK_IMPL_QUERY_H
+
+#include "device.h"
+
+#include <memory>
+#include <vulkan/vulkan.h>
+
+namespace cst::vlk {
+
+/**
+ * QueryPool holds a number of queries of one type, e.g. timestamps. The
+ * queries are reset and written in command buffers and their results read
+ * once the commands have completed.
+ */
+class QueryPool {
+public:
+  // Pipeline statistics queries count the statistics given in stats.
+  QueryPool(device_ptr dev, VkQueryType type, uint32_t count,
+            VkQueryPipelineStatisticFlags stats = 0);
+  ~QueryPool();
+
+  operator VkQueryPool() const { return pool; }
+
+  uint32_t size() const { return count; }
+
+  // Returns the number of values in the result of a query: one for each
+  // pipeline statistic, or one for other types.
+  uint32_t getValuesPerQuery() const { return valuesPerQuery; }
+
+  // Reads the results of queries [first, first + n) as 64-bit values, in
+  // the order of the statistic bits for pipeline statistics. Does not
+  // wait: returns false if some of the results are not available.
+  bool getResults(uint32_t first, uint32_t n, uint64_t *results) const;
+
+private:
+  device_ptr dev;
+  VkQueryPool pool;
+  uint32_t count;
+  uint32_t valuesPerQuery = 1;
+};
+
+typedef std::shared_ptr<QueryPool> querypool_ptr;
+
+} // namespace cst::vlk
+
+#endif // _CST_LIB_GFX_VLK_IMPL_QUERY_H
@@ -26,10 +26,12 @@
 
 using namespace cst::vlk;
 
-RenderPass::RenderPass(device_ptr dev, VkFormat format) : dev(dev) {
+RenderPass::RenderPass(device_ptr dev, VkFormat format,
+                       VkImageLayout finalLayout)
+    : dev(dev) {
   VkAttachmentDescription color{};
   color.format = format;
-  color.samples = VK_SAMPLE_COUNT_8_BIT;
+  color.samples = dev->getSampleCount();
   color.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
   color.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
   color.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
@@ -43,7 +45,7 @@ RenderPass::RenderPass(device_ptr dev, VkFormat format) : dev(dev) {
 
   VkAttachmentDescription depth{};
   depth.format = VK_FORMAT_D32_SFLOAT;
-  depth.samples = VK_SAMPLE_COUNT_8_BIT;
+  depth.samples = dev->getSampleCount();
   depth.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
   depth.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
   depth.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
@@ -63,7 +65,7 @@ RenderPass::RenderPass(device_ptr dev, VkFormat format) : dev(dev) {
   resolve.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
   resolve.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
   resolve.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-  resolve.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+  resolve.finalLayout = finalLayout;
 
   VkAttachmentReference resolve_ref{};
   resolve_ref.attachment = 2;
@@ -33,7 +33,10 @@ namespace cst::vlk {
  */
 class RenderPass {
  public:
-  RenderPass(device_ptr dev, VkFormat format);
+  // The multisampled color is resolved into an image of the given format,
+  // which is left in finalLayout, e.g. for presenting or reading back.
+  RenderPass(device_ptr dev, VkFormat format,
+             VkImageLayout finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
   ~RenderPass();
 
   operator VkRenderPass() const { return pass; }
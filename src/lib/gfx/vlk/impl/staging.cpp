@@ -0,0 +1,103 @@
+/*
+ Copyright (c) 2022 Tero Oinas
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+#include "staging.h"
+
+using namespace cst::vlk;
+
+// Offsets are aligned for any texel block size.
+static const VkDeviceSize STAGING_ALIGNMENT = 16;
+
+StagingAllocation::~StagingAllocation() {
+  if (ring != nullptr)
+    ring->release(offset);
+}
+
+StagingRing::StagingRing(device_ptr dev, size_t capacity)
+    : dev(dev), capacity(capacity) {
+  VmaAllocationCreateInfo allocInfo{};
+  allocInfo.usage = VMA_MEMORY_USAGE_CPU_ONLY;
+  allocInfo.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
+
+  buffer = std::make_shared<Buffer>(dev, capacity,
+                                    VK_BUFFER_USAGE_TRANSFER_SRC_BIT, allocInfo);
+  mapped = static_cast<uint8_t *>(buffer->getMapped());
+}
+
+staging_ptr StagingRing::alloc(size_t size) {
+  size = (size + STAGING_ALIGNMENT - 1) & ~(STAGING_ALIGNMENT - 1);
+
+  if (size > capacity) {
+    VmaAllocationCreateInfo allocInfo{};
+    allocInfo.usage = VMA_MEMORY_USAGE_CPU_ONLY;
+    allocInfo.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
+
+    auto buf = std::make_shared<Buffer>(
+        dev, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, allocInfo);
+    return staging_ptr(new StagingAllocation(
+        nullptr, buf, 0, size, static_cast<uint8_t *>(buf->getMapped())));
+  }
+
+  std::unique_lock lock(mux);
+  int64_t offset;
+  released.wait(lock, [&] { return (offset = findSpace(size)) >= 0; });
+
+  regions.push_back({VkDeviceSize(offset), size, false});
+  head = offset + size;
+
+  return staging_ptr(
+      new StagingAllocation(this, buffer, offset, size, mapped + offset));
+}
+
+int64_t StagingRing::findSpace(size_t size) const {
+  if (regions.empty())
+    return 0;
+
+  VkDeviceSize tail = regions.front().offset;
+  if (head > tail) {
+    // Free space is after head and before tail.
+    if (head + size <= capacity)
+      return head;
+    if (size <= tail)
+      return 0;
+  } else if (head < tail && head + size <= tail) {
+    return head;
+  }
+  return -1;
+}
+
+void StagingRing::release(VkDeviceSize offset) {
+  std::scoped_lock lock(mux);
+
+  for (Region &region : regions) {
+    if (region.offset == offset && !region.released) {
+      region.released = true;
+      break;
+    }
+  }
+
+  while (!regions.empty() && regions.front().released)
+    regions.pop_front();
+  if (regions.empty())
+    head = 0;
+
+  released.notify_all();
+}
@@ -0,0 +1,108 @@
+/*
+ Copyright (c) 2022 Tero Oinas
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+#ifndef _CST_LIB_GFX_VLK_IMPL_STAGING_H
+#define _CST_LIB_GFX_VLK_IMPL_STAGING_H
+
+#include "buffer.h"
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+
+namespace cst::vlk {
+
+class StagingRing;
+
+/**
+ * StagingAllocation is a region of persistently mapped staging memory.
+ * The region is returned to its ring when the allocation is destroyed,
+ * which must not happen before the GPU has copied from it.
+ */
+class StagingAllocation {
+public:
+  ~StagingAllocation();
+
+  VkBuffer getBuffer() const { return *buffer; }
+  VkDeviceSize getOffset() const { return offset; }
+  size_t getSize() const { return size; }
+
+  // Returns the mapped memory of the region.
+  uint8_t *data() const { return ptr; }
+
+private:
+  friend class StagingRing;
+
+  StagingAllocation(StagingRing *ring, buffer_ptr buffer, VkDeviceSize offset,
+                    size_t size, uint8_t *ptr)
+      : ring(ring), buffer(buffer), offset(offset), size(size), ptr(ptr) {}
+
+  StagingRing *ring; // nullptr for a dedicated buffer
+  buffer_ptr buffer;
+  VkDeviceSize offset;
+  size_t size;
+  uint8_t *ptr;
+};
+
+typedef std::shared_ptr<StagingAllocation> staging_ptr;
+
+/**
+ * StagingRing suballocates staging memory for uploads from a single
+ * persistently mapped buffer. Regions are handed out in order around the
+ * ring and can be released in any order. The ring must outlive its
+ * allocations.
+ */
+class StagingRing {
+public:
+  StagingRing(device_ptr dev, size_t capacity);
+
+  // Allocates size bytes. Blocks until enough of the ring is free.
+  // Requests larger than the ring get a buffer of their own.
+  staging_ptr alloc(size_t size);
+
+private:
+  friend class StagingAllocation;
+
+  struct Region {
+    VkDeviceSize offset;
+    size_t size;
+    bool released;
+  };
+
+  // Returns the offset for size bytes or -1 if they don't fit now.
+  int64_t findSpace(size_t size) const;
+  void release(VkDeviceSize offset);
+
+  device_ptr dev;
+  size_t capacity;
+  buffer_ptr buffer;
+  uint8_t *mapped;
+
+  std::mutex mux;
+  std::condition_variable released;
+  std::deque<Region> regions; // in allocation order
+  VkDeviceSize head = 0;
+};
+
+} // namespace cst::vlk
+
+#endif // _CST_LIB_GFX_VLK_IMPL_STAGING_H
@@ -169,7 +169,7 @@ Swapchain::createFramebuffers(renderpass_ptr renderPass) {
 
   for (size_t i = 0; i < imageViews.size(); i++) {
     fbs[i] = std::make_shared<Framebuffer>(
-        dev, size, format, VK_SAMPLE_COUNT_8_BIT, *renderPass, imageViews[i]);
+        dev, size, format, dev->getSampleCount(), *renderPass, imageViews[i]);
   }
 
   return fbs;
@@ -21,15 +21,19 @@
  */
 #include "material.h"
 
+#include <atomic>
 #include <iostream>
 #include <map>
 
 #include "impl/commands.h"
+#include "texture.h"
 
 using namespace cst::vlk;
 
 static std::map<std::string, std::weak_ptr<Pipeline>> pipelines;
 
+static std::atomic<uint32_t> nextMaterialId = 1;
+
 void cst::vlk::clearPipelineCache() { pipelines.clear(); }
 
 static pipeline_ptr getNamed(std::string const &name) {
@@ -42,43 +46,120 @@ static pipeline_ptr getNamed(std::string const &name) {
 }
 
 MaterialVlk::MaterialVlk(material_ptr src, device_ptr dev,
-                         descpool_ptr materialPool, VkExtent2D const &viewSize,
-                         VkRenderPass renderPass, VkPipelineLayout pipeLayout)
-    : shadeMode(src->getShadeMode()), doubleSided(src->isDoubleSided()),
+                         descpool_ptr materialPool, bindless_ptr bindless,
+                         VkExtent2D const &viewSize, VkRenderPass renderPass,
+                         VkPipelineLayout pipeLayout)
+    : id(nextMaterialId++), shadeMode(src->getShadeMode()),
+      doubleSided(src->isDoubleSided()),
       albedoTex(src->getAlbedoTex()), roughnessTex(src->getRoughnessTex()),
-      normalTex(src->getNormalTex()), roughnessArm(src->isRoughnessArm()) {
+      normalTex(src->getNormalTex()), roughnessArm(src->isRoughnessArm()),
+      bindless(bindless) {
+  setName(src->getName());
   data.albedo = src->getAlbedo();
   data.metallic = src->getMetallic();
   data.roughness = src->getRoughness();
   data.ao = src->getAO();
   data.emissiveColor = src->getEmissiveColor();
 
-  buf = createUniformBuffer(dev, sizeof(MaterialData));
-  set = allocSets(1, materialPool)[0];
-
-  set->bind(BIND_MAT_UBO, buf);
+  if (bindless != nullptr) {
+    slot = bindless->addMaterial();
+  } else {
+    buf = createUniformBuffer(dev, sizeof(MaterialData));
+    set = allocSets(1, materialPool)[0];
+    set->bind(BIND_MAT_UBO, buf);
+  }
   updateUBO();
 
   bind(dev, viewSize, renderPass, pipeLayout);
+  bindTextures();
+}
 
-  if (albedoTex != nullptr && albedoTex->isStaged()) {
-    set->bindTexture((albedoTex->getLayers() == 6) ? BIND_MAT_CUBEMAP
-                                                   : BIND_MAT_ALBEDO_TEXTURE,
-                     albedoTex);
+MaterialVlk::~MaterialVlk() {
+  if (bindless != nullptr) {
+    releaseTextureSlots(nullptr);
+    bindless->removeMaterial(slot);
   }
+}
+
+// Returns tex as a TextureVlk or nullptr if it is not staged.
+static TextureVlk *stagedTexture(texture_ptr const &tex) {
+  if (tex == nullptr || !tex->isStaged())
+    return nullptr;
+  return static_cast<TextureVlk *>(tex.get());
+}
+
+void MaterialVlk::bindTextures() {
+  texture_ptr const texs[] = {albedoTex, roughnessTex, normalTex};
+
+  if (bindless != nullptr) {
+    uint32_t *const slots[] = {&data.albedoTex, &data.roughnessTex,
+                               &data.normalTex};
+    for (int i = 0; i < 3; i++) {
+      if (stagedTexture(texs[i]) != nullptr) {
+        *slots[i] = bindless->addTexture(texs[i]);
+        texSlotUsed[i] = true;
+      }
+    }
+    updateUBO();
+  } else {
+    if (albedoTex != nullptr && albedoTex->isStaged()) {
+      set->bindTexture((albedoTex->getLayers() == 6) ? BIND_MAT_CUBEMAP
+                                                     : BIND_MAT_ALBEDO_TEXTURE,
+                       albedoTex);
+    }
 
-  if (roughnessTex != nullptr && roughnessTex->isStaged())
-    set->bindTexture(BIND_MAT_ROUGHNESS_TEXTURE, roughnessTex);
+    if (roughnessTex != nullptr && roughnessTex->isStaged())
+      set->bindTexture(BIND_MAT_ROUGHNESS_TEXTURE, roughnessTex);
 
-  if (normalTex != nullptr && normalTex->isStaged())
-    set->bindTexture(BIND_MAT_NORMAL_TEXTURE, normalTex);
+    if (normalTex != nullptr && normalTex->isStaged())
+      set->bindTexture(BIND_MAT_NORMAL_TEXTURE, normalTex);
+  }
+
+  for (int i = 0; i < 3; i++) {
+    TextureVlk *tex = stagedTexture(texs[i]);
+    texGenerations[i] = (tex != nullptr) ? tex->getGeneration() : 0;
+  }
 }
 
-MaterialVlk::~MaterialVlk() {}
+void MaterialVlk::rebindTextures(DeletionQueue &retired) {
+  texture_ptr const texs[] = {albedoTex, roughnessTex, normalTex};
+
+  bool changed = false;
+  for (int i = 0; i < 3; i++) {
+    TextureVlk *tex = stagedTexture(texs[i]);
+    if (tex != nullptr && tex->getGeneration() != texGenerations[i])
+      changed = true;
+  }
+
+  if (changed && bindless != nullptr) {
+    releaseTextureSlots(&retired);
+    bindTextures();
+  } else if (changed) {
+    retired.retire(set);
+    set = allocSets(1, set->getPool())[0];
+    set->bind(BIND_MAT_UBO, buf);
+    bindTextures();
+  }
+}
+
+void MaterialVlk::releaseTextureSlots(DeletionQueue *retired) {
+  uint32_t const slots[] = {data.albedoTex, data.roughnessTex, data.normalTex};
+  for (int i = 0; i < 3; i++) {
+    if (!texSlotUsed[i])
+      continue;
+
+    bool const cubeMap = (i == 0) && albedoTex->isCubeMap();
+    if (retired != nullptr)
+      retired->retire(bindless->retireTexture(slots[i], cubeMap));
+    else
+      bindless->removeTexture(slots[i], cubeMap);
+    texSlotUsed[i] = false;
+  }
+}
 
 void MaterialVlk::bind(device_ptr dev, VkExtent2D const &viewSize,
                        VkRenderPass renderPass, VkPipelineLayout pipeLayout) {
-  if (buf == nullptr)
+  if (buf == nullptr && bindless == nullptr)
     throw std::runtime_error("material not staged");
 
   bool cubeMap = albedoTex != nullptr && (albedoTex->getLayers() == 6);
@@ -87,7 +168,9 @@ void MaterialVlk::bind(device_ptr dev, VkExtent2D const &viewSize,
       cubeMap ? "cube"
               : (std::string("default") +
                  ((shadeMode == SHADE_MODE_FLAT) ? "_flat" : "_smooth"));
-  std::string fragName;
+  // Bindless variants of the fragment shaders index the textures of the
+  // material slot.
+  std::string fragName = bindless != nullptr ? "bindless_" : "";
 
   if (shadeMode == SHADE_MODE_UNSHADED)
     fragName += "unshaded";
@@ -126,21 +209,39 @@ void MaterialVlk::bind(device_ptr dev, VkExtent2D const &viewSize,
   }
 
   assert(pipeline != nullptr);
+  pipelineId = pipeline->getId();
 }
 
-void MaterialVlk::updateUBO() { buf->copyFrom(&data, sizeof(MaterialData)); }
-
-int numPipelineSwaps = 0;
+void MaterialVlk::updateUBO() {
+  if (bindless != nullptr)
+    bindless->writeMaterial(slot, data);
+  else
+    buf->copyFrom(&data, sizeof(MaterialData));
+}
 
 void MaterialVlk::buildCommands(CommandBuffer *cmd, VkPipelineLayout pipeLayout,
-                                VkPipeline *currentPipeline) const {
-  if (*pipeline != *currentPipeline) {
+                                DrawState &state) const {
+  if (state.material == this)
+    return;
+  state.material = this;
+
+  if (*pipeline != state.pipeline) {
     assert(*pipeline != nullptr);
 
-    numPipelineSwaps++;
-    *currentPipeline = *pipeline;
-    cmd->bindPipeline(pipeline);
+    state.stats.pipelineSwaps++;
+    state.pipeline = *pipeline;
+    cmd->bindPipeline(*pipeline);
+  }
+
+  for (texture_ptr const *tex : {&albedoTex, &roughnessTex, &normalTex}) {
+    if (TextureVlk *vtex = stagedTexture(*tex))
+      vtex->touch();
   }
 
-  cmd->bindDescriptorSet(DESC_SET_MATERIAL, set, pipeLayout);
+  if (bindless != nullptr)
+    cmd->pushConstants(pipeLayout, VK_SHADER_STAGE_FRAGMENT_BIT, &slot,
+                       sizeof(slot));
+  else
+    cmd->bindDescriptorSet(DESC_SET_MATERIAL, *set, pipeLayout);
+  state.stats.materialSwaps++;
 }
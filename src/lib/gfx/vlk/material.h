@@ -22,10 +22,13 @@
 #ifndef _CST_LIB_GFX_VLK_MATERIAL_H
 #define _CST_LIB_GFX_VLK_MATERIAL_H
 
+#include "bindless.h"
 #include "gfx/shader_data.h"
+#include "impl/deletion.h"
 #include "impl/descs.h"
 #include "impl/pipeline.h"
 #include "math/vec4.h"
+#include "render_queue.h"
 #include "sg/material.h"
 
 #include <memory>
@@ -35,17 +38,25 @@
 namespace cst::vlk {
 
 /**
- * Material
+ * Material. With a bindless table the material is a slot of the table
+ * selected with a push constant, otherwise a descriptor set of its own
+ * allocated from materialPool.
  */
 class MaterialVlk : public Material {
 public:
   MaterialVlk(material_ptr src, device_ptr dev, descpool_ptr materialPool,
-              VkExtent2D const &viewSize, VkRenderPass renderPass,
-              VkPipelineLayout pipeLayout);
+              bindless_ptr bindless, VkExtent2D const &viewSize,
+              VkRenderPass renderPass, VkPipelineLayout pipeLayout);
   ~MaterialVlk();
 
   bool isStaged() const override { return true; }
 
+  // Returns a number identifying the material, e.g. in sort keys.
+  uint32_t getId() const { return id; }
+
+  // Returns the id of the pipeline of the material.
+  uint32_t getPipelineId() const { return pipelineId; }
+
   /*
    * Material interface
    */
@@ -83,13 +94,31 @@ public:
   void bind(device_ptr dev, VkExtent2D const &viewSize, VkRenderPass renderPass,
             VkPipelineLayout pipeLayout);
 
-  // Update the contents of the UBO to match data (MaterialData)
+  // Update the contents of the UBO, or the bindless slot, to match data
+  // (MaterialData)
   void updateUBO();
 
+  // Binds the textures into a new descriptor set, or new bindless slots,
+  // if any of them has changed its image view since bound. The old set or
+  // slots are kept in retired until the frames using them have completed.
+  void rebindTextures(DeletionQueue &retired);
+
+  // Binds the pipeline and the descriptor set of the material unless they
+  // are already bound. A bindless material pushes its slot instead.
   void buildCommands(CommandBuffer *cmd, VkPipelineLayout pipeLayout,
-                     VkPipeline *currentPipeline) const;
+                     DrawState &state) const;
 
 private:
+  // Binds the staged textures into set, or into bindless slots, and
+  // records their generations.
+  void bindTextures();
+
+  // Frees the bindless slots of the textures, through retired if frames
+  // may still sample them.
+  void releaseTextureSlots(DeletionQueue *retired);
+
+  uint32_t id;
+  uint32_t pipelineId = 0;
   ShadeMode shadeMode;
   bool doubleSided;
   MaterialData data{};
@@ -103,6 +132,14 @@ private:
   buffer_ptr buf;
   descset_ptr set;
   descset_ptr oldSet;
+
+  // Slots of the material and its staged textures in the bindless table.
+  bindless_ptr bindless;
+  uint32_t slot = 0;
+  bool texSlotUsed[3] = {};
+
+  // TextureVlk generations of albedo, roughness and normal textures.
+  uint32_t texGenerations[3] = {};
 };
 
 // Clears the pipeline cache and destroys all the pipelines in it.
@@ -21,29 +21,19 @@
  */
 #include "mesh.h"
 
+#include <atomic>
 #include <iostream>
 
 using namespace cst::vlk;
 using namespace cst;
 
-MeshVlk::MeshVlk(mesh_ptr mesh, device_ptr dev, cmdpool_ptr cmdPool,
-                 descpool_ptr materialPool, queue_ptr queue)
-    : Mesh(mesh) {
-  std::vector<vertex> const &vertices = mesh->getVertices();
-  std::vector<uint32_t> const &indices = mesh->getIndices();
-  numIndices = indices.size();
+static std::atomic<uint32_t> nextMeshId = 1;
 
-  vertexBuf =
-      createBufferFrom(dev, cmdPool, queue, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-                       vertices.data(), sizeof(vertices[0]) * vertices.size());
+MeshVlk::MeshVlk(mesh_ptr mesh, mesharena_ptr arena, MeshRange const &range)
+    : Mesh(mesh), id(nextMeshId++), arena(arena), range(range) {}
 
-  indexBuf =
-      createBufferFrom(dev, cmdPool, queue, VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-                       indices.data(), sizeof(indices[0]) * indices.size());
-}
-
-MeshVlk::~MeshVlk() {
-}
+// Frames drawing the mesh hold its node, so none is running anymore.
+MeshVlk::~MeshVlk() { arena->remove(range); }
 
 std::vector<vertex> const &MeshVlk::getVertices() const {
   throw std::runtime_error("MeshVlk does not have the vertices anymore");
@@ -53,22 +43,25 @@ std::vector<uint32_t> const &MeshVlk::getIndices() const {
   throw std::runtime_error("MeshVlk does not have the indices anymore");
 }
 
-int numMaterialSwaps = 0;
-
-void MeshVlk::buildCommands(CommandBuffer *cmd, VkPipelineLayout pipeLayout,
-                            Material **currentMat,
-                            VkPipeline *currentPipeline) const {
-
+MaterialVlk *MeshVlk::getMaterialVlk() const {
   MaterialVlk *mat = dynamic_cast<MaterialVlk *>(getMaterial().get());
   assert(mat != nullptr);
+  return mat;
+}
 
-  if (mat != *currentMat) {
-    numMaterialSwaps++;
-    *currentMat = mat;
+void MeshVlk::buildCommands(CommandBuffer *cmd, uint32_t numInstances,
+                            uint32_t firstInstance, DrawState &state) const {
+  if (range.block == nullptr) // empty mesh
+    return;
 
-    std::scoped_lock lock(mat->mutex());
-    mat->buildCommands(cmd, pipeLayout, currentPipeline);
+  if (state.meshBlock != range.block) {
+    state.meshBlock = range.block;
+    cmd->bindVertexBuffer(0, *range.block->vertices);
+    cmd->bindIndexBuffer(*range.block->indices);
   }
 
-  cmd->drawIndexed(vertexBuf, indexBuf, numIndices);
+  cmd->drawIndexed(range.numIndices, numInstances, firstInstance,
+                   range.firstIndex, range.firstVertex);
+  state.stats.draws++;
+  state.stats.instances += numInstances;
 }
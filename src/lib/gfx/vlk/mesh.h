@@ -23,10 +23,10 @@
 #define _CST_LIB_GFX_VLK_MESH_H
 
 #include "sg/mesh.h"
-#include "impl/buffer.h"
 #include "impl/commands.h"
 #include "impl/queue.h"
 #include "material.h"
+#include "mesh_arena.h"
 #include "math/vertex.h"
 
 #include <cassert>
@@ -35,26 +35,36 @@
 namespace cst::vlk {
 
 /**
- * MeshVlk
+ * MeshVlk is a mesh whose vertices and indices are in a range of the mesh
+ * arena.
  */
 class MeshVlk : public Mesh {
 public:
-  MeshVlk(mesh_ptr mesh, device_ptr dev, cmdpool_ptr cmdPool,
-          descpool_ptr materialPool, queue_ptr queue);
+  // range holds the geometry of the mesh uploaded by MeshArena::add().
+  MeshVlk(mesh_ptr mesh, mesharena_ptr arena, MeshRange const &range);
   ~MeshVlk();
 
   bool isStaged() const override { return true; }
 
-  void buildCommands(CommandBuffer *cmd, VkPipelineLayout pipeLayout,
-                     Material **currentMat, VkPipeline *currentPipeline) const;
+  // Returns a number identifying the mesh, e.g. in sort keys.
+  uint32_t getId() const { return id; }
+
+  // Returns the staged material of the mesh.
+  MaterialVlk *getMaterialVlk() const;
+
+  // Draws numInstances instances of the mesh starting at firstInstance of
+  // the bound instance buffer. The material must be bound. The buffers of
+  // the arena block of the mesh are bound unless they already are.
+  void buildCommands(CommandBuffer *cmd, uint32_t numInstances,
+                     uint32_t firstInstance, DrawState &state) const;
 
   std::vector<vertex> const &getVertices() const override;
   std::vector<uint32_t> const &getIndices() const override;
 
 private:
-  unsigned int numIndices;
-  buffer_ptr vertexBuf;
-  buffer_ptr indexBuf;
+  uint32_t id;
+  mesharena_ptr arena;
+  MeshRange range;
 };
 
 } // namespace cst::vlk
@@ -0,0 +1,139 @@
+/*
+ Copyright (c) 2022 Tero Oinas
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+#include "mesh_arena.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace cst::vlk;
+using namespace cst;
+
+// Size of a block unless a mesh needs a larger one: 24 MB of vertices and
+// 8 MB of indices.
+static const uint32_t BLOCK_VERTICES = 512 * 1024;
+static const uint32_t BLOCK_INDICES = 2 * 1024 * 1024;
+
+MeshArena::MeshArena(device_ptr dev) : dev(dev) {}
+
+MeshRange MeshArena::allocate(uint32_t numVertices, uint32_t numIndices) {
+  std::scoped_lock lock(mux);
+
+  MeshRange range;
+  range.numVertices = numVertices;
+  range.numIndices = numIndices;
+  if (numVertices == 0 && numIndices == 0)
+    return range;
+
+  for (auto &block : blocks) {
+    int64_t firstVertex = block->vertexSpace.alloc(numVertices);
+    if (firstVertex < 0)
+      continue;
+
+    int64_t firstIndex = block->indexSpace.alloc(numIndices);
+    if (firstIndex < 0) {
+      block->vertexSpace.release(firstVertex, numVertices);
+      continue;
+    }
+
+    range.block = block.get();
+    range.firstVertex = firstVertex;
+    range.firstIndex = firstIndex;
+    return range;
+  }
+
+  uint32_t vertexCap = std::max(BLOCK_VERTICES, numVertices);
+  uint32_t indexCap = std::max(BLOCK_INDICES, numIndices);
+
+  VmaAllocationCreateInfo allocInfo{};
+  allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+
+  auto block = std::make_unique<MeshBlock>(MeshBlock{
+      std::make_shared<Buffer>(dev, sizeof(vertex) * vertexCap,
+                               VK_BUFFER_USAGE_VERTEX_BUFFER_BIT |
+                                   VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                               allocInfo),
+      std::make_shared<Buffer>(dev, sizeof(uint32_t) * indexCap,
+                               VK_BUFFER_USAGE_INDEX_BUFFER_BIT |
+                                   VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                               allocInfo),
+      FreeList(vertexCap), FreeList(indexCap)});
+
+  range.block = block.get();
+  range.firstVertex = block->vertexSpace.alloc(numVertices);
+  range.firstIndex = block->indexSpace.alloc(numIndices);
+  blocks.push_back(std::move(block));
+  return range;
+}
+
+staging_ptr MeshArena::stage(StagingRing &staging,
+                             std::vector<vertex> const &vertices,
+                             std::vector<uint32_t> const &indices) {
+  size_t vertexSize = sizeof(vertex) * vertices.size();
+  size_t indexSize = sizeof(uint32_t) * indices.size();
+  if (vertexSize + indexSize == 0)
+    return nullptr;
+
+  staging_ptr src = staging.alloc(vertexSize + indexSize);
+  std::memcpy(src->data(), vertices.data(), vertexSize);
+  std::memcpy(src->data() + vertexSize, indices.data(), indexSize);
+  return src;
+}
+
+void MeshArena::add(std::vector<MeshUpload> &uploads, cmdpool_ptr pool,
+                    queue_ptr queue) {
+  CommandBuffer cmd(pool, true);
+  cmd.begin(true);
+  bool copies = false;
+
+  for (MeshUpload &u : uploads) {
+    u.range = allocate(u.numVertices, u.numIndices);
+    if (u.src == nullptr)
+      continue;
+
+    size_t vertexSize = sizeof(vertex) * u.numVertices;
+    size_t indexSize = sizeof(uint32_t) * u.numIndices;
+    if (vertexSize > 0)
+      cmd.copyBuffer(u.src->getBuffer(), *u.range.block->vertices,
+                     VkBufferCopy{u.src->getOffset(),
+                                  sizeof(vertex) * u.range.firstVertex,
+                                  vertexSize});
+    if (indexSize > 0)
+      cmd.copyBuffer(u.src->getBuffer(), *u.range.block->indices,
+                     VkBufferCopy{u.src->getOffset() + vertexSize,
+                                  sizeof(uint32_t) * u.range.firstIndex,
+                                  indexSize});
+    copies = true;
+  }
+
+  cmd.end();
+  if (copies)
+    cmd.submit(queue, true);
+}
+
+void MeshArena::remove(MeshRange const &range) {
+  if (range.block == nullptr)
+    return;
+
+  std::scoped_lock lock(mux);
+  range.block->vertexSpace.release(range.firstVertex, range.numVertices);
+  range.block->indexSpace.release(range.firstIndex, range.numIndices);
+}
@@ -0,0 +1,108 @@
+/*
+ Copyright (c) 2022 Tero Oinas
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+#ifndef _CST_LIB_GFX_VLK_MESH_ARENA_H
+#define _CST_LIB_GFX_VLK_MESH_ARENA_H
+
+#include "core/free_list.h"
+#include "impl/buffer.h"
+#include "impl/staging.h"
+#include "math/vertex.h"
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace cst::vlk {
+
+// A pair of device local vertex and index buffers shared by many meshes.
+struct MeshBlock {
+  buffer_ptr vertices;
+  buffer_ptr indices;
+  FreeList vertexSpace; // in vertices
+  FreeList indexSpace;  // in indices
+};
+
+// The vertices and indices of a mesh in a block of the arena. The indices
+// are relative to firstVertex.
+struct MeshRange {
+  MeshBlock *block = nullptr;
+  uint32_t firstVertex = 0;
+  uint32_t numVertices = 0;
+  uint32_t firstIndex = 0;
+  uint32_t numIndices = 0;
+};
+
+// The geometry of a mesh in staging memory from MeshArena::stage() and the
+// range add() copies it into.
+struct MeshUpload {
+  staging_ptr src;
+  uint32_t numVertices = 0;
+  uint32_t numIndices = 0;
+  MeshRange range;
+};
+
+/**
+ * MeshArena holds the geometry of all staged meshes in a few large blocks
+ * of vertex and index buffers, so that draws of different meshes share the
+ * bound buffers. Meshes are uploaded through a staging ring in batches. A new
+ * block is created when a mesh doesn't fit in the existing ones.
+ */
+class MeshArena {
+public:
+  MeshArena(device_ptr dev);
+
+  // Copies vertices followed by indices into staging memory for add().
+  // Returns nullptr for an empty mesh. Blocks until the ring has space, so
+  // it must not be called on a queue worker that releases staging regions.
+  static staging_ptr stage(StagingRing &staging,
+                           std::vector<vertex> const &vertices,
+                           std::vector<uint32_t> const &indices);
+
+  // Returns the staging memory stage() uses for a mesh.
+  static size_t stagingSize(std::vector<vertex> const &vertices,
+                            std::vector<uint32_t> const &indices) {
+    return sizeof(vertex) * vertices.size() +
+           sizeof(uint32_t) * indices.size();
+  }
+
+  // Allocates the ranges of the uploads and copies the meshes into them
+  // with a single submit on the queue. Returns when the copies have
+  // completed. Empty meshes get a range without a block.
+  void add(std::vector<MeshUpload> &uploads, cmdpool_ptr pool,
+           queue_ptr queue);
+
+  // Frees the range of a mesh no running frame draws.
+  void remove(MeshRange const &range);
+
+private:
+  MeshRange allocate(uint32_t numVertices, uint32_t numIndices);
+
+  device_ptr dev;
+  std::mutex mux;
+  std::vector<std::unique_ptr<MeshBlock>> blocks;
+};
+
+typedef std::shared_ptr<MeshArena> mesharena_ptr;
+
+} // namespace cst::vlk
+
+#endif // _CST_LIB_GFX_VLK_MESH_ARENA_H
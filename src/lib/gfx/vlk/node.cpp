@@ -21,57 +21,9 @@
  */
 #include "node.h"
 
-#include <iostream>
-
 using namespace cst::vlk;
 using namespace cst;
 
-NodeVlk::NodeVlk(node_ptr node, descpool_ptr descPool, int numImages)
-    : Node(node) {
-  sets = allocSets(numImages, descPool);
-  createBuffers(descPool->getDevice(), numImages);
-
-  for (int i = 0; i < numImages; i++)
-    copyTransformToBuffer(i);
-}
+NodeVlk::NodeVlk(node_ptr node) : Node(node) {}
 
 NodeVlk::~NodeVlk() {}
-
-void NodeVlk::createBuffers(device_ptr dev, size_t numImages) {
-  bufs.resize(numImages);
-  for (size_t i = 0; i < numImages; i++) {
-    bufs[i] = createUniformBuffer(dev, sizeof(NodeData), true);
-    sets[i]->bind(BIND_NODE_UBO, bufs[i]);
-  }
-}
-
-void NodeVlk::updateGlobalTransform(mat4 const &p) {
-  Node::updateGlobalTransform(p);
-
-  data.transform = getGlobalTransform();
-}
-
-void NodeVlk::copyTransformToBuffer(int imageIdx) {
-  assert(imageIdx < (int)bufs.size());
-  bufs[imageIdx]->copyDirectFrom(&data, sizeof(NodeData));
-}
-
-void NodeVlk::buildCommands(CommandBuffer *cmd, int imageIdx,
-                            VkPipelineLayout pipeLayout, mat4 const &viewProj,
-                            Material **currentMat,
-                            VkPipeline *currentPipeline) const {
-  assert(imageIdx < (int)bufs.size());
-
-  cmd->bindDescriptorSet(DESC_SET_NODE, sets[imageIdx], pipeLayout);
-
-  const NodeData *nd = &data;
-
-  forMeshes(
-      [viewProj, nd, cmd, pipeLayout, currentMat, currentPipeline](mesh_ptr m) {
-        MeshVlk *mesh = dynamic_cast<MeshVlk *>(m.get());
-        assert(mesh != nullptr);
-        std::scoped_lock lock(mesh->mutex());
-
-        mesh->buildCommands(cmd, pipeLayout, currentMat, currentPipeline);
-      });
-}
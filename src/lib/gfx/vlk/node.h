@@ -28,30 +28,15 @@
 namespace cst::vlk {
 
 /**
- * NodeVlk
+ * NodeVlk is a staged node. Its global transform is written into the
+ * instance buffer of each frame it is drawn in.
  */
 class NodeVlk : public Node {
 public:
-  NodeVlk(node_ptr node, descpool_ptr descPool, int numImages);
+  NodeVlk(node_ptr node);
   ~NodeVlk();
 
   bool isStaged() const override { return true; }
-
-  void updateGlobalTransform(mat4 const &p) override;
-
-  // Copies global transform to the UBO of imageIdx.
-  void copyTransformToBuffer(int imageIdx);
-
-  void buildCommands(CommandBuffer *cmd, int imageIdx,
-                     VkPipelineLayout pipeLayout, mat4 const &viewProj,
-                     Material **currentMat, VkPipeline *currentPipeline) const;
-
-private:
-  void createBuffers(device_ptr dev, size_t numImages);
-
-  NodeData data{};
-  std::vector<descset_ptr> sets;
-  std::vector<buffer_ptr> bufs;
 };
 
 } // namespace cst::vlk
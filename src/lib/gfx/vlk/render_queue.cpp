@@ -0,0 +1,72 @@
+/*
+ Copyright (c) 2022 Tero Oinas
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+#include "render_queue.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace cst::vlk;
+
+uint64_t RenderQueue::makeKey(DrawPass pass, uint32_t pipeline,
+                              uint32_t material, uint32_t mesh, float depth) {
+  // Non-negative floats order as their bits do. The top 16 bits keep the
+  // exponent and 7 bits of the mantissa.
+  float const d = std::max(depth, 0.0f);
+  uint32_t bits;
+  std::memcpy(&bits, &d, sizeof(bits));
+
+  return (uint64_t(pass & 0xf) << 60) | (uint64_t(pipeline & 0xfff) << 48) |
+         (uint64_t(material & 0xffff) << 32) | (uint64_t(mesh & 0xffff) << 16) |
+         (bits >> 16);
+}
+
+void RenderQueue::sort() {
+  size_t const n = draws.size();
+  if (n < 2)
+    return;
+
+  // Bytes that are the same in all keys need no pass.
+  uint64_t diff = 0;
+  for (Draw const &d : draws)
+    diff |= d.key ^ draws[0].key;
+
+  sorted.resize(n);
+  for (int shift = 0; shift < 64; shift += 8) {
+    if (((diff >> shift) & 0xff) == 0)
+      continue;
+
+    size_t offsets[256] = {};
+    for (Draw const &d : draws)
+      offsets[(d.key >> shift) & 0xff]++;
+
+    size_t sum = 0;
+    for (size_t &o : offsets) {
+      size_t const count = o;
+      o = sum;
+      sum += count;
+    }
+
+    for (Draw const &d : draws)
+      sorted[offsets[(d.key >> shift) & 0xff]++] = d;
+    draws.swap(sorted);
+  }
+}
@@ -0,0 +1,90 @@
+/*
+ Copyright (c) 2022 Tero Oinas
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+#ifndef _CST_LIB_GFX_VLK_RENDER_QUEUE_H
+#define _CST_LIB_GFX_VLK_RENDER_QUEUE_H
+
+#include "gfx/renderer.h"
+
+#include <cstdint>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace cst::vlk {
+
+class MaterialVlk;
+class MeshVlk;
+struct MeshBlock;
+
+// Passes of a frame in the order they are drawn.
+enum DrawPass { DRAW_PASS_OPAQUE = 0, DRAW_PASS_SKYBOX };
+
+// A draw of a mesh of a node. transform indexes the global transforms of
+// the visible nodes of the frame.
+struct Draw {
+  uint64_t key;
+  uint32_t transform;
+  MeshVlk *mesh;
+  MaterialVlk *material;
+
+  DrawPass getPass() const { return DrawPass(key >> 60); }
+};
+
+// State bound while recording draws into a command buffer, so that binds
+// of the state already bound are skipped, and the number of binds made.
+struct DrawState {
+  MaterialVlk const *material = nullptr;
+  VkPipeline pipeline = VK_NULL_HANDLE;
+  MeshBlock const *meshBlock = nullptr;
+  DrawStats stats;
+};
+
+/**
+ * RenderQueue holds the draws of a frame sorted by a 64-bit key of pass,
+ * pipeline, material, mesh and depth, from the most significant bits
+ * down. Draws sharing a pipeline and a material are recorded together and
+ * draws of a mesh front to back.
+ */
+class RenderQueue {
+public:
+  // Returns the sort key of a draw. The ids are truncated, which only
+  // makes draws of different states sort together. depth is the distance
+  // from the viewer.
+  static uint64_t makeKey(DrawPass pass, uint32_t pipeline, uint32_t material,
+                          uint32_t mesh, float depth);
+
+  void clear() { draws.clear(); }
+  void add(Draw const &draw) { draws.push_back(draw); }
+
+  // Sorts the draws by their keys with a radix sort. The order of draws
+  // with equal keys is kept.
+  void sort();
+
+  std::vector<Draw> const &getDraws() const { return draws; }
+
+private:
+  std::vector<Draw> draws;
+  std::vector<Draw> sorted;
+};
+
+} // namespace cst::vlk
+
+#endif // _CST_LIB_GFX_VLK_RENDER_QUEUE_H
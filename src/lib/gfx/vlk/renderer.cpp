@@ -21,12 +21,20 @@
  */
 #include "renderer.h"
 #include "canvas.h"
+#include "core/parallel.h"
 #include "impl/image.h"
 #include "node.h"
+#include "sg/texture_cache.h"
+#include "support/stb_image_write.h"
 #include "texture.h"
 
 #include <SDL_vulkan.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <exception>
 #include <iostream>
+#include <unordered_map>
 
 #ifndef BUILD_TYPE
 #define BUILD_TYPE "Debug"
@@ -38,10 +46,39 @@ using namespace cst::vlk;
 namespace cst::vlk {
 
 static const int NUM_MATERIAL_SETS = 2000;
-static const int NUM_NODE_SETS = 20000;
+
+// Capacity of the bindless material set, unless limited by the device.
+static const uint32_t MAX_BINDLESS_TEXTURES = 16384;
+static const uint32_t MAX_BINDLESS_CUBEMAPS = 64;
+static const uint32_t MAX_BINDLESS_MATERIALS = 16384;
+
+// Initial number of instances in the instance buffer of a frame. The buffer
+// grows by doubling when a frame draws more.
+static const size_t MIN_INSTANCES = 1024;
+
+// Size of the staging ring for texture and mesh uploads. Larger uploads get
+// a staging buffer of their own.
+static const size_t STAGING_RING_SIZE = 64 * 1024 * 1024;
+
+// Maximum size of the geometry of meshes uploaded with one submit, unless
+// a single mesh is larger.
+static const size_t MESH_BATCH_SIZE = STAGING_RING_SIZE / 4;
+
+// Minimum number of draws recorded into a secondary command buffer.
+static const size_t MIN_DRAWS_PER_RECORD_TASK = 256;
+
+// Size of the offscreen images unless requested otherwise.
+static const ivec2 DEFAULT_OFFSCREEN_SIZE = {1280, 720};
 
 thread_local cmdpool_ptr cmdPool;
 
+// Returns the milliseconds elapsed since start.
+static float msSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<float, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
 // Handler for Window shared_ptr
 struct Window {
   Window(SDL_Window *window) : window(window) {}
@@ -64,39 +101,69 @@ struct PipelineLayout {
 } // namespace cst::vlk
 
 RendererVlk::RendererVlk(int reqWidth, int reqHeight, bool fullScreen,
-                         bool borderless, bool grabMouse)
+                         bool borderless, bool grabMouse, bool offscreen,
+                         bool useBindless)
     : dispatcher(getQueueDispatcher()) {
-  if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_EVENTS) < 0) {
-    throw std::runtime_error("failed to initialize SDL.");
-  }
-  atexit(SDL_Quit);
+  if (offscreen) {
+    // Events are still processed, e.g. to quit on a signal.
+    if (SDL_Init(SDL_INIT_EVENTS) < 0)
+      throw std::runtime_error("failed to initialize SDL.");
+    atexit(SDL_Quit);
+
+    offscreenSize = {reqWidth > 0 ? reqWidth : DEFAULT_OFFSCREEN_SIZE.x(),
+                     reqHeight > 0 ? reqHeight : DEFAULT_OFFSCREEN_SIZE.y()};
+  } else {
+    if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_EVENTS) < 0) {
+      throw std::runtime_error("failed to initialize SDL.");
+    }
+    atexit(SDL_Quit);
 
-  if (SDL_Vulkan_LoadLibrary(nullptr) == -1)
-    throw std::runtime_error("failed to load vulkan library");
+    if (SDL_Vulkan_LoadLibrary(nullptr) == -1)
+      throw std::runtime_error("failed to load vulkan library");
 
-  createWindow(reqWidth, reqHeight, fullScreen, borderless, grabMouse);
+    createWindow(reqWidth, reqHeight, fullScreen, borderless, grabMouse);
+  }
   setRenderer(this);
 
   bool validation = std::string(BUILD_TYPE) != "Release";
 
-  device = std::make_shared<Device>(window->window, validation);
+  device = std::make_shared<Device>(offscreen ? nullptr : window->window,
+                                    validation);
   cmdPool = std::make_shared<CommandPool>(device,
                                           device->getGfxQueue(0)->getFamily());
   gfxQueueDraw = device->getGfxQueue(0);
   gfxQueueUtil = device->getGfxQueue((device->numGfxQueues() > 1) ? 1 : 0);
   presentQueue = device->getPresentQueue();
 
+  Texture::setSupportedFormats(getSupportedPixelFormats(device));
+
   globalLayout = createGlobalLayout();
-  matLayout = createMaterialDescLayout();
-  nodeLayout = createNodeLayout();
+  uint32_t const bindlessImages =
+      std::min(device->getMaxBindlessImages(),
+               MAX_BINDLESS_TEXTURES + MAX_BINDLESS_CUBEMAPS);
+  if (useBindless && device->hasDescriptorIndexing() &&
+      bindlessImages > 2 * MAX_BINDLESS_CUBEMAPS) {
+    bindless = std::make_shared<BindlessTable>(
+        device, bindlessImages - MAX_BINDLESS_CUBEMAPS, MAX_BINDLESS_CUBEMAPS,
+        MAX_BINDLESS_MATERIALS);
+    matLayout = bindless->getLayout();
+    std::cout << "Using bindless materials\n";
+  } else {
+    matLayout = createMaterialDescLayout();
+    materialPool =
+        std::make_shared<DescPool>(device, matLayout, NUM_MATERIAL_SETS, 1, 0);
+  }
   createPipelineLayout();
 
-  materialPool =
-      std::make_shared<DescPool>(device, matLayout, NUM_MATERIAL_SETS, 1, 0);
-  nodePool =
-      std::make_shared<DescPool>(device, nodeLayout, NUM_NODE_SETS, 1, 1);
-
   windowResized();
+
+  profiler = std::make_unique<GpuProfiler>(device, runningFrames);
+
+  retired = std::make_unique<DeletionQueue>(runningFrames);
+  residency = std::make_unique<TextureResidency>(
+      *retired, [this](texture_ptr tex) { return loadImage(tex); });
+  staging = std::make_unique<StagingRing>(device, STAGING_RING_SIZE);
+  meshArena = std::make_shared<MeshArena>(device);
 }
 
 void RendererVlk::createWindow(int reqWidth, int reqHeight, bool fullScreen,
@@ -148,8 +215,16 @@ RendererVlk::~RendererVlk() {
   clearPipelineCache();
   clearShaderCache();
   cmds.clear();
+  secondaryCmds.clear();
+  instanceBufs.clear();
+  frameNodes.clear();
   materials.clear();
   frameBuffers.clear();
+  residency = nullptr;
+  retired = nullptr;
+  staging = nullptr;
+  meshArena = nullptr;
+  bindless = nullptr;
 }
 
 desclayout_ptr RendererVlk::createGlobalLayout() {
@@ -160,12 +235,20 @@ desclayout_ptr RendererVlk::createGlobalLayout() {
   ubo.stageFlags = VK_SHADER_STAGE_VERTEX_BIT |
                    VK_SHADER_STAGE_FRAGMENT_BIT; // VK_SHADER_STAGE_VERTEX_BIT;
 
+  VkDescriptorSetLayoutBinding instances{};
+  instances.binding = BIND_GLOBAL_INSTANCES;
+  instances.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  instances.descriptorCount = 1;
+  instances.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+
+  std::vector<VkDescriptorSetLayoutBinding> bindings{ubo, instances};
+
   VkDescriptorSetLayout layout;
 
   VkDescriptorSetLayoutCreateInfo info{};
   info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-  info.bindingCount = 1;
-  info.pBindings = &ubo;
+  info.bindingCount = bindings.size();
+  info.pBindings = bindings.data();
   if (vkCreateDescriptorSetLayout(*device, &info, nullptr, &layout) !=
       VK_SUCCESS)
     throw std::runtime_error("failed to create global descriptor set layout.");
@@ -228,41 +311,23 @@ desclayout_ptr RendererVlk::createMaterialDescLayout() {
       });
 }
 
-desclayout_ptr RendererVlk::createNodeLayout() {
-  VkDescriptorSetLayoutBinding ubo{};
-  ubo.binding = 0;
-  ubo.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-  ubo.descriptorCount = 1;
-  ubo.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
-
-  std::vector<VkDescriptorSetLayoutBinding> bindings{ubo};
-
-  VkDescriptorSetLayoutCreateInfo info{};
-  info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-  info.bindingCount = bindings.size();
-  info.pBindings = bindings.data();
-
-  VkDescriptorSetLayout nodeLayout;
-  if (vkCreateDescriptorSetLayout(*device, &info, nullptr, &nodeLayout) !=
-      VK_SUCCESS)
-    throw std::runtime_error("failed to create node descriptor set layout.");
-
-  return std::shared_ptr<VkDescriptorSetLayout>(
-      new VkDescriptorSetLayout(nodeLayout),
-      [this](VkDescriptorSetLayout *layout) {
-        vkDestroyDescriptorSetLayout(*device, *layout, nullptr);
-      });
-}
-
 void RendererVlk::createPipelineLayout() {
-  std::vector<VkDescriptorSetLayout> dls{*globalLayout, *matLayout,
-                                         *nodeLayout};
+  std::vector<VkDescriptorSetLayout> dls{*globalLayout, *matLayout};
 
   VkPipelineLayoutCreateInfo info{};
   info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
   info.setLayoutCount = dls.size();
   info.pSetLayouts = dls.data();
 
+  // The slot of the bindless material of a draw.
+  VkPushConstantRange range{};
+  range.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+  range.size = sizeof(uint32_t);
+  if (bindless != nullptr) {
+    info.pushConstantRangeCount = 1;
+    info.pPushConstantRanges = &range;
+  }
+
   VkPipelineLayout layout;
   if (vkCreatePipelineLayout(*device, &info, nullptr, &layout) != VK_SUCCESS)
     throw std::runtime_error("failed to create layout");
@@ -272,18 +337,27 @@ void RendererVlk::createPipelineLayout() {
 
 void RendererVlk::allocateGlobalSets(int runningFrames) {
   globalPool =
-      std::make_shared<DescPool>(device, globalLayout, runningFrames, 1, 0);
+      std::make_shared<DescPool>(device, globalLayout, runningFrames, 1, 0, 1);
   globalSets = allocSets(runningFrames, globalPool);
 
   // Delete old buffers
   for (size_t i = 0; i < globalBufs.size(); i++)
     globalBufs[i] = nullptr;
+  instanceBufs.clear();
 
   // Create the new buffers
   globalBufs.resize(runningFrames, nullptr);
+  instanceBufs.resize(runningFrames, nullptr);
+  instanceCapacity.assign(runningFrames, MIN_INSTANCES);
   for (size_t i = 0; i < globalBufs.size(); i++) {
     globalBufs[i] = createUniformBuffer(device, sizeof(GlobalData), true);
     globalSets[i]->bind(BIND_GLOBAL_UBO, globalBufs[i]);
+
+    instanceBufs[i] =
+        createMappedBuffer(device, MIN_INSTANCES * sizeof(InstanceData),
+                           VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+    globalSets[i]->bind(BIND_GLOBAL_INSTANCES, instanceBufs[i],
+                        VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
   }
 }
 
@@ -300,6 +374,75 @@ void RendererVlk::setLight(uint32_t n, vec3 const &pos, vec3 const &color) {
   }
 }
 
+image_ptr RendererVlk::loadImage(texture_ptr tex) {
+  // Decode straight into staging memory when the texture supports it.
+  // Otherwise load the pixels, which may have been released after an
+  // earlier staging, and copy them there.
+  staging_ptr src;
+  size_t directSize = tex->prepareDecode();
+  if (directSize > 0) {
+    src = staging->alloc(directSize);
+    tex->decodeInto(src->data());
+  } else {
+    tex->load();
+  }
+
+  // Textures with precomputed mip levels are uploaded as they are,
+  // others get a generated mip chain.
+  uint mipLevels;
+  bool precomputed = !tex->getLevels().empty();
+
+  if (precomputed)
+    mipLevels = tex->getLevels().size();
+  else if (tex->getLayers() == 1)
+    mipLevels =
+        std::max(1u, static_cast<uint32_t>(std::floor(std::log2(
+                         std::max(tex->getWidth(), tex->getHeight())))));
+  else
+    mipLevels = 1;
+
+  if (src == nullptr) {
+    size_t size;
+    if (precomputed) {
+      TextureLevel const &last = tex->getLevels().back();
+      size = last.offset + last.size * tex->getLayers();
+    } else {
+      size = size_t(tex->getWidth()) * tex->getHeight() * tex->getDepth() *
+             tex->getLayers();
+    }
+    src = staging->alloc(size);
+    memcpy(src->data(), tex->getPixels(), size);
+  }
+
+  VkFormat format = toVkFormat(tex->getFormat(), tex->getType());
+  queue_ptr gfxQueue = device->getGfxQueue(1);
+  image_ptr image;
+
+  runOnQueue(
+      gfxQueue,
+      [this, tex, &src, &image, mipLevels, precomputed, format, gfxQueue]() {
+        if (cmdPool == nullptr)
+          cmdPool =
+              std::make_shared<CommandPool>(device, gfxQueue->getFamily());
+
+        if (precomputed)
+          image = std::make_shared<ImageVlk>(device, cmdPool, gfxQueue, *src,
+                                             tex->getLevels(),
+                                             tex->getLayers(), format);
+        else
+          image = std::make_shared<ImageVlk>(
+              device, cmdPool, gfxQueue, *src, tex->getWidth(),
+              tex->getHeight(), tex->getDepth(), tex->getLayers(), format,
+              mipLevels);
+      },
+      "stage texture");
+
+  // The pixels are in device memory now, the copy has completed. The
+  // staging region is released with src.
+  tex->unload();
+  return image;
+}
+
 /**
  * Use queueWorker to call these.
  */
@@ -307,65 +450,37 @@ texture_ptr RendererVlk::stage(texture_ptr tex) {
   std::scoped_lock lock(tex->mutex());
 
   if (!tex->isStaged()) {
-    texture_ptr texv = Texture::getNamed(tex->getName());
+    texture_ptr texv = getTextureCache().find(tex->getName(), tex->getType());
 
     if (texv != nullptr && texv->isStaged()) {
       std::cout << "Returning from texture " << tex->getName() << "\n";
       return texv;
     } else {
-
-      uint mipLevels;
-
-      if (tex->getLayers() == 1)
-        mipLevels =
-            std::max(1u, static_cast<uint32_t>(std::floor(std::log2(
-                             std::max(tex->getWidth(), tex->getHeight())))));
-      else
-        mipLevels = 1;
+      int const layers = tex->getLayers();
+      TextureType const type = tex->getType();
+      image_ptr image = loadImage(tex);
+      int const mipLevels = image->getMipLevels();
 
       sampler_ptr sampler;
-      std::string samplerName = (tex->getLayers() == 6 ? "edge_" : "repeat_") +
-                                std::to_string(mipLevels);
+      std::string samplerName =
+          (layers == 6 ? "edge_" : "repeat_") + std::to_string(mipLevels);
 
       if (samplers.count(samplerName) > 0)
         sampler = samplers[samplerName];
       else {
         sampler = std::make_shared<SamplerVlk>(
             device, mipLevels,
-            (tex->getLayers() == 6) ? VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE
-                                    : VK_SAMPLER_ADDRESS_MODE_REPEAT);
+            (layers == 6) ? VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE
+                          : VK_SAMPLER_ADDRESS_MODE_REPEAT);
         samplers[samplerName] = sampler;
       }
 
-      std::mutex m;
-      std::condition_variable cv;
-
-      queue_ptr gfxQueue = device->getGfxQueue(1);
-
-      dispatcher->add(
-          [this, tex, mipLevels, sampler, gfxQueue, &cv, &texv]() {
-            if (cmdPool == nullptr)
-              cmdPool =
-                  std::make_shared<CommandPool>(device, gfxQueue->getFamily());
-
-            image_ptr image = std::make_shared<ImageVlk>(
-                device, cmdPool, gfxQueue, tex->getPixels(), tex->getWidth(),
-                tex->getHeight(), tex->getDepth(), tex->getLayers(),
-                (tex->getType() == TEXTURE_TYPE_ALBEDO)
-                    ? VK_FORMAT_R8G8B8A8_SRGB
-                    : VK_FORMAT_R8G8B8A8_UNORM,
-                mipLevels);
-
-            texv = std::make_shared<TextureVlk>(device, tex->getName(), image,
-                                                sampler, tex->getLayers(),
-                                                mipLevels, tex->getType());
-            Texture::storeNamed(texv);
-            cv.notify_all();
-          },
-          gfxQueue, "stage texture");
-
-      std::unique_lock lock(m);
-      cv.wait(lock);
+      auto vtex = std::make_shared<TextureVlk>(device, tex->getName(), image,
+                                               sampler, layers, mipLevels,
+                                               type, image->getFormat());
+      residency->add(vtex, tex);
+      texv = vtex;
+      getTextureCache().store(texv);
       return texv;
     }
   }
@@ -387,7 +502,10 @@ material_ptr RendererVlk::stage(material_ptr mat) {
       mat->setNormalTex(stage(mat->getNormalTex()));
 
     std::shared_ptr<MaterialVlk> vmat = std::make_shared<MaterialVlk>(
-        mat, device, materialPool, canvas->getSize(), *renderPass, *pipeLayout);
+        mat, device, materialPool, bindless, canvas->getSize(), *renderPass,
+        *pipeLayout);
+
+    std::scoped_lock mlock(materialsMux);
     materials.insert(vmat);
     return vmat;
   }
@@ -403,31 +521,89 @@ mesh_ptr RendererVlk::stage(mesh_ptr mesh) {
     staged = mesh->isStaged();
   }
 
-  if (!staged) {
-    std::mutex m;
-    std::unique_lock lock(m);
-    std::condition_variable cv;
+  if (!staged)
+    mesh = stage(std::vector<mesh_ptr>{mesh}).front();
+  return mesh;
+}
 
-    queue_ptr gfxQueue = device->getGfxQueue(1);
+std::vector<mesh_ptr> RendererVlk::stage(std::vector<mesh_ptr> const &meshes) {
+  std::vector<mesh_ptr> out;
+  out.reserve(meshes.size());
 
-    dispatcher->add(
-        [this, &cv, &mesh, gfxQueue]() {
-          if (cmdPool == nullptr) {
+  queue_ptr gfxQueue = device->getGfxQueue(1);
+  std::vector<mesh_ptr> batchMeshes;
+  std::vector<MeshUpload> batch;
+  size_t batchSize = 0;
+
+  auto submit = [&]() {
+    runOnQueue(
+        gfxQueue,
+        [this, &batch, gfxQueue]() {
+          if (cmdPool == nullptr)
             cmdPool =
                 std::make_shared<CommandPool>(device, gfxQueue->getFamily());
-          }
-
-          mesh = std::make_shared<MeshVlk>(mesh, device, cmdPool, materialPool,
-                                           gfxQueue);
-          cv.notify_all();
+          meshArena->add(batch, cmdPool, gfxQueue);
         },
-        gfxQueue, "stage mesh");
-    cv.wait(lock);
+        "stage meshes");
+
+    for (size_t i = 0; i < batch.size(); i++)
+      out.push_back(
+          std::make_shared<MeshVlk>(batchMeshes[i], meshArena, batch[i].range));
+    batchMeshes.clear();
+    batch.clear();
+    batchSize = 0;
+  };
+
+  // The geometry is copied here, as with textures. The regions of a batch
+  // are released only once it has been submitted, so a batch takes at most
+  // a part of the ring to leave room for others.
+  for (mesh_ptr const &mesh : meshes) {
+    std::vector<vertex> const &vertices = mesh->getVertices();
+    std::vector<uint32_t> const &indices = mesh->getIndices();
+    size_t size = MeshArena::stagingSize(vertices, indices);
+    if (!batch.empty() && batchSize + size > MESH_BATCH_SIZE)
+      submit();
+
+    batchMeshes.push_back(mesh);
+    batch.push_back({MeshArena::stage(*staging, vertices, indices),
+                     uint32_t(vertices.size()), uint32_t(indices.size())});
+    batchSize += size;
+  }
+  if (!batch.empty())
+    submit();
 
+  for (mesh_ptr const &mesh : out)
     mesh->setMaterial(stage(mesh->getMaterial()));
-  }
+  return out;
+}
 
-  return mesh;
+void RendererVlk::stageMeshes(node_ptr root) {
+  // Each mesh once, as nodes may share meshes.
+  std::vector<mesh_ptr> meshes;
+  std::unordered_map<Mesh *, size_t> indexOf;
+  auto collect = [&](node_ptr node) {
+    node->forMeshes([&](mesh_ptr mesh) {
+      std::scoped_lock lock(mesh->mutex());
+      if (!mesh->isStaged() &&
+          indexOf.emplace(mesh.get(), meshes.size()).second)
+        meshes.push_back(mesh);
+    });
+  };
+  collect(root);
+  root->forEach(collect, true);
+
+  if (meshes.empty())
+    return;
+
+  std::vector<mesh_ptr> staged = stage(meshes);
+  auto replace = [&](node_ptr node) {
+    node->mapMeshes([&](mesh_ptr mesh) {
+      auto it = indexOf.find(mesh.get());
+      return it == indexOf.end() ? mesh : staged[it->second];
+    });
+  };
+  replace(root);
+  root->forEach(replace, true);
 }
 
 node_ptr RendererVlk::stage(node_ptr node) {
@@ -437,7 +613,7 @@ node_ptr RendererVlk::stage(node_ptr node) {
     if (node->numMeshes() > 0) {
       node->mapMeshes([this](mesh_ptr mesh) { return stage(mesh); });
 
-      return std::make_shared<NodeVlk>(node, nodePool, runningFrames);
+      return std::make_shared<NodeVlk>(node);
     }
   }
 
@@ -446,8 +622,14 @@ node_ptr RendererVlk::stage(node_ptr node) {
 
 void RendererVlk::windowResized() {
   int wndWidth, wndHeight;
-  SDL_GetWindowSize(window->window, &wndWidth, &wndHeight);
-  std::cout << "Window size: " << wndWidth << "x" << wndHeight << "\n";
+  if (window != nullptr) {
+    SDL_GetWindowSize(window->window, &wndWidth, &wndHeight);
+    std::cout << "Window size: " << wndWidth << "x" << wndHeight << "\n";
+  } else {
+    wndWidth = offscreenSize.x();
+    wndHeight = offscreenSize.y();
+    std::cout << "Offscreen size: " << wndWidth << "x" << wndHeight << "\n";
+  }
 
   if (canvas != nullptr)
     canvas->waitFences();
@@ -457,6 +639,7 @@ void RendererVlk::windowResized() {
     std::scoped_lock lock(canvas->mutex());
     clearPipelineCache();
     cmds.clear();
+    secondaryCmds.clear();
 
     canvas->resized(device->getSurface(), {wndWidth, wndHeight});
     if (canvas->getNumImages() != numImages)
@@ -465,9 +648,7 @@ void RendererVlk::windowResized() {
       throw std::runtime_error("number of running frames changed");
     runningFrames = canvas->getRunningFrames();
 
-    cmds.resize(runningFrames, nullptr);
-    for (size_t i = 0; i < runningFrames; i++)
-      cmds[i] = std::make_shared<CommandBuffer>(cmdPool, false);
+    createFrameCommands();
 
   } else {
     canvas =
@@ -477,9 +658,8 @@ void RendererVlk::windowResized() {
 
     allocateGlobalSets(runningFrames);
 
-    cmds.resize(runningFrames, nullptr);
-    for (size_t i = 0; i < runningFrames; i++)
-      cmds[i] = std::make_shared<CommandBuffer>(cmdPool, false);
+    createFrameCommands();
+    frameNodes.resize(runningFrames);
   }
 
   for (size_t i = drawMutex.size(); i < runningFrames; i++) {
@@ -488,58 +668,264 @@ void RendererVlk::windowResized() {
     drawOn.push_back(false);
   }
 
-  renderPass =
-      std::make_shared<RenderPass>(device, canvas->getSwapchain()->getFormat());
+  renderPass = std::make_shared<RenderPass>(device, canvas->getFormat(),
+                                            canvas->getFinalLayout());
 
-  frameBuffers = canvas->getSwapchain()->createFramebuffers(renderPass);
+  frameBuffers = canvas->createFramebuffers(renderPass);
 
   VkExtent2D const &extent = canvas->getSize();
   viewSize = {(int)extent.width, (int)extent.height};
 
+  std::scoped_lock mlock(materialsMux);
   for (std::shared_ptr<MaterialVlk> mat : materials) {
     std::scoped_lock lock(mat->mutex());
     mat->bind(device, extent, *renderPass, *pipeLayout);
   }
 }
 
-void RendererVlk::buildCommands(int frame, int imageIdx, vec4 const &clearColor,
-                                std::vector<node_ptr> const &nodes,
-                                mat4 const &viewProj) {
-  CommandBuffer *cmd = cmds[frame].get();
+void RendererVlk::createFrameCommands() {
+  cmds.resize(runningFrames, nullptr);
+  for (size_t i = 0; i < runningFrames; i++) {
+    auto pool =
+        std::make_shared<CommandPool>(device, gfxQueueDraw->getFamily());
+    cmds[i] = std::make_shared<CommandBuffer>(pool, false);
+  }
+  secondaryCmds.resize(runningFrames);
+}
 
-  cmd->create();
-  cmd->begin(true);
+void RendererVlk::updateTextures(uint64_t frameNumber) {
+  if (cmdPool == nullptr)
+    cmdPool = std::make_shared<CommandPool>(device, gfxQueueDraw->getFamily());
 
-  cmd->beginRenderPass(*renderPass, *frameBuffers[imageIdx], canvas->getSize(),
-                       clearColor);
+  TextureVlk::setCurrentFrame(frameNumber);
 
-  cmd->bindDescriptorSet(DESC_SET_GLOBAL, globalSets[frame], *pipeLayout);
+  if (residency->update(frameNumber, cmdPool, gfxQueueDraw)) {
+    std::scoped_lock lock(materialsMux);
+    for (auto const &mat : materials) {
+      std::scoped_lock mlock(mat->mutex());
+      mat->rebindTextures(*retired);
+    }
+  }
+}
 
-  for (node_ptr const &node : nodes) {
-    std::scoped_lock lock(node->mutex());
+void RendererVlk::buildQueue(int frame, std::vector<node_ptr> const &nodes,
+                             mat4 const &viewProj) {
+  renderQueue.clear();
+  transforms.clear();
 
+  // The transforms are read first with the store locked, as it must not be
+  // locked while holding a node.
+  {
+    std::shared_lock<std::shared_mutex> lock;
+    if (TransformStore const *store = transformStore)
+      lock = std::shared_lock(store->mutex());
+    for (node_ptr const &node : nodes)
+      transforms.push_back(node->getGlobalTransform());
+  }
+
+  for (uint32_t transformIdx = 0; transformIdx < nodes.size();
+       transformIdx++) {
+    node_ptr const &node = nodes[transformIdx];
     std::shared_ptr<NodeVlk> nv = std::dynamic_pointer_cast<NodeVlk>(node);
     if (nv == nullptr)
       throw std::runtime_error("node " + node->getName() + " not staged");
 
-    if (nv->isVisible()) {
-      nv->copyTransformToBuffer(frame);
+    std::scoped_lock lock(nv->mutex());
+    if (!nv->isVisible())
+      continue;
+
+    // Skyboxes are drawn last, where the depth test rejects most of them.
+    DrawPass const pass =
+        nv->getName() == "skybox" ? DRAW_PASS_SKYBOX : DRAW_PASS_OPAQUE;
+    mat4 const &transform = transforms[transformIdx];
+
+    nv->forMeshes([&](mesh_ptr const &m) {
+      MeshVlk *mesh = static_cast<MeshVlk *>(m.get());
+      std::scoped_lock mlock(mesh->mutex());
+
+      MaterialVlk *mat = mesh->getMaterialVlk();
+      float const depth =
+          (viewProj * (transform * mesh->getAABB().center())).w();
+
+      renderQueue.add({RenderQueue::makeKey(pass, mat->getPipelineId(),
+                                            mat->getId(), mesh->getId(),
+                                            depth),
+                       transformIdx, mesh, mat});
+    });
+  }
+
+  renderQueue.sort();
+
+  // The frame has completed, so its instance buffer can be rewritten and
+  // one too small replaced in its global descriptor set.
+  std::vector<Draw> const &draws = renderQueue.getDraws();
+  if (draws.size() > instanceCapacity[frame]) {
+    size_t capacity = instanceCapacity[frame];
+    while (capacity < draws.size())
+      capacity *= 2;
+
+    retired->retire(instanceBufs[frame]);
+    instanceBufs[frame] =
+        createMappedBuffer(device, capacity * sizeof(InstanceData),
+                           VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+    instanceCapacity[frame] = capacity;
+    globalSets[frame]->bind(BIND_GLOBAL_INSTANCES, instanceBufs[frame],
+                            VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+  }
+
+  InstanceData *instances =
+      static_cast<InstanceData *>(instanceBufs[frame]->getMapped());
+  for (size_t i = 0; i < draws.size(); i++)
+    instances[i].transform = transforms[draws[i].transform];
+}
+
+DrawStats RendererVlk::recordDraws(CommandBuffer *cmd, int frame, size_t begin,
+                                   size_t end, bool scopes) {
+  std::vector<Draw> const &draws = renderQueue.getDraws();
+
+  cmd->bindDescriptorSet(DESC_SET_GLOBAL, *globalSets[frame], *pipeLayout);
+  if (bindless != nullptr)
+    cmd->bindDescriptorSet(DESC_SET_MATERIAL, bindless->getSet(), *pipeLayout);
+
+  // Runs of draws with the same material when profiling materials, and the
+  // skybox pass.
+  bool const materialScopes = scopes && profileMaterials;
+  MaterialVlk const *scopeMat = nullptr;
+  int scope = -1;
+  bool skybox = false;
+
+  DrawState state;
+  for (size_t i = begin; i < end;) {
+    Draw const &d = draws[i];
+
+    // Instances of the draw follow it in the sorted queue.
+    size_t n = 1;
+    while (i + n < end && draws[i + n].mesh == d.mesh &&
+           draws[i + n].material == d.material &&
+           draws[i + n].getPass() == d.getPass())
+      n++;
+
+    if (scopes && !skybox && d.getPass() == DRAW_PASS_SKYBOX) {
+      profiler->endScope(cmd, frame, scope);
+      scope = profiler->beginScope(cmd, frame, "skybox");
+      skybox = true;
+    } else if (materialScopes && !skybox && d.material != scopeMat) {
+      profiler->endScope(cmd, frame, scope);
+      scope = profiler->beginScope(cmd, frame, "material " +
+                                                   d.material->getName());
+      scopeMat = d.material;
+    }
+
+    if (d.material != state.material) {
+      std::scoped_lock lock(d.material->mutex());
+      d.material->buildCommands(cmd, *pipeLayout, state);
+    }
+    d.mesh->buildCommands(cmd, n, i, state);
+    i += n;
+  }
+
+  profiler->endScope(cmd, frame, scope);
+  return state.stats;
+}
+
+void RendererVlk::buildCommands(int frame, int imageIdx, uint64_t profileFrame,
+                                vec4 const &clearColor,
+                                std::vector<node_ptr> const &nodes,
+                                mat4 const &viewProj) {
+  CommandBuffer *cmd = cmds[frame].get();
+
+  buildQueue(frame, nodes, viewProj);
+  size_t const numDraws = renderQueue.getDraws().size();
+
+  // Scopes are written into the primary command buffer, so profiling
+  // materials records serially. The skybox is profiled only when recording
+  // serially anyway.
+  size_t numTasks = 1;
+  if (profileFrame == 0 || !profileMaterials) {
+    size_t const threads = recordThreads;
+    numTasks = parallelTasks(numDraws, MIN_DRAWS_PER_RECORD_TASK);
+    if (threads > 0)
+      numTasks = std::min(numTasks, threads);
+  }
+
+  cmd->getPool()->reset();
+  cmd->begin(true);
 
-      Material *currentMat = nullptr;
-      VkPipeline currentPipeline = nullptr;
+  profiler->beginFrame(cmd, frame, profileFrame);
 
-      nv->buildCommands(cmd, frame, *pipeLayout.get(), viewProj, &currentMat,
-                        &currentPipeline);
+  // The render pass scope is written outside of the pass: a subpass with
+  // secondary command buffers takes no other commands than executing
+  // them, and the secondaries inherit the statistics query.
+  int const passScope = profiler->beginScope(cmd, frame, "renderPass");
+  cmd->beginRenderPass(*renderPass, *frameBuffers[imageIdx], canvas->getSize(),
+                       clearColor, numTasks > 1);
+
+  DrawStats stats;
+  if (numTasks > 1) {
+    std::vector<cmdbuf_ptr> &secondaries = secondaryCmds[frame];
+    while (secondaries.size() < numTasks) {
+      auto pool =
+          std::make_shared<CommandPool>(device, gfxQueueDraw->getFamily());
+      secondaries.push_back(std::make_shared<CommandBuffer>(pool, false, true));
     }
+
+    std::vector<cmdbuf_ptr> used(secondaries.begin(),
+                                 secondaries.begin() + numTasks);
+    std::vector<DrawStats> taskStats(numTasks);
+    VkQueryPipelineStatisticFlags const queryStats =
+        profiler->getActiveStatistics(frame);
+    size_t const perTask = (numDraws + numTasks - 1) / numTasks;
+
+    parallelFor(numTasks, 1, [&](size_t first, size_t last, size_t) {
+      for (size_t t = first; t < last; t++) {
+        CommandBuffer *sec = used[t].get();
+        sec->getPool()->reset();
+        sec->beginSecondary(*renderPass, *frameBuffers[imageIdx], queryStats);
+        taskStats[t] = recordDraws(sec, frame, std::min(t * perTask, numDraws),
+                                   std::min((t + 1) * perTask, numDraws),
+                                   false);
+        sec->end();
+      }
+    });
+
+    cmd->executeCommands(used);
+    for (DrawStats const &s : taskStats)
+      stats += s;
+  } else {
+    stats = recordDraws(cmd, frame, 0, numDraws, profileFrame != 0);
   }
 
   cmd->endRenderPass();
+  profiler->endScope(cmd, frame, passScope);
+
+  profiler->endFrame(cmd, frame);
   cmd->end();
+
+  std::scoped_lock lock(timingsMux);
+  drawStats = stats;
+  auto it = timings.find(profileFrame);
+  if (it != timings.end())
+    it->second.draws = stats;
+}
+
+void RendererVlk::resolveTimings(int frame) {
+  FrameTimings gpu;
+  if (!profiler->resolve(frame, gpu))
+    return;
+
+  std::scoped_lock lock(timingsMux);
+  auto it = timings.find(gpu.frame);
+  if (it != timings.end()) {
+    it->second.gpu = gpu.gpu;
+    it->second.gpuScopes = std::move(gpu.gpuScopes);
+  }
 }
 
 void RendererVlk::render(std::vector<node_ptr> const &nodes) {
   int frame = totalFrames % runningFrames;
-  totalFrames++;
+  uint64_t frameNumber = ++totalFrames;
+  bool const timed = recordTimings;
+  auto const acquireStart = std::chrono::steady_clock::now();
 
   int imageIdx;
   {
@@ -564,9 +950,26 @@ void RendererVlk::render(std::vector<node_ptr> const &nodes) {
     cv.wait(lock);
   }
 
+  if (timed) {
+    std::scoped_lock lock(timingsMux);
+    FrameTimings &t = timings[frameNumber];
+    t.frame = frameNumber;
+    t.presentWait = msSince(acquireStart);
+  }
+
   drawOn[frame] = true;
   dispatcher->add(
-      [this, frame, imageIdx, nodes]() {
+      [this, frame, frameNumber, imageIdx, nodes, timed]() {
+        // The commands and objects of the frame last rendered in this slot
+        // can be reused and released once it has completed.
+        canvas->waitFrame(frame);
+        retired->beginFrame(frameNumber);
+        frameNodes[frame] = nodes;
+
+        resolveTimings(frame);
+        updateTextures(frameNumber);
+
+        auto const buildStart = std::chrono::steady_clock::now();
         {
           mat4 viewProj;
           {
@@ -575,10 +978,22 @@ void RendererVlk::render(std::vector<node_ptr> const &nodes) {
             viewProj = globalData.project * globalData.view;
           }
 
-          buildCommands(frame, imageIdx, clearColor, nodes, viewProj);
+          buildCommands(frame, imageIdx, timed ? frameNumber : 0, clearColor,
+                        nodes, viewProj);
         }
+        float const buildMs = msSince(buildStart);
 
+        auto const submitStart = std::chrono::steady_clock::now();
         canvas->draw(frame, cmds[frame], gfxQueueDraw);
+        lastImage = imageIdx;
+
+        if (timed) {
+          float const submitMs = msSince(submitStart);
+          std::scoped_lock lock(timingsMux);
+          FrameTimings &t = timings[frameNumber];
+          t.buildCommands = buildMs;
+          t.submit = submitMs;
+        }
 
         std::unique_lock lock(*drawMutex[frame]);
         drawCV[frame]->notify_all();
@@ -587,7 +1002,7 @@ void RendererVlk::render(std::vector<node_ptr> const &nodes) {
       gfxQueueDraw, "draw");
 
   dispatcher->add(
-      [this, imageIdx, frame]() {
+      [this, imageIdx, frame, frameNumber, timed]() {
         {
           std::unique_lock lock(*drawMutex[frame]);
           if (drawOn[frame]) {
@@ -597,13 +1012,102 @@ void RendererVlk::render(std::vector<node_ptr> const &nodes) {
         }
 
         // canvas->draw(frame, cmds[imageIdx], gfxQueueDraw);
+        auto const presentStart = std::chrono::steady_clock::now();
         canvas->present(frame, imageIdx, *presentQueue);
+
+        if (timed) {
+          float const presentMs = msSince(presentStart);
+          std::scoped_lock lock(timingsMux);
+          timings[frameNumber].presentWait += presentMs;
+        }
       },
       presentQueue, "present");
 }
 
 void RendererVlk::flush() {
+  residency->wait();
   std::scoped_lock lock(canvas->mutex());
   canvas->waitFences();
   vkDeviceWaitIdle(*device);
+  retired->clear();
+}
+
+void RendererVlk::saveFrame(std::string const &filename) {
+  offscreen_ptr images = canvas->getOffscreen();
+  if (images == nullptr)
+    throw std::runtime_error("frames can be saved only when rendering "
+                             "offscreen");
+
+  flush();
+  int const imageIdx = lastImage;
+  if (imageIdx < 0)
+    throw std::runtime_error("no frame has been rendered");
+
+  std::vector<uint8_t> pixels;
+  runOnQueue(
+      gfxQueueDraw,
+      [this, images, imageIdx, &pixels]() {
+        if (cmdPool == nullptr)
+          cmdPool =
+              std::make_shared<CommandPool>(device, gfxQueueDraw->getFamily());
+        pixels = images->readPixels(cmdPool, gfxQueueDraw, imageIdx);
+      },
+      "read frame");
+
+  VkExtent2D const size = images->getSize();
+  if (!stbi_write_png(filename.c_str(), size.width, size.height, 4,
+                      pixels.data(), size.width * 4))
+    throw std::runtime_error("failed to write " + filename);
+}
+
+std::vector<FrameTimings> RendererVlk::takeFrameTimings() {
+  // Let the frames in progress finish.
+  runOnQueue(gfxQueueDraw, []() {}, "sync draw");
+  runOnQueue(presentQueue, []() {}, "sync present");
+  flush();
+
+  runOnQueue(
+      gfxQueueDraw,
+      [this]() {
+        for (size_t i = 0; i < runningFrames; i++)
+          resolveTimings(i);
+      },
+      "resolve timings");
+
+  std::scoped_lock lock(timingsMux);
+  std::vector<FrameTimings> out;
+  out.reserve(timings.size());
+  for (auto const &[frameNumber, t] : timings)
+    out.push_back(t);
+  timings.clear();
+  return out;
+}
+
+void RendererVlk::runOnQueue(queue_ptr queue, std::function<void()> fn,
+                             std::string const &name) {
+  std::exception_ptr error;
+  std::mutex m;
+  std::condition_variable cv;
+  bool done = false;
+
+  dispatcher->add(
+      [&fn, &error, &m, &cv, &done]() {
+        try {
+          fn();
+        } catch (...) {
+          error = std::current_exception();
+        }
+
+        std::scoped_lock lock(m);
+        done = true;
+        cv.notify_all();
+      },
+      queue, name);
+
+  {
+    std::unique_lock lock(m);
+    cv.wait(lock, [&done] { return done; });
+  }
+  if (error)
+    std::rethrow_exception(error);
 }
@@ -24,14 +24,22 @@
 
 #include "gfx/renderer.h"
 #include "impl/commands.h"
+#include "impl/deletion.h"
 #include "impl/descs.h"
 #include "impl/framebuffer.h"
+#include "impl/profiler.h"
 #include "impl/renderpass.h"
+#include "impl/staging.h"
 #include "material.h"
+#include "mesh_arena.h"
 #include "queue_dispatcher.h"
+#include "render_queue.h"
+#include "residency.h"
 #include "sampler.h"
 
 #include <SDL_video.h>
+#include <atomic>
+#include <functional>
 #include <map>
 #include <set>
 
@@ -42,12 +50,16 @@ struct PipelineLayout;
 struct Window;
 
 /**
- * RendererVlk is a vulkan renderer.
+ * RendererVlk is a vulkan renderer. It renders into a window, or into
+ * offscreen images without a window or a display, e.g. on a software
+ * rasterizer.
  */
 class RendererVlk : public Renderer {
 public:
+  // With bindless, materials are drawn from a single descriptor set when
+  // the device supports descriptor indexing.
   RendererVlk(int reqWidth, int reqHeight, bool fullScreen, bool borderless,
-              bool grabMouse);
+              bool grabMouse, bool offscreen = false, bool bindless = false);
   ~RendererVlk();
 
   device_ptr getDevice() const { return device; }
@@ -76,29 +88,90 @@ public:
   virtual void setElapsed(float time) override { globalData.time = time; }
 
   node_ptr stage(node_ptr node) override;
+  void stageMeshes(node_ptr root) override;
+
+  void setTextureBudget(size_t bytes) override {
+    residency->setBudget(bytes);
+  }
+
+  TextureStats getTextureStats() const override {
+    return residency->getStats();
+  }
+
+  DrawStats getDrawStats() const override {
+    std::scoped_lock lock(timingsMux);
+    return drawStats;
+  }
+
+  // Sets the number of threads recording the commands of a frame. 0 uses
+  // all available threads, 1 records them on the draw queue only.
+  void setRecordThreads(size_t threads) { recordThreads = threads; }
+
+  void setTransformStore(TransformStore const *store) override {
+    transformStore = store;
+  }
 
   void windowResized() override;
 
   void render(std::vector<node_ptr> const &nodes) override;
   void flush() override;
+  void saveFrame(std::string const &filename) override;
+
+  void setRecordTimings(bool record) override { recordTimings = record; }
+  void setProfileMaterials(bool profile) override {
+    profileMaterials = profile;
+  }
+  std::vector<FrameTimings> takeFrameTimings() override;
 
 private:
   desclayout_ptr createGlobalLayout();
   desclayout_ptr createMaterialDescLayout();
-  desclayout_ptr createNodeLayout();
 
   void createWindow(int reqWidth, int reqHeight, bool fullScreen,
                     bool borderless, bool grabMouse);
   void createPipelineLayout();
+  void createFrameCommands();
   void allocateGlobalSets(int numImages);
 
-  void buildCommands(int frame, int imageIdx, vec4 const &clearColor,
+  // Keeps textures within the memory budget and rebinds the materials
+  // whose textures changed. Called from the draw queue before recording.
+  void updateTextures(uint64_t frameNumber);
+
+  // Runs fn on the worker of the given queue after the tasks already added
+  // for it and waits for it. Exceptions thrown by fn are rethrown.
+  void runOnQueue(queue_ptr queue, std::function<void()> fn,
+                  std::string const &name);
+
+  // Reads the GPU times of the frame last rendered in the given slot, if
+  // they are available.
+  void resolveTimings(int frame);
+
+  // Records the commands of a frame. A non-zero profileFrame profiles the
+  // frame on the GPU under that frame number.
+  void buildCommands(int frame, int imageIdx, uint64_t profileFrame,
+                     vec4 const &clearColor,
                      std::vector<node_ptr> const &nodes, mat4 const &viewProj);
 
+  // Fills the render queue with the draws of the visible nodes, sorted to
+  // minimize state changes, and writes their transforms into the instance
+  // buffer of the frame in the same order.
+  void buildQueue(int frame, std::vector<node_ptr> const &nodes,
+                  mat4 const &viewProj);
+
+  // Records draws [begin, end) of the render queue into cmd. Consecutive
+  // draws of the same mesh and material are recorded as one instanced
+  // draw. With scopes the materials and the skybox are profiled on the GPU.
+  DrawStats recordDraws(CommandBuffer *cmd, int frame, size_t begin,
+                        size_t end, bool scopes);
+
   // Stages a texture for display. This can entail loading the
   // texture into CPU and then GPU memory.
   texture_ptr stage(texture_ptr tex);
 
+  // Loads the pixels of tex into a new image with all of its mip levels
+  // and releases them from system memory. Must be called with tex locked.
+  image_ptr loadImage(texture_ptr tex);
+
   // Stages a material for display. Returns the staged material
   // which might be different than the original.
   material_ptr stage(material_ptr mat);
@@ -107,9 +180,14 @@ private:
   // which might be different than the original.
   mesh_ptr stage(mesh_ptr mesh);
 
+  // Stages unstaged meshes, uploading their geometry in batches. Returns
+  // the staged meshes in the same order.
+  std::vector<mesh_ptr> stage(std::vector<mesh_ptr> const &meshes);
+
   QueueDispatcher *dispatcher;
   queue_ptr presentQueue;
   ivec2 viewSize;
+  ivec2 offscreenSize; // requested size when rendering offscreen
   size_t numImages;
   size_t runningFrames;
   std::unique_ptr<Window> window;
@@ -117,13 +195,16 @@ private:
   std::unique_ptr<Canvas> canvas;
   desclayout_ptr globalLayout;
   desclayout_ptr matLayout;
-  desclayout_ptr nodeLayout;
   std::shared_ptr<PipelineLayout> pipeLayout;
   descpool_ptr globalPool;
   descpool_ptr materialPool;
-  descpool_ptr nodePool;
+  bindless_ptr bindless; // replaces materialPool when supported
 
   std::set<std::shared_ptr<MaterialVlk>> materials;
+  std::mutex materialsMux;
+  std::unique_ptr<TextureResidency> residency;
+  std::unique_ptr<StagingRing> staging;
+  mesharena_ptr meshArena;
   std::map<std::string, sampler_ptr> samplers;
 
   vec4 clearColor = vec4(0.0f, 0.0f, 0.0f, 1.0f);
@@ -136,9 +217,41 @@ private:
 
   renderpass_ptr renderPass;
   std::vector<framebuffer_ptr> frameBuffers;
-  std::vector<cmdbuf_ptr> cmds;
   queue_ptr gfxQueueDraw, gfxQueueUtil;
+
+  // Command buffers of each running frame. Every command buffer has a pool
+  // of its own, reset when the frame is recorded again, since a pool is
+  // used by one thread at a time. The secondary ones are recorded in
+  // parallel.
+  std::vector<cmdbuf_ptr> cmds;
+  std::atomic<size_t> recordThreads = 0;
+  std::vector<std::vector<cmdbuf_ptr>> secondaryCmds;
+  RenderQueue renderQueue; // draws of the frame being recorded
+
+  // Global transforms of the nodes of the frame being recorded,
+  // indexed by the draws, and the instance storage buffer of each running
+  // frame, bound in its global set, holding the transforms of the draws in
+  // their sorted order.
+  std::vector<mat4> transforms;
+  std::atomic<TransformStore const *> transformStore = nullptr;
+  std::vector<buffer_ptr> instanceBufs;
+  std::vector<size_t> instanceCapacity; // in instances
+
+  // The nodes drawn by each running frame are kept alive until the frame
+  // has completed, objects replaced meanwhile in retired.
+  std::vector<std::vector<node_ptr>> frameNodes;
+  std::unique_ptr<DeletionQueue> retired;
   int totalFrames = 0;
+  std::atomic<int> lastImage = -1; // image of the last submitted frame
+
+  // Frame timings, see setRecordTimings(). The GPU times are read from
+  // the profiler when a running frame is reused.
+  std::atomic<bool> recordTimings = false;
+  std::atomic<bool> profileMaterials = false;
+  mutable std::mutex timingsMux;
+  std::map<uint64_t, FrameTimings> timings; // by frame number
+  DrawStats drawStats;                      // of the last recorded frame
+  std::unique_ptr<GpuProfiler> profiler;
 
   std::vector<std::unique_ptr<std::mutex>> drawMutex;
   std::vector<std::unique_ptr<std::condition_variable>> drawCV;
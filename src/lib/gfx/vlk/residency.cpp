@@ -0,0 +1,212 @@
+/*
+ Copyright (c) 2022 Tero Oinas
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+#include "residency.h"
+#include "core/dispatcher_instance.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+
+using namespace cst;
+using namespace cst::vlk;
+
+// Textures are not reduced below this width or height in pixels.
+static const int MIN_RESIDENT_SIZE = 64;
+
+// Textures sampled within this many frames are not reduced, and only they
+// are restored.
+static const uint64_t RECENT_FRAMES = 60;
+
+// Maximum number of textures reduced per frame, each one costs a copy.
+static const int MAX_DROPS_PER_FRAME = 4;
+
+// A texture is restored only if this fraction of the budget stays free
+// afterwards, so that it is not reduced again right away.
+static const size_t RESTORE_MARGIN_DIVISOR = 8;
+
+void TextureResidency::setBudget(size_t bytes) {
+  std::scoped_lock lock(mux);
+  budget = bytes;
+}
+
+void TextureResidency::add(std::shared_ptr<TextureVlk> tex,
+                           texture_ptr source) {
+  std::scoped_lock lock(mux);
+  entries.push_back({tex, source, tex->getDeviceMemorySize(), 0, false});
+}
+
+void TextureResidency::wait() {
+  std::unique_lock lock(mux);
+  restoreDone.wait(lock, [this] { return numRestoring == 0; });
+}
+
+bool TextureResidency::update(uint64_t frame, cmdpool_ptr pool,
+                              queue_ptr queue) {
+  std::scoped_lock lock(mux);
+
+  std::erase_if(entries, [](Entry const &e) { return e.tex.expired(); });
+  bool changed = installRestored();
+
+  size_t used = 0;
+  for (auto const &e : entries)
+    used += e.deviceBytes;
+
+  if (budget == 0 || used <= budget) {
+    restore(frame, used);
+    return changed;
+  }
+
+  // Least recently sampled first, larger first among equals.
+  struct Candidate {
+    Entry *entry;
+    std::shared_ptr<TextureVlk> tex;
+    uint64_t lastUsed;
+  };
+
+  std::vector<Candidate> lru;
+  for (auto &e : entries) {
+    auto tex = e.tex.lock();
+    if (tex == nullptr || e.restoring || tex->getLayers() != 1 ||
+        tex->getMipLevels() == 1 ||
+        std::min(tex->getWidth(), tex->getHeight()) / 2 < MIN_RESIDENT_SIZE)
+      continue;
+
+    uint64_t const lastUsed = tex->getLastUsed();
+    if (lastUsed + RECENT_FRAMES < frame)
+      lru.push_back({&e, tex, lastUsed});
+  }
+
+  std::sort(lru.begin(), lru.end(),
+            [](Candidate const &a, Candidate const &b) {
+              if (a.lastUsed != b.lastUsed)
+                return a.lastUsed < b.lastUsed;
+              return a.entry->deviceBytes > b.entry->deviceBytes;
+            });
+
+  int drops = 0;
+  for (auto &c : lru) {
+    if (used <= budget || drops == MAX_DROPS_PER_FRAME)
+      break;
+
+    std::scoped_lock tlock(c.tex->mutex());
+    retired.retire(c.tex->dropTopLevels(1, pool, queue));
+
+    size_t bytes = c.tex->getDeviceMemorySize();
+    used -= c.entry->deviceBytes - bytes;
+    c.entry->deviceBytes = bytes;
+    c.entry->dropped++;
+    drops++;
+  }
+
+  return changed || drops > 0;
+}
+
+bool TextureResidency::installRestored() {
+  bool changed = false;
+  for (auto &[weak, image] : restored) {
+    auto tex = weak.lock();
+    auto e = std::find_if(entries.begin(), entries.end(), [&](Entry &e) {
+      return e.tex.lock() == tex;
+    });
+    if (tex == nullptr || e == entries.end())
+      continue;
+
+    e->restoring = false;
+    if (image == nullptr) {
+      e->source = nullptr;
+      continue;
+    }
+
+    std::scoped_lock tlock(tex->mutex());
+    retired.retire(tex->replaceImage(image));
+    e->deviceBytes = tex->getDeviceMemorySize();
+    e->dropped = 0;
+    changed = true;
+  }
+  restored.clear();
+  return changed;
+}
+
+void TextureResidency::restore(uint64_t frame, size_t used) {
+  if (numRestoring > 0)
+    return;
+
+  // Each level is a quarter of the one above it, so the full size is about
+  // 4^dropped times the current size.
+  size_t const limit =
+      budget == 0 ? SIZE_MAX : budget - budget / RESTORE_MARGIN_DIVISOR;
+  Entry *best = nullptr;
+  uint64_t bestUsed = 0;
+  for (auto &e : entries) {
+    auto tex = e.tex.lock();
+    if (tex == nullptr || e.dropped == 0 || e.restoring || e.source == nullptr)
+      continue;
+
+    uint64_t const lastUsed = tex->getLastUsed();
+    size_t const fullBytes = e.deviceBytes << (2 * e.dropped);
+    if (lastUsed + RECENT_FRAMES >= frame && lastUsed >= bestUsed &&
+        used - e.deviceBytes + fullBytes <= limit) {
+      best = &e;
+      bestUsed = lastUsed;
+    }
+  }
+  if (best == nullptr)
+    return;
+
+  best->restoring = true;
+  numRestoring++;
+  getDispatcher()->add(
+      [this, tex = best->tex, source = best->source]() {
+        image_ptr image;
+        try {
+          std::scoped_lock lock(source->mutex());
+          image = loader(source);
+        } catch (std::exception const &e) {
+          std::cerr << "Failed to restore texture " << source->getName()
+                    << ": " << e.what() << "\n";
+        }
+
+        std::scoped_lock lock(mux);
+        restored.push_back({tex, image});
+        numRestoring--;
+        restoreDone.notify_all();
+      },
+      "restore texture");
+}
+
+TextureStats TextureResidency::getStats() const {
+  std::scoped_lock lock(mux);
+
+  TextureStats stats;
+  stats.budget = budget;
+  for (auto const &e : entries) {
+    if (e.tex.expired())
+      continue;
+
+    stats.deviceBytes += e.deviceBytes;
+    stats.numTextures++;
+    if (e.dropped > 0)
+      stats.numReduced++;
+    stats.numDropped += e.dropped;
+  }
+  return stats;
+}
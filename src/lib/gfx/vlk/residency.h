@@ -0,0 +1,106 @@
+/*
+ Copyright (c) 2022 Tero Oinas
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+#ifndef _CST_LIB_GFX_VLK_RESIDENCY_H
+#define _CST_LIB_GFX_VLK_RESIDENCY_H
+
+#include "gfx/renderer.h"
+#include "impl/deletion.h"
+#include "texture.h"
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace cst::vlk {
+
+// Loads the pixels of a texture into a new image with all of its mip levels.
+// Called with the texture locked.
+typedef std::function<image_ptr(texture_ptr)> image_loader;
+
+/**
+ * TextureResidency tracks the memory used by staged textures and keeps the
+ * device memory within a budget by dropping top mip levels of the textures
+ * that have not been sampled recently. The dropped levels are loaded again
+ * from the source textures in the background once they fit in the budget
+ * and the textures are sampled again.
+ */
+class TextureResidency {
+public:
+  // Replaced images are kept alive in retired until the frames using them
+  // have completed. The dropped levels are restored with loader.
+  TextureResidency(DeletionQueue &retired, image_loader loader)
+      : retired(retired), loader(loader) {}
+
+  // Waits for the textures being restored.
+  ~TextureResidency() { wait(); }
+
+  // Sets the device memory budget in bytes, 0 for unlimited.
+  void setBudget(size_t bytes);
+
+  // Starts tracking a staged texture, which was loaded from source.
+  void add(std::shared_ptr<TextureVlk> tex, texture_ptr source);
+
+  // Drops top mip levels until the textures fit in the budget, or starts
+  // restoring them when there is room. Must be called from the thread that
+  // submits frames to the queue, before recording the given frame. Returns
+  // true if any texture got a new image view.
+  bool update(uint64_t frame, cmdpool_ptr pool, queue_ptr queue);
+
+  // Waits for the textures being restored.
+  void wait();
+
+  TextureStats getStats() const;
+
+private:
+  struct Entry {
+    std::weak_ptr<TextureVlk> tex;
+    texture_ptr source; // nullptr if it failed to load again
+    size_t deviceBytes;
+    int dropped;
+    bool restoring;
+  };
+
+  // Swaps in the images restored since the last update. Returns true if
+  // there were any.
+  bool installRestored();
+
+  // Starts loading the dropped levels of the most recently sampled texture
+  // that fits in the budget, given the bytes used.
+  void restore(uint64_t frame, size_t used);
+
+  mutable std::mutex mux;
+  std::vector<Entry> entries;
+  DeletionQueue &retired;
+  image_loader loader;
+  size_t budget = 0;
+
+  // Images loaded by restore(), nullptr for failures, and the number of
+  // restores in progress.
+  std::vector<std::pair<std::weak_ptr<TextureVlk>, image_ptr>> restored;
+  int numRestoring = 0;
+  std::condition_variable restoreDone;
+};
+
+} // namespace cst::vlk
+
+#endif // _CST_LIB_GFX_VLK_RESIDENCY_H
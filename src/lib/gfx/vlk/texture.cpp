@@ -21,36 +21,65 @@
  */
 #include "texture.h"
 
+#include <cassert>
+#include <vector>
+
 using namespace cst::vlk;
 using namespace cst;
 
+std::atomic<uint64_t> TextureVlk::currentFrame = 0;
+
 TextureVlk::TextureVlk(device_ptr dev, std::string const &name, image_ptr image,
-                       sampler_ptr sampler, int layers, int mipLevels, TextureType type)
+                       sampler_ptr sampler, int layers, int mipLevels, TextureType type,
+                       VkFormat format)
     : Texture(name, type), dev(dev), image(image), sampler(sampler), layers(layers) {
+  assert(image->getMipLevels() == mipLevels && image->getFormat() == format);
+  view = createView(image);
+}
+
+TextureVlk::~TextureVlk() { vkDestroyImageView(*dev, view, nullptr); }
+
+VkImageView TextureVlk::createView(image_ptr image) const {
   VkImageViewCreateInfo info{};
   info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
   info.image = *image;
   info.viewType = (layers == 6) ? VK_IMAGE_VIEW_TYPE_CUBE : VK_IMAGE_VIEW_TYPE_2D;
-  info.format = (type == TEXTURE_TYPE_ALBEDO) ? VK_FORMAT_R8G8B8A8_SRGB
-                                              : VK_FORMAT_R8G8B8A8_UNORM;
+  info.format = image->getFormat();
   info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-  info.subresourceRange.levelCount = mipLevels;
+  info.subresourceRange.levelCount = image->getMipLevels();
   info.subresourceRange.layerCount = layers;
 
+  VkImageView view;
   if (vkCreateImageView(*dev, &info, nullptr, &view) != VK_SUCCESS)
     throw std::runtime_error("failed to create an image view");
+  return view;
 }
 
-TextureVlk::~TextureVlk() { vkDestroyImageView(*dev, view, nullptr); }
-
-int TextureVlk::getWidth() const {
-  throw std::runtime_error("Not implemented");
+std::shared_ptr<void> TextureVlk::dropTopLevels(int levels, cmdpool_ptr pool,
+                                                queue_ptr queue) {
+  return replaceImage(
+      std::make_shared<ImageVlk>(dev, pool, queue, *image, levels));
 }
 
-int TextureVlk::getHeight() const {
-  throw std::runtime_error("Not implemented");
+std::shared_ptr<void> TextureVlk::replaceImage(image_ptr newImage) {
+  VkImageView newView = createView(newImage);
+
+  image_ptr oldImage = image;
+  VkImageView oldView = view;
+  image = newImage;
+  view = newView;
+  generation++;
+
+  device_ptr d = dev;
+  return std::shared_ptr<void>(nullptr, [d, oldImage, oldView](void *) {
+    vkDestroyImageView(*d, oldView, nullptr);
+  });
 }
 
+int TextureVlk::getWidth() const { return image->getWidth(); }
+
+int TextureVlk::getHeight() const { return image->getHeight(); }
+
 int TextureVlk::getDepth() const {
   throw std::runtime_error("Not implemented");
 }
@@ -60,3 +89,60 @@ uint8_t *TextureVlk::getPixels() const {
 }
 
 void TextureVlk::load() { throw std::runtime_error("Not implemented"); }
+
+VkFormat cst::vlk::toVkFormat(PixelFormat format, TextureType type) {
+  bool srgb = (type == TEXTURE_TYPE_ALBEDO);
+
+  switch (format) {
+  case PIXEL_FORMAT_RGBA8:
+    return srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+  case PIXEL_FORMAT_BC1:
+    return srgb ? VK_FORMAT_BC1_RGBA_SRGB_BLOCK : VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+  case PIXEL_FORMAT_BC3:
+    return srgb ? VK_FORMAT_BC3_SRGB_BLOCK : VK_FORMAT_BC3_UNORM_BLOCK;
+  case PIXEL_FORMAT_BC5:
+    return VK_FORMAT_BC5_UNORM_BLOCK;
+  case PIXEL_FORMAT_BC7:
+    return srgb ? VK_FORMAT_BC7_SRGB_BLOCK : VK_FORMAT_BC7_UNORM_BLOCK;
+  case PIXEL_FORMAT_ETC2:
+    return srgb ? VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK
+                : VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK;
+  case PIXEL_FORMAT_ASTC_4X4:
+    return srgb ? VK_FORMAT_ASTC_4x4_SRGB_BLOCK
+                : VK_FORMAT_ASTC_4x4_UNORM_BLOCK;
+  }
+  throw std::runtime_error("unknown pixel format");
+}
+
+uint32_t cst::vlk::getSupportedPixelFormats(device_ptr dev) {
+  VkPhysicalDeviceFeatures const &feats = dev->getFeatures();
+
+  std::vector<std::pair<PixelFormat, bool>> candidates = {
+      {PIXEL_FORMAT_RGBA8, true},
+      {PIXEL_FORMAT_BC1, feats.textureCompressionBC == VK_TRUE},
+      {PIXEL_FORMAT_BC3, feats.textureCompressionBC == VK_TRUE},
+      {PIXEL_FORMAT_BC5, feats.textureCompressionBC == VK_TRUE},
+      {PIXEL_FORMAT_BC7, feats.textureCompressionBC == VK_TRUE},
+      {PIXEL_FORMAT_ETC2, feats.textureCompressionETC2 == VK_TRUE},
+      {PIXEL_FORMAT_ASTC_4X4, feats.textureCompressionASTC_LDR == VK_TRUE}};
+
+  uint32_t formats = 0;
+  for (auto [format, enabled] : candidates) {
+    if (!enabled)
+      continue;
+
+    // Both the color (sRGB) and the linear variant must be sampleable.
+    bool ok = true;
+    for (auto type : {TEXTURE_TYPE_ALBEDO, TEXTURE_TYPE_NORMAL}) {
+      VkFormatProperties props;
+      vkGetPhysicalDeviceFormatProperties(dev->getPhysicalDevice(),
+                                          toVkFormat(format, type), &props);
+      if (!(props.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT))
+        ok = false;
+    }
+
+    if (ok)
+      formats |= 1 << format;
+  }
+  return formats;
+}
@@ -28,6 +28,8 @@
 #include "sg/texture.h"
 #include "math/vec4.h"
 
+#include <atomic>
+
 namespace cst::vlk {
 
 /**
@@ -36,7 +38,8 @@ namespace cst::vlk {
 class TextureVlk : public cst::Texture {
 public:
   TextureVlk(device_ptr dev, std::string const &name, image_ptr image,
-             sampler_ptr sampler, int layers, int mipLevels, TextureType type);
+             sampler_ptr sampler, int layers, int mipLevels, TextureType type,
+             VkFormat format);
   ~TextureVlk();
 
   int getWidth() const override;
@@ -53,14 +56,59 @@ public:
   VkImageView getImageView() const { return view; }
   sampler_ptr getSampler() const { return sampler; }
 
+  int getMipLevels() const { return image->getMipLevels(); }
+
+  // Returns the size of the device memory used by the texture.
+  size_t getDeviceMemorySize() const { return image->getMemorySize(); }
+
+  // Returns a counter that changes whenever the image view changes.
+  // Descriptor sets bound to an older generation must be rebound.
+  uint32_t getGeneration() const { return generation; }
+
+  // Marks the texture as sampled in the current frame.
+  void touch() { lastUsed.store(currentFrame, std::memory_order_relaxed); }
+
+  // Returns the frame in which the texture was last sampled.
+  uint64_t getLastUsed() const {
+    return lastUsed.load(std::memory_order_relaxed);
+  }
+
+  // Sets the frame number used by touch().
+  static void setCurrentFrame(uint64_t frame) { currentFrame = frame; }
+
+  // Replaces the image with one that lacks the given number of top mip
+  // levels. Returns the old image and view which must be kept alive until
+  // frames still using them have finished. Must be called with the texture
+  // locked.
+  std::shared_ptr<void> dropTopLevels(int levels, cmdpool_ptr pool,
+                                      queue_ptr queue);
+
+  // Replaces the image, e.g. with one that has the dropped levels loaded
+  // again. Returns the old image and view like dropTopLevels(). Must be
+  // called with the texture locked.
+  std::shared_ptr<void> replaceImage(image_ptr newImage);
+
 private:
+  VkImageView createView(image_ptr image) const;
+
   device_ptr dev;
   image_ptr image;
   sampler_ptr sampler;
   int layers;
   VkImageView view = VK_NULL_HANDLE;
+  std::atomic<uint32_t> generation = 0;
+  std::atomic<uint64_t> lastUsed = 0;
+
+  static std::atomic<uint64_t> currentFrame;
 };
 
+// Returns the VkFormat used for pixel data of a texture of the given type.
+VkFormat toVkFormat(PixelFormat format, TextureType type);
+
+// Returns the pixel formats the device can sample from as a mask of
+// (1 << PixelFormat) bits.
+uint32_t getSupportedPixelFormats(device_ptr dev);
+
 } // namespace cst::vlk
 
 #endif // _CST_LIB_GFX_TEXTURE_H
\ No newline at end of file
@@ -0,0 +1,409 @@
+/*
+ Copyright (c) 2022 Tero Oinas
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+#include "bcn.h"
+#include "core/parallel.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+using namespace cst;
+
+// Minimum number of block rows encoded by a task.
+static constexpr size_t BLOCK_ROWS_PER_TASK = 4;
+
+// BC7 interpolation weights of 4 bit indices.
+static const int BC7_WEIGHTS4[16] = {0,  4,  9,  13, 17, 21, 26, 30,
+                                     34, 38, 43, 47, 51, 55, 60, 64};
+
+/**
+ * Block holds the 4x4 pixels of a block as separate channels.
+ */
+struct Block {
+  float px[4][16];
+};
+
+// Reads a block, repeating the edge pixels for partial blocks.
+static void fetchBlock(uint8_t const *pixels, int width, int height, int bx,
+                       int by, Block &b) {
+  for (int y = 0; y < 4; y++) {
+    int sy = std::min(by * 4 + y, height - 1);
+    for (int x = 0; x < 4; x++) {
+      int sx = std::min(bx * 4 + x, width - 1);
+      uint8_t const *p = pixels + (size_t(sy) * width + sx) * 4;
+      for (int c = 0; c < 4; c++)
+        b.px[c][y * 4 + x] = p[c];
+    }
+  }
+}
+
+/**
+ * Selects the nearest palette entry for each pixel of a block using the
+ * first numCh channels. Returns the total squared error.
+ */
+static float nearestIndices(Block const &b, int numCh, float const pal[][4],
+                            int numPal, uint8_t idx[16]) {
+  float total = 0.0f;
+
+#ifdef __SSE2__
+  for (int i = 0; i < 16; i += 4) {
+    __m128 ch[4];
+    for (int c = 0; c < numCh; c++)
+      ch[c] = _mm_loadu_ps(&b.px[c][i]);
+
+    __m128 best = _mm_set1_ps(FLT_MAX);
+    __m128i bestIdx = _mm_setzero_si128();
+
+    for (int p = 0; p < numPal; p++) {
+      __m128 d = _mm_setzero_ps();
+      for (int c = 0; c < numCh; c++) {
+        __m128 t = _mm_sub_ps(ch[c], _mm_set1_ps(pal[p][c]));
+        d = _mm_add_ps(d, _mm_mul_ps(t, t));
+      }
+
+      __m128i closer = _mm_castps_si128(_mm_cmplt_ps(d, best));
+      best = _mm_min_ps(d, best);
+      bestIdx = _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi32(p)),
+                             _mm_andnot_si128(closer, bestIdx));
+    }
+
+    alignas(16) int32_t out[4];
+    alignas(16) float err[4];
+    _mm_store_si128((__m128i *)out, bestIdx);
+    _mm_store_ps(err, best);
+
+    for (int j = 0; j < 4; j++) {
+      idx[i + j] = uint8_t(out[j]);
+      total += err[j];
+    }
+  }
+#else
+  for (int i = 0; i < 16; i++) {
+    float best = FLT_MAX;
+    for (int p = 0; p < numPal; p++) {
+      float d = 0.0f;
+      for (int c = 0; c < numCh; c++) {
+        float t = b.px[c][i] - pal[p][c];
+        d += t * t;
+      }
+      if (d < best) {
+        best = d;
+        idx[i] = uint8_t(p);
+      }
+    }
+    total += best;
+  }
+#endif
+  return total;
+}
+
+/**
+ * Finds the end points of the line that best fits the pixels of a block by
+ * projecting the pixels to the principal axis of their covariance.
+ */
+static void principalEndpoints(Block const &b, int numCh, float e0[4],
+                               float e1[4]) {
+  float mean[4] = {}, mn[4], mx[4];
+  for (int c = 0; c < numCh; c++) {
+    mn[c] = FLT_MAX;
+    mx[c] = -FLT_MAX;
+    for (int i = 0; i < 16; i++) {
+      mean[c] += b.px[c][i];
+      mn[c] = std::min(mn[c], b.px[c][i]);
+      mx[c] = std::max(mx[c], b.px[c][i]);
+    }
+    mean[c] /= 16.0f;
+  }
+
+  float cov[4][4] = {};
+  for (int i = 0; i < 16; i++)
+    for (int c = 0; c < numCh; c++)
+      for (int d = 0; d < numCh; d++)
+        cov[c][d] += (b.px[c][i] - mean[c]) * (b.px[d][i] - mean[d]);
+
+  // Power iteration starting from the bounding box diagonal.
+  float axis[4] = {};
+  for (int c = 0; c < numCh; c++)
+    axis[c] = mx[c] - mn[c];
+
+  for (int iter = 0; iter < 8; iter++) {
+    float v[4] = {};
+    float len = 0.0f;
+    for (int c = 0; c < numCh; c++) {
+      for (int d = 0; d < numCh; d++)
+        v[c] += cov[c][d] * axis[d];
+      len += v[c] * v[c];
+    }
+    if (len < 1e-12f)
+      break;
+
+    len = sqrtf(len);
+    for (int c = 0; c < numCh; c++)
+      axis[c] = v[c] / len;
+  }
+
+  float len = 0.0f;
+  for (int c = 0; c < numCh; c++)
+    len += axis[c] * axis[c];
+  if (len < 1e-12f) {
+    for (int c = 0; c < numCh; c++) {
+      e0[c] = mean[c];
+      e1[c] = mean[c];
+    }
+    return;
+  }
+
+  len = sqrtf(len);
+  float tmin = FLT_MAX, tmax = -FLT_MAX;
+  for (int i = 0; i < 16; i++) {
+    float t = 0.0f;
+    for (int c = 0; c < numCh; c++)
+      t += (b.px[c][i] - mean[c]) * axis[c] / len;
+    tmin = std::min(tmin, t);
+    tmax = std::max(tmax, t);
+  }
+
+  for (int c = 0; c < numCh; c++) {
+    e0[c] = std::clamp(mean[c] + axis[c] / len * tmin, 0.0f, 255.0f);
+    e1[c] = std::clamp(mean[c] + axis[c] / len * tmax, 0.0f, 255.0f);
+  }
+}
+
+/**
+ * BitWriter writes bit fields into a zeroed block, least significant bit
+ * first.
+ */
+struct BitWriter {
+  uint8_t *out;
+  int pos = 0;
+
+  void write(uint32_t v, int bits) {
+    for (int i = 0; i < bits; i++, pos++)
+      if ((v >> i) & 1)
+        out[pos >> 3] |= uint8_t(1 << (pos & 7));
+  }
+};
+
+/****** BC1 ******/
+
+static uint16_t to565(float const c[4]) {
+  uint32_t r = uint32_t(c[0] * 31.0f / 255.0f + 0.5f);
+  uint32_t g = uint32_t(c[1] * 63.0f / 255.0f + 0.5f);
+  uint32_t b = uint32_t(c[2] * 31.0f / 255.0f + 0.5f);
+  return uint16_t((r << 11) | (g << 5) | b);
+}
+
+static void from565(uint16_t v, float c[4]) {
+  uint32_t r = v >> 11, g = (v >> 5) & 63, b = v & 31;
+  c[0] = float((r << 3) | (r >> 2));
+  c[1] = float((g << 2) | (g >> 4));
+  c[2] = float((b << 3) | (b >> 2));
+  c[3] = 255.0f;
+}
+
+static void encodeBC1Block(Block const &b, uint8_t *out) {
+  float e0[4], e1[4];
+  principalEndpoints(b, 3, e0, e1);
+
+  // Four color mode needs c0 > c1.
+  uint16_t c0 = to565(e1);
+  uint16_t c1 = to565(e0);
+  if (c0 < c1)
+    std::swap(c0, c1);
+
+  uint8_t idx[16] = {};
+  if (c0 != c1) {
+    float pal[4][4];
+    from565(c0, pal[0]);
+    from565(c1, pal[1]);
+    for (int c = 0; c < 3; c++) {
+      pal[2][c] = (2.0f * pal[0][c] + pal[1][c]) / 3.0f;
+      pal[3][c] = (pal[0][c] + 2.0f * pal[1][c]) / 3.0f;
+    }
+    nearestIndices(b, 3, pal, 4, idx);
+  }
+
+  uint32_t indices = 0;
+  for (int i = 0; i < 16; i++)
+    indices |= uint32_t(idx[i]) << (i * 2);
+
+  out[0] = c0 & 0xff;
+  out[1] = c0 >> 8;
+  out[2] = c1 & 0xff;
+  out[3] = c1 >> 8;
+  memcpy(out + 4, &indices, 4);
+}
+
+/****** BC4 / BC5 ******/
+
+// Encodes a single channel of a block as BC4.
+static void encodeBC4Block(Block const &b, int channel, uint8_t *out) {
+  Block ch;
+  memcpy(ch.px[0], b.px[channel], sizeof(ch.px[0]));
+
+  float mn = *std::min_element(ch.px[0], ch.px[0] + 16);
+  float mx = *std::max_element(ch.px[0], ch.px[0] + 16);
+
+  // Eight value mode needs e0 > e1.
+  uint8_t e0 = uint8_t(mx + 0.5f);
+  uint8_t e1 = uint8_t(mn + 0.5f);
+
+  memset(out, 0, 8);
+  out[0] = e0;
+  out[1] = e1;
+  if (e0 == e1)
+    return;
+
+  float pal[8][4];
+  pal[0][0] = e0;
+  pal[1][0] = e1;
+  for (int i = 1; i < 7; i++)
+    pal[i + 1][0] = ((7 - i) * e0 + i * e1) / 7.0f;
+
+  uint8_t idx[16];
+  nearestIndices(ch, 1, pal, 8, idx);
+
+  BitWriter bw{out + 2};
+  for (int i = 0; i < 16; i++)
+    bw.write(idx[i], 3);
+}
+
+static void encodeBC5Block(Block const &b, uint8_t *out) {
+  encodeBC4Block(b, 0, out);
+  encodeBC4Block(b, 1, out + 8);
+}
+
+/****** BC7 ******/
+
+// Quantizes an end point to 7 bits per channel and a shared p-bit,
+// choosing the p-bit with the smaller error.
+static void quantizeBC7Endpoint(float const e[4], uint32_t q[4],
+                                uint32_t &pbit) {
+  float bestErr = FLT_MAX;
+  for (uint32_t p = 0; p < 2; p++) {
+    uint32_t qp[4];
+    float err = 0.0f;
+    for (int c = 0; c < 4; c++) {
+      float v = std::clamp((e[c] - p) / 2.0f + 0.5f, 0.0f, 127.0f);
+      qp[c] = uint32_t(v);
+      float d = float((qp[c] << 1) | p) - e[c];
+      err += d * d;
+    }
+    if (err < bestErr) {
+      bestErr = err;
+      pbit = p;
+      memcpy(q, qp, sizeof(qp));
+    }
+  }
+}
+
+// Encodes a block with BC7 mode 6: one subset, RGBA end points with 7 bits
+// and a p-bit each, and 4 bit indices.
+static void encodeBC7Block(Block const &b, uint8_t *out) {
+  float e0[4], e1[4];
+  principalEndpoints(b, 4, e0, e1);
+
+  uint32_t q[2][4], p[2];
+  quantizeBC7Endpoint(e0, q[0], p[0]);
+  quantizeBC7Endpoint(e1, q[1], p[1]);
+
+  float pal[16][4];
+  for (int i = 0; i < 16; i++) {
+    int w = BC7_WEIGHTS4[i];
+    for (int c = 0; c < 4; c++) {
+      int a = (q[0][c] << 1) | p[0];
+      int z = (q[1][c] << 1) | p[1];
+      pal[i][c] = float(((64 - w) * a + w * z + 32) >> 6);
+    }
+  }
+
+  uint8_t idx[16];
+  nearestIndices(b, 4, pal, 16, idx);
+
+  // The most significant bit of the first index is implicitly zero.
+  if (idx[0] & 8) {
+    std::swap(q[0], q[1]);
+    std::swap(p[0], p[1]);
+    for (int i = 0; i < 16; i++)
+      idx[i] = 15 - idx[i];
+  }
+
+  memset(out, 0, 16);
+  BitWriter bw{out};
+  bw.write(1 << 6, 7);
+  for (int c = 0; c < 4; c++) {
+    bw.write(q[0][c], 7);
+    bw.write(q[1][c], 7);
+  }
+  bw.write(p[0], 1);
+  bw.write(p[1], 1);
+  bw.write(idx[0], 3);
+  for (int i = 1; i < 16; i++)
+    bw.write(idx[i], 4);
+}
+
+std::vector<uint8_t> cst::compressImage(PixelFormat format,
+                                        uint8_t const *pixels, int width,
+                                        int height) {
+  void (*encodeBlock)(Block const &, uint8_t *);
+  size_t blockBytes;
+
+  switch (format) {
+  case PIXEL_FORMAT_BC1:
+    encodeBlock = encodeBC1Block;
+    blockBytes = 8;
+    break;
+  case PIXEL_FORMAT_BC5:
+    encodeBlock = encodeBC5Block;
+    blockBytes = 16;
+    break;
+  case PIXEL_FORMAT_BC7:
+    encodeBlock = encodeBC7Block;
+    blockBytes = 16;
+    break;
+  default:
+    throw std::runtime_error("unsupported compression format");
+  }
+
+  int const blocksX = (width + 3) / 4;
+  int const blocksY = (height + 3) / 4;
+  std::vector<uint8_t> out(size_t(blocksX) * blocksY * blockBytes);
+
+  parallelFor(blocksY, BLOCK_ROWS_PER_TASK,
+              [&](size_t begin, size_t end, size_t) {
+                Block b;
+                for (size_t by = begin; by < end; by++) {
+                  for (int bx = 0; bx < blocksX; bx++) {
+                    fetchBlock(pixels, width, height, bx, by, b);
+                    encodeBlock(b, &out[(by * blocksX + bx) * blockBytes]);
+                  }
+                }
+              });
+
+  return out;
+}
@@ -0,0 +1,45 @@
+/*
+ Copyright (c) 2022 Tero Oinas
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+#ifndef _CST_LIB_IMAGE_BCN_H
+#define _CST_LIB_IMAGE_BCN_H
+
+#include "sg/texture.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace cst {
+
+/**
+ * Compresses an RGBA8 image into a block compressed format. Partial blocks
+ * at the right and bottom edges repeat the edge pixels.
+ *
+ * BC1 stores RGB, BC5 stores R and G (e.g. the x and y of a normal map) and
+ * BC7 stores RGBA using mode 6. Blocks are encoded in parallel and the
+ * palette index search uses SSE2 when available.
+ */
+std::vector<uint8_t> compressImage(PixelFormat format, uint8_t const *pixels,
+                                   int width, int height);
+
+} // namespace cst
+
+#endif // _CST_LIB_IMAGE_BCN_H
@@ -0,0 +1,208 @@
+/*
+ Copyright (c) 2022 Tero Oinas
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+#include "decoder.h"
+#include "core/fileutil.h"
+#include "support/stb_image.h"
+
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+
+#ifdef WALK_WITH_TURBOJPEG
+#include <turbojpeg.h>
+#endif
+
+#ifdef WALK_WITH_SPNG
+#include <spng.h>
+#endif
+
+using namespace cst;
+
+#ifdef WALK_WITH_TURBOJPEG
+namespace {
+
+// Decodes JPEG images with libjpeg-turbo.
+class TurboJPEGDecoder : public ImageDecoder {
+public:
+  char const *getName() const override { return "turbojpeg"; }
+
+  bool canDecode(uint8_t const *data, size_t size) const override {
+    return size >= 3 && data[0] == 0xff && data[1] == 0xd8 && data[2] == 0xff;
+  }
+
+  ImageInfo readInfo(uint8_t const *data, size_t size) const override {
+    ImageInfo info;
+    int subsamp, colorspace;
+    if (tjDecompressHeader3(handle(), data, size, &info.width, &info.height,
+                            &subsamp, &colorspace) != 0)
+      throw std::runtime_error(std::string("failed to read JPEG header: ") +
+                               tjGetErrorStr2(handle()));
+    return info;
+  }
+
+  // TJFLAG_FASTDCT trades accuracy for speed: the pixels may differ from
+  // stb_image's by a few levels. walk-bench-decode prints the difference.
+  void decode(uint8_t const *data, size_t size, ImageInfo const &info,
+              uint8_t *dst) const override {
+    if (tjDecompress2(handle(), data, size, dst, info.width, info.width * 4,
+                      info.height, TJPF_RGBA, TJFLAG_FASTDCT) != 0)
+      throw std::runtime_error(std::string("failed to decode JPEG: ") +
+                               tjGetErrorStr2(handle()));
+  }
+
+private:
+  // tjhandles must not be shared between threads.
+  static tjhandle handle() {
+    static thread_local std::unique_ptr<void, int (*)(tjhandle)> h(
+        tjInitDecompress(), tjDestroy);
+    if (h == nullptr)
+      throw std::runtime_error("failed to initialize turbojpeg");
+    return h.get();
+  }
+};
+
+} // namespace
+#endif
+
+#ifdef WALK_WITH_SPNG
+namespace {
+
+// Decodes PNG images with libspng.
+class SpngDecoder : public ImageDecoder {
+public:
+  char const *getName() const override { return "spng"; }
+
+  bool canDecode(uint8_t const *data, size_t size) const override {
+    static const uint8_t signature[] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a,
+                                        '\n'};
+    return size >= sizeof(signature) &&
+           memcmp(data, signature, sizeof(signature)) == 0;
+  }
+
+  ImageInfo readInfo(uint8_t const *data, size_t size) const override {
+    Context ctx(data, size);
+    spng_ihdr ihdr;
+    check(spng_get_ihdr(ctx.ctx, &ihdr), "failed to read PNG header");
+    return {int(ihdr.width), int(ihdr.height)};
+  }
+
+  void decode(uint8_t const *data, size_t size, ImageInfo const &info,
+              uint8_t *dst) const override {
+    Context ctx(data, size);
+    check(spng_decode_image(ctx.ctx, dst, size_t(info.width) * info.height * 4,
+                            SPNG_FMT_RGBA8, SPNG_DECODE_TRNS),
+          "failed to decode PNG");
+  }
+
+private:
+  struct Context {
+    Context(uint8_t const *data, size_t size) : ctx(spng_ctx_new(0)) {
+      if (ctx == nullptr)
+        throw std::runtime_error("failed to create a spng context");
+      check(spng_set_png_buffer(ctx, data, size), "failed to read PNG");
+    }
+    ~Context() { spng_ctx_free(ctx); }
+
+    spng_ctx *ctx;
+  };
+
+  static void check(int err, char const *what) {
+    if (err != 0)
+      throw std::runtime_error(std::string(what) + ": " + spng_strerror(err));
+  }
+};
+
+} // namespace
+#endif
+
+namespace {
+
+// Decodes any format supported by stb_image.
+class StbDecoder : public ImageDecoder {
+public:
+  char const *getName() const override { return "stb_image"; }
+
+  bool canDecode(uint8_t const *data, size_t size) const override {
+    return true;
+  }
+
+  ImageInfo readInfo(uint8_t const *data, size_t size) const override {
+    ImageInfo info;
+    int comp;
+    if (!stbi_info_from_memory(data, size, &info.width, &info.height, &comp))
+      throw std::runtime_error(std::string("failed to read image header: ") +
+                               stbi_failure_reason());
+    return info;
+  }
+
+  // stb_image allocates its own buffer, the pixels are copied from it.
+  void decode(uint8_t const *data, size_t size, ImageInfo const &info,
+              uint8_t *dst) const override {
+    int width, height, comp;
+    stbi_uc *pix =
+        stbi_load_from_memory(data, size, &width, &height, &comp, 4);
+    if (pix == nullptr)
+      throw std::runtime_error(std::string("failed to decode image: ") +
+                               stbi_failure_reason());
+
+    if (width != info.width || height != info.height) {
+      stbi_image_free(pix);
+      throw std::runtime_error("image size differs from its header");
+    }
+
+    memcpy(dst, pix, size_t(width) * height * 4);
+    stbi_image_free(pix);
+  }
+};
+
+} // namespace
+
+ImageDecoder const &cst::findImageDecoder(uint8_t const *data, size_t size) {
+#ifdef WALK_WITH_TURBOJPEG
+  static const TurboJPEGDecoder turbojpeg;
+  if (turbojpeg.canDecode(data, size))
+    return turbojpeg;
+#endif
+#ifdef WALK_WITH_SPNG
+  static const SpngDecoder spng;
+  if (spng.canDecode(data, size))
+    return spng;
+#endif
+  static const StbDecoder stb;
+  return stb;
+}
+
+std::vector<uint8_t> cst::decodeImageFile(std::string const &filename,
+                                          ImageInfo &info) {
+  std::vector<uint8_t> const file = loadFile(filename.c_str());
+  ImageDecoder const &decoder = findImageDecoder(file.data(), file.size());
+
+  try {
+    info = decoder.readInfo(file.data(), file.size());
+
+    std::vector<uint8_t> pixels(size_t(info.width) * info.height * 4);
+    decoder.decode(file.data(), file.size(), info, pixels.data());
+    return pixels;
+  } catch (std::runtime_error const &e) {
+    throw std::runtime_error(std::string(e.what()) + ": " + filename);
+  }
+}
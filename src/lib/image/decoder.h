@@ -0,0 +1,70 @@
+/*
+ Copyright (c) 2022 Tero Oinas
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+#ifndef _CST_LIB_IMAGE_DECODER_H
+#define _CST_LIB_IMAGE_DECODER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace cst {
+
+// Dimensions of an encoded image.
+struct ImageInfo {
+  int width = 0;
+  int height = 0;
+};
+
+/**
+ * ImageDecoder decodes encoded images (JPEG, PNG, ...) into RGBA8 pixels.
+ * The decoders are chosen at build time. libjpeg-turbo and libspng are used
+ * when available and stb_image decodes everything else.
+ */
+class ImageDecoder {
+public:
+  virtual ~ImageDecoder() {}
+
+  virtual char const *getName() const = 0;
+
+  // Returns true if the decoder recognizes the encoded data.
+  virtual bool canDecode(uint8_t const *data, size_t size) const = 0;
+
+  // Reads the dimensions of the image.
+  virtual ImageInfo readInfo(uint8_t const *data, size_t size) const = 0;
+
+  // Decodes the image as tightly packed RGBA8 into dst, which must hold
+  // info.width * info.height * 4 bytes.
+  virtual void decode(uint8_t const *data, size_t size, ImageInfo const &info,
+                      uint8_t *dst) const = 0;
+};
+
+// Returns the decoder for the encoded data.
+ImageDecoder const &findImageDecoder(uint8_t const *data, size_t size);
+
+// Loads and decodes an image file into RGBA8.
+std::vector<uint8_t> decodeImageFile(std::string const &filename,
+                                     ImageInfo &info);
+
+} // namespace cst
+
+#endif // _CST_LIB_IMAGE_DECODER_H
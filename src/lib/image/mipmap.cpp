@@ -0,0 +1,153 @@
+/*
+ Copyright (c) 2022 Tero Oinas
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+#include "mipmap.h"
+#include "core/parallel.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace cst;
+
+// Minimum number of rows processed by a task.
+static constexpr size_t MIP_ROWS_PER_TASK = 64;
+
+static float srgbToLinear(float c) {
+  return c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+}
+
+static float linearToSrgb(float c) {
+  return c <= 0.0031308f ? c * 12.92f : 1.055f * powf(c, 1.0f / 2.4f) - 0.055f;
+}
+
+static uint8_t toByte(float v) {
+  return uint8_t(std::clamp(v * 255.0f + 0.5f, 0.0f, 255.0f));
+}
+
+// Converts RGBA8 pixels into the floating point space the filter works in.
+static std::vector<float> decode(uint8_t const *pixels, size_t numPixels,
+                                 MipFilter filter) {
+  static float srgbTable[256];
+  static bool tableInitialized = [] {
+    for (int i = 0; i < 256; i++)
+      srgbTable[i] = srgbToLinear(i / 255.0f);
+    return true;
+  }();
+  (void)tableInitialized;
+
+  std::vector<float> out(numPixels * 4);
+  for (size_t i = 0; i < numPixels * 4; i++) {
+    uint8_t v = pixels[i];
+    bool color = (i % 4) != 3;
+
+    if (filter == MIP_FILTER_SRGB && color)
+      out[i] = srgbTable[v];
+    else if (filter == MIP_FILTER_NORMAL && color)
+      out[i] = v / 127.5f - 1.0f;
+    else
+      out[i] = v / 255.0f;
+  }
+  return out;
+}
+
+// Converts the floating point pixels of a level into RGBA8.
+static std::vector<uint8_t> encode(std::vector<float> const &pix,
+                                   MipFilter filter) {
+  std::vector<uint8_t> out(pix.size());
+  for (size_t i = 0; i < pix.size(); i++) {
+    bool color = (i % 4) != 3;
+
+    if (filter == MIP_FILTER_SRGB && color)
+      out[i] = toByte(linearToSrgb(pix[i]));
+    else if (filter == MIP_FILTER_NORMAL && color)
+      out[i] = toByte(pix[i] * 0.5f + 0.5f);
+    else
+      out[i] = toByte(pix[i]);
+  }
+  return out;
+}
+
+// Box filters a level into one of half the size. Odd sizes are handled by
+// clamping the source coordinates to the edge.
+static std::vector<float> downsample(std::vector<float> const &src, int sw,
+                                     int sh, int dw, int dh,
+                                     MipFilter filter) {
+  std::vector<float> dst(size_t(dw) * dh * 4);
+
+  parallelFor(dh, MIP_ROWS_PER_TASK, [&](size_t begin, size_t end, size_t) {
+    for (size_t y = begin; y < end; y++) {
+      int y0 = std::min<int>(y * 2, sh - 1);
+      int y1 = std::min<int>(y * 2 + 1, sh - 1);
+
+      for (int x = 0; x < dw; x++) {
+        int x0 = std::min(x * 2, sw - 1);
+        int x1 = std::min(x * 2 + 1, sw - 1);
+
+        float const *p00 = &src[(size_t(y0) * sw + x0) * 4];
+        float const *p01 = &src[(size_t(y0) * sw + x1) * 4];
+        float const *p10 = &src[(size_t(y1) * sw + x0) * 4];
+        float const *p11 = &src[(size_t(y1) * sw + x1) * 4];
+        float *d = &dst[(y * dw + x) * 4];
+
+        for (int c = 0; c < 4; c++)
+          d[c] = (p00[c] + p01[c] + p10[c] + p11[c]) * 0.25f;
+
+        if (filter == MIP_FILTER_NORMAL) {
+          float len = sqrtf(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+          if (len > 1e-6f) {
+            d[0] /= len;
+            d[1] /= len;
+            d[2] /= len;
+          } else {
+            d[0] = 0.0f;
+            d[1] = 0.0f;
+            d[2] = 1.0f;
+          }
+        }
+      }
+    }
+  });
+  return dst;
+}
+
+std::vector<MipLevel> cst::generateMipChain(uint8_t const *pixels, int width,
+                                            int height, MipFilter filter) {
+  std::vector<MipLevel> levels;
+  levels.push_back(
+      {width, height,
+       std::vector<uint8_t>(pixels, pixels + size_t(width) * height * 4)});
+
+  std::vector<float> cur = decode(pixels, size_t(width) * height, filter);
+  int w = width, h = height;
+
+  while (w > 1 || h > 1) {
+    int nw = std::max(1, w / 2);
+    int nh = std::max(1, h / 2);
+
+    cur = downsample(cur, w, h, nw, nh, filter);
+    levels.push_back({nw, nh, encode(cur, filter)});
+
+    w = nw;
+    h = nh;
+  }
+
+  return levels;
+}
@@ -0,0 +1,56 @@
+/*
+ Copyright (c) 2022 Tero Oinas
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+#ifndef _CST_LIB_IMAGE_MIPMAP_H
+#define _CST_LIB_IMAGE_MIPMAP_H
+
+#include <cstdint>
+#include <vector>
+
+namespace cst {
+
+// Decides how the pixels of an image are averaged into smaller mip levels.
+enum MipFilter {
+  MIP_FILTER_SRGB,   // RGB is sRGB encoded color, averaged in linear space
+  MIP_FILTER_LINEAR, // all channels are linear data
+  MIP_FILTER_NORMAL  // RGB is a normal map, averaged and renormalized
+};
+
+/**
+ * MipLevel is one level of a mip chain in RGBA8.
+ */
+struct MipLevel {
+  int width;
+  int height;
+  std::vector<uint8_t> pixels;
+};
+
+/**
+ * Generates a full mip chain from an RGBA8 image down to 1x1 pixels. The
+ * first level is a copy of the given image. Levels are filtered with a box
+ * filter in floating point from the previous level.
+ */
+std::vector<MipLevel> generateMipChain(uint8_t const *pixels, int width,
+                                       int height, MipFilter filter);
+
+} // namespace cst
+
+#endif // _CST_LIB_IMAGE_MIPMAP_H
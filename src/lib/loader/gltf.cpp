@@ -26,9 +26,17 @@
 #include "math/quat.h"
 #include "sg/empty.h"
 #include "sg/light.h"
+#include "sg/texture_cache.h"
 
 using namespace cst;
 
+// Whether KTX2 images of KHR_texture_basisu can be transcoded.
+#ifdef WALK_WITH_BASISU
+static constexpr bool HAVE_BASISU = true;
+#else
+static constexpr bool HAVE_BASISU = false;
+#endif
+
 GLTFLoader::GLTFLoader(bool flatShading, bool deduplicateVertices,
                        bool doLoadTextures, bool doLoadLights)
     : flatShading(flatShading), deduplicateVertices(deduplicateVertices),
@@ -145,7 +153,8 @@ void GLTFLoader::loadVertices(tinygltf::Primitive const &prim,
         float *d =
             (float *)(buf.data.data() + view.byteOffset + acc.byteOffset);
         for (size_t i = 0; i < acc.count; i++) {
-          vertices[i].tangent = vec3(d[i * 4], d[i * 4 + 1], d[i * 4 + 2]);
+          vertices[i].tangent =
+              vec4(d[i * 4], d[i * 4 + 1], d[i * 4 + 2], d[i * 4 + 3]);
         }
         tangentsLoaded = true;
       }
@@ -156,6 +165,29 @@ void GLTFLoader::loadVertices(tinygltf::Primitive const &prim,
     throw std::runtime_error("no normals given in the model");
 }
 
+std::string cst::textureFilename(tinygltf::Model const &model,
+                                 std::string const &dirPath, int index) {
+  if (index < 0)
+    return "";
+
+  assert((int)model.textures.size() > index);
+  tinygltf::Texture const &mtex = model.textures[index];
+
+  // KHR_texture_basisu gives a KTX2 image. It is preferred over the
+  // fallback source when the basis transcoder is available.
+  int source = mtex.source;
+  auto basisu = mtex.extensions.find("KHR_texture_basisu");
+  if (basisu != mtex.extensions.end() && basisu->second.Has("source") &&
+      (HAVE_BASISU || source < 0))
+    source = basisu->second.Get("source").GetNumberAsInt();
+
+  if (source < 0)
+    return "";
+
+  assert((int)model.images.size() > source);
+  return dirPath + "/" + model.images[source].uri;
+}
+
 material_ptr GLTFLoader::loadMaterial(tinygltf::Material const &tm) {
   vec4 albedo{0.8f, 0.8f, 0.8f, 1.0f};
   float metallic = 0.0f;
@@ -170,83 +202,34 @@ material_ptr GLTFLoader::loadMaterial(tinygltf::Material const &tm) {
     roughness = tm.pbrMetallicRoughness.roughnessFactor;
   }
 
-  // Refactor these
-  std::string albedoTexName;
-  if (tm.pbrMetallicRoughness.baseColorTexture.index >= 0) {
-    assert((int)model.textures.size() >
-           tm.pbrMetallicRoughness.baseColorTexture.index);
-
-    tinygltf::Texture const &mtex =
-        model.textures[tm.pbrMetallicRoughness.baseColorTexture.index];
-
-    assert(mtex.source >= 0 && (int)model.images.size() > mtex.source);
-    tinygltf::Image const &mimage = model.images[mtex.source];
-
-    albedoTexName = dirPath + "/" + mimage.uri;
-  }
-
-  std::string roughnessTexName;
-  if (tm.pbrMetallicRoughness.metallicRoughnessTexture.index >= 0) {
-    assert((int)model.textures.size() >
-           tm.pbrMetallicRoughness.metallicRoughnessTexture.index);
-
-    tinygltf::Texture const &mtex =
-        model.textures[tm.pbrMetallicRoughness.metallicRoughnessTexture.index];
-
-    assert(mtex.source >= 0 && (int)model.images.size() > mtex.source);
-    tinygltf::Image const &mimage = model.images[mtex.source];
-
-    roughnessTexName = dirPath + "/" + mimage.uri;
-  }
-
-  std::string normalTexName;
-  if (tm.normalTexture.index >= 0) {
-    assert((int)model.textures.size() > tm.normalTexture.index);
-
-    tinygltf::Texture const &mtex = model.textures[tm.normalTexture.index];
-
-    assert(mtex.source >= 0 && (int)model.images.size() > mtex.source);
-    tinygltf::Image const &mimage = model.images[mtex.source];
-
-    normalTexName = dirPath + "/" + mimage.uri;
-  }
+  std::string albedoTexName =
+      textureFilename(tm.pbrMetallicRoughness.baseColorTexture.index);
+  std::string roughnessTexName =
+      textureFilename(tm.pbrMetallicRoughness.metallicRoughnessTexture.index);
+  std::string normalTexName = textureFilename(tm.normalTexture.index);
 
   // tm.doubleSided
   material_ptr mat = std::make_shared<MaterialStd>(
       flatShading ? SHADE_MODE_FLAT : SHADE_MODE_SMOOTH, albedo, metallic,
       roughness, ao, false);
+  mat->setName(name);
   if (albedoTexName != "" && doLoadTextures) {
-    texture_ptr albedoTex = Texture::getNamed(albedoTexName);
-    if (albedoTex == nullptr) {
-      albedoTex =
-          std::make_shared<TextureStd>(albedoTexName, TEXTURE_TYPE_ALBEDO);
-      textures[albedoTexName] = albedoTex;
-    }
-    albedoTex->load();
-
+    texture_ptr albedoTex = loadTexture(albedoTexName, TEXTURE_TYPE_ALBEDO);
+    textures[albedoTexName] = albedoTex;
     mat->setAlbedoTex(albedoTex);
   }
 
   if (roughnessTexName != "" && doLoadTextures) {
-    texture_ptr roughnessTex = Texture::getNamed(roughnessTexName);
-    if (roughnessTex == nullptr) {
-      roughnessTex = std::make_shared<TextureStd>(roughnessTexName,
-                                                  TEXTURE_TYPE_ROUGHNESS);
-      textures[roughnessTexName] = roughnessTex;
-    }
-    roughnessTex->load();
+    texture_ptr roughnessTex =
+        loadTexture(roughnessTexName, TEXTURE_TYPE_ROUGHNESS);
+    textures[roughnessTexName] = roughnessTex;
     mat->setRoughnessTex(roughnessTex,
                          roughnessTexName.find("_arm_") != std::string::npos);
   }
 
   if (normalTexName != "" && doLoadTextures) {
-    texture_ptr normalTex = Texture::getNamed(normalTexName);
-    if (normalTex == nullptr) {
-      normalTex =
-          std::make_shared<TextureStd>(normalTexName, TEXTURE_TYPE_NORMAL);
-      textures[normalTexName] = normalTex;
-    }
-    normalTex->load();
+    texture_ptr normalTex = loadTexture(normalTexName, TEXTURE_TYPE_NORMAL);
+    textures[normalTexName] = normalTex;
     mat->setNormalTex(normalTex);
   }
   return mat;
@@ -27,6 +27,13 @@
 
 namespace cst {
 
+// Returns the filename of the image of texture index of a model loaded from
+// dirPath, or "" if index is -1 or the texture has no image. The KTX2 image
+// of KHR_texture_basisu is preferred when the basis transcoder is built in,
+// otherwise it is used only if there is no fallback image.
+std::string textureFilename(tinygltf::Model const &model,
+                            std::string const &dirPath, int index);
+
 /**
  * GLTF model loader
  */
@@ -47,6 +54,10 @@ private:
                    std::vector<uint32_t> &indices);
   void loadVertices(tinygltf::Primitive const &prim,
                     std::vector<vertex> &vertices, bool &tangentsLoaded);
+  // Returns the image filename of a texture or "" if index is -1.
+  std::string textureFilename(int index) const {
+    return cst::textureFilename(model, dirPath, index);
+  }
   material_ptr loadMaterial(tinygltf::Material const &tm);
   std::vector<mesh_ptr> loadMesh(tinygltf::Mesh const &mesh);
   void loadNode(tinygltf::Node const &m_node, int depth, node_ptr root);
@@ -20,6 +20,10 @@
  SOFTWARE.
  */
 #include "aabb.h"
+#include "frustum.h"
+#include "simd.h"
+
+#include <algorithm>
 #include <iostream>
 
 using namespace cst;
@@ -52,53 +56,49 @@ void AABB::extend(vec3 const &v) {
     p2.d[2] = v.d[2];
 }
 
-bool is_inside(vec4 const &v) {
-  return v.x() >= -v.w() && v.x() <= v.w() && //
-         v.y() >= -v.w() && v.y() <= v.w() && //
-         v.z() >= 0.0f && v.z() <= v.w();
+bool AABB::isVisible(mat4 const &tr) const {
+  return Frustum(tr).isVisible(*this);
 }
 
-bool AABB::isVisible(mat4 const &tr) const {
-  vec4 const k1 = tr * p1;
-  vec4 const k2 = tr * p2;
-  vec4 const k3 = tr * vec3(p2.x(), p1.y(), p1.z());
-  vec4 const k4 = tr * vec3(p2.x(), p1.y(), p2.z());
-  vec4 const k5 = tr * vec3(p1.x(), p1.y(), p2.z());
-  vec4 const k6 = tr * vec3(p1.x(), p2.y(), p2.z());
-  vec4 const k7 = tr * vec3(p1.x(), p2.y(), p1.z());
-  vec4 const k8 = tr * vec3(p2.x(), p2.y(), p1.z());
-
-  if ((k1.x() < -k1.w()) && (k2.x() < -k2.w()) && (k3.x() < -k3.w()) &&
-      (k4.x() < -k4.w()) && (k5.x() < -k5.w()) && (k6.x() < -k6.w()) &&
-      (k7.x() < -k7.w()) && (k8.x() < -k8.w()))
-    return false;
-
-  if ((k1.x() > k1.w()) && (k2.x() > k2.w()) && (k3.x() > k3.w()) &&
-      (k4.x() > k4.w()) && (k5.x() > k5.w()) && (k6.x() > k6.w()) &&
-      (k7.x() > k7.w()) && (k8.x() > k8.w()))
-    return false;
-
-  if ((k1.y() < -k1.w()) && (k2.y() < -k2.w()) && (k3.y() < -k3.w()) &&
-      (k4.y() < -k4.w()) && (k5.y() < -k5.w()) && (k6.y() < -k6.w()) &&
-      (k7.y() < -k7.w()) && (k8.y() < -k8.w()))
-    return false;
-
-  if ((k1.y() > k1.w()) && (k2.y() > k2.w()) && (k3.y() > k3.w()) &&
-      (k4.y() > k4.w()) && (k5.y() > k5.w()) && (k6.y() > k6.w()) &&
-      (k7.y() > k7.w()) && (k8.y() > k8.w()))
-    return false;
-
-  if ((k1.z() < 0.0f) && (k2.z() < 0.0f) && (k3.z() < 0.0f) &&
-      (k4.z() < 0.0f) && (k5.z() < 0.0f) && (k6.z() < 0.0f) &&
-      (k7.z() < 0.0f) && (k8.z() < 0.0f))
-    return false;
-
-  if ((k1.z() > k1.w()) && (k2.z() > k2.w()) && (k3.z() > k3.w()) &&
-      (k4.z() > k4.w()) && (k5.z() > k5.w()) && (k6.z() > k6.w()) &&
-      (k7.z() > k7.w()) && (k8.z() > k8.w()))
-    return false;
-
-  return true;
+AABB AABB::operator*(mat4 const &tr) const {
+  return transformAABB(tr, *this);
+}
+
+AABB cst::transformAABB(mat4 const &tr, AABB const &aabb) {
+  using namespace simd;
+
+  vec3 const c = aabb.center();
+  vec3 const e = aabb.extent();
+  float4 const m0 = load(tr.m), m1 = load(tr.m + 4), m2 = load(tr.m + 8);
+
+  float4 const center =
+      madd(m0, splat(c.x()),
+           madd(m1, splat(c.y()), madd(m2, splat(c.z()), load(tr.m + 12))));
+  float4 const extent =
+      madd(abs(m0), splat(e.x()),
+           madd(abs(m1), splat(e.y()), mul(abs(m2), splat(e.z()))));
+
+  float lo[4], hi[4];
+  store(lo, sub(center, extent));
+  store(hi, add(center, extent));
+  return AABB(vec3(lo[0], lo[1], lo[2]), vec3(hi[0], hi[1], hi[2]));
+}
+
+AABB cst::transformAABBScalar(mat4 const &tr, AABB const &aabb) {
+  float const *m = tr.m;
+  AABB r(tr.getTranslation(), tr.getTranslation());
+
+  // Each term of the transformed coordinates is smallest and largest at
+  // one of the bounds of the source box.
+  for (int i = 0; i < 3; i++) {
+    for (int j = 0; j < 3; j++) {
+      float a = m[j * 4 + i] * aabb.p1.d[j];
+      float b = m[j * 4 + i] * aabb.p2.d[j];
+      r.p1.d[i] += std::min(a, b);
+      r.p2.d[i] += std::max(a, b);
+    }
+  }
+  return r;
 }
 
 AABB cst::operator*(mat4 const &tr, AABB const &aabb) { return aabb * tr; }
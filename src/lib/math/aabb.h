@@ -39,6 +39,11 @@ struct AABB {
 
   // vec3 size() const { return p2 - p1; }
 
+  vec3 center() const { return (p1 + p2) * 0.5f; }
+
+  // Returns the half extents of the AABB.
+  vec3 extent() const { return (p2 - p1) * 0.5f; }
+
   // Extends the AABB by a vertex.
   void extend(vec3 const &v);
 
@@ -64,16 +69,27 @@ struct AABB {
 
   bool operator!=(AABB const &b) const { return p1 != b.p1 || p2 == b.p2; }
 
+  // Returns true if the AABB is at least partly inside the view frustum of
+  // the given projection * view matrix.
   bool isVisible(mat4 const &tr) const;
 
-  // Returns the AABB transformed by the given matrix.
-  AABB operator*(mat4 const &tr) const { return AABB(tr * p1, tr * p2); }
+  // Returns the AABB enclosing this AABB transformed by the given matrix.
+  // Same as transformAABB(tr, *this).
+  AABB operator*(mat4 const &tr) const;
 
   vec3 p1;
   vec3 p2;
 };
 
 AABB operator*(mat4 const &tr, AABB const &aabb);
+
+// Returns the smallest AABB enclosing aabb transformed by the affine matrix
+// tr. Uses the absolute values of the matrix (Arvo's method) instead of
+// transforming the eight corners, with SIMD instructions when available.
+AABB transformAABB(mat4 const &tr, AABB const &aabb);
+
+// Scalar version of transformAABB.
+AABB transformAABBScalar(mat4 const &tr, AABB const &aabb);
 std::ostream &operator<<(std::ostream &os, AABB const &aabb);
 
 } // namespace cst
@@ -0,0 +1,104 @@
+/*
+ Copyright (c) 2022 Tero Oinas
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+#include "frustum.h"
+#include "simd.h"
+
+using namespace cst;
+
+Frustum::Frustum(mat4 const &projView) {
+  float const *m = projView.m;
+  vec4 const r0(m[0], m[4], m[8], m[12]);
+  vec4 const r1(m[1], m[5], m[9], m[13]);
+  vec4 const r2(m[2], m[6], m[10], m[14]);
+  vec4 const r3(m[3], m[7], m[11], m[15]);
+
+  planes[0] = r3 + r0; // left
+  planes[1] = r3 - r0; // right
+  planes[2] = r3 + r1; // bottom
+  planes[3] = r3 - r1; // top
+  planes[4] = r2;      // near
+  planes[5] = r3 - r2; // far
+
+  for (vec4 &p : planes) {
+    float len = vec3(p).len();
+    if (len > 0.0f)
+      p = p / len;
+  }
+}
+
+bool Frustum::isVisible(vec3 const &c, vec3 const &e) const {
+  for (vec4 const &p : planes) {
+    float const *n = p.d;
+    float dist = n[0] * c.d[0] + n[1] * c.d[1] + n[2] * c.d[2] + n[3];
+    float radius = std::fabs(n[0]) * e.d[0] + std::fabs(n[1]) * e.d[1] +
+                   std::fabs(n[2]) * e.d[2];
+    if (dist + radius < 0.0f)
+      return false;
+  }
+  return true;
+}
+
+bool Frustum::contains(AABB const &box) const {
+  vec3 const c = box.center();
+  vec3 const e = box.extent();
+
+  for (vec4 const &p : planes) {
+    float const *n = p.d;
+    float dist = n[0] * c.d[0] + n[1] * c.d[1] + n[2] * c.d[2] + n[3];
+    float radius = std::fabs(n[0]) * e.d[0] + std::fabs(n[1]) * e.d[1] +
+                   std::fabs(n[2]) * e.d[2];
+    if (dist - radius < 0.0f)
+      return false;
+  }
+  return true;
+}
+
+void Frustum::testBoxes(float const *cx, float const *cy, float const *cz,
+                        float const *ex, float const *ey, float const *ez,
+                        size_t n, uint8_t *visible) const {
+  using namespace simd;
+
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    float4 const x = load(cx + i), y = load(cy + i), z = load(cz + i);
+    float4 const hx = load(ex + i), hy = load(ey + i), hz = load(ez + i);
+
+    int outside = 0;
+    for (vec4 const &p : planes) {
+      float const *pn = p.d;
+      float4 dist = madd(splat(pn[0]), x, splat(pn[3]));
+      dist = madd(splat(pn[1]), y, dist);
+      dist = madd(splat(pn[2]), z, dist);
+      dist = madd(splat(std::fabs(pn[0])), hx, dist);
+      dist = madd(splat(std::fabs(pn[1])), hy, dist);
+      dist = madd(splat(std::fabs(pn[2])), hz, dist);
+      outside |= lessMask(dist, splat(0.0f));
+    }
+
+    for (int j = 0; j < 4; j++)
+      visible[i + j] = !(outside & (1 << j));
+  }
+
+  for (; i < n; i++)
+    visible[i] =
+        isVisible(vec3(cx[i], cy[i], cz[i]), vec3(ex[i], ey[i], ez[i]));
+}
@@ -0,0 +1,65 @@
+/*
+ Copyright (c) 2022 Tero Oinas
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+#ifndef _CST_LIB_MATH_FRUSTUM_H
+#define _CST_LIB_MATH_FRUSTUM_H
+
+#include "aabb.h"
+
+namespace cst {
+
+/**
+ * Frustum is the view volume of a camera as six planes. Boxes are tested
+ * against the planes by their center and half extents. The test is
+ * conservative: a box near an edge of the frustum may be reported visible
+ * although it is outside.
+ */
+struct Frustum {
+  Frustum() {}
+
+  // Extracts the planes from a projection * view matrix. The clip space is
+  // that of Vulkan (-w <= x, y <= w, 0 <= z <= w).
+  explicit Frustum(mat4 const &projView);
+
+  // Returns true if the box is at least partly inside the frustum.
+  bool isVisible(AABB const &box) const {
+    return isVisible(box.center(), box.extent());
+  }
+
+  bool isVisible(vec3 const &center, vec3 const &extent) const;
+
+  // Returns true if the box is entirely inside the frustum.
+  bool contains(AABB const &box) const;
+
+  // Tests n boxes given as centers and half extents in SoA form, four boxes
+  // at a time. visible[i] is set to 1 for boxes at least partly inside and
+  // to 0 for the others.
+  void testBoxes(float const *cx, float const *cy, float const *cz,
+                 float const *ex, float const *ey, float const *ez, size_t n,
+                 uint8_t *visible) const;
+
+  // Planes as (normal, distance) with the normals pointing inside.
+  vec4 planes[6];
+};
+
+} // namespace cst
+
+#endif // _CST_LIB_MATH_FRUSTUM_H
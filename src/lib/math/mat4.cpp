@@ -19,6 +19,7 @@
  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 #include "mat4.h"
+#include "simd.h"
 
 using namespace cst;
 
@@ -79,69 +80,96 @@ mat4::mat4(std::vector<double> const &v)
 
 mat4 mat4::transpose() const
 {
-  return mat4(m[0], m[4], m[8], m[12],  //
-              m[1], m[5], m[9], m[13],  //
-              m[2], m[6], m[10], m[14], //
-              m[3], m[7], m[11], m[15]);
+  simd::float4 c0 = simd::load(m), c1 = simd::load(m + 4),
+               c2 = simd::load(m + 8), c3 = simd::load(m + 12);
+  simd::transpose(c0, c1, c2, c3);
+
+  mat4 r;
+  simd::store(r.m, c0);
+  simd::store(r.m + 4, c1);
+  simd::store(r.m + 8, c2);
+  simd::store(r.m + 12, c3);
+  return r;
+}
+
+// Products of 2x2 matrices stored in a vector as (m00, m01, m10, m11).
+// A * B
+static inline simd::float4 mat2Mul(simd::float4 a, simd::float4 b)
+{
+  using namespace simd;
+  return madd(a, swizzle<0, 3, 0, 3>(b),
+              mul(swizzle<1, 0, 3, 2>(a), swizzle<2, 1, 2, 1>(b)));
+}
+
+// adj(A) * B
+static inline simd::float4 mat2AdjMul(simd::float4 a, simd::float4 b)
+{
+  using namespace simd;
+  return sub(mul(swizzle<3, 3, 0, 0>(a), b),
+             mul(swizzle<1, 1, 2, 2>(a), swizzle<2, 3, 0, 1>(b)));
+}
+
+// A * adj(B)
+static inline simd::float4 mat2MulAdj(simd::float4 a, simd::float4 b)
+{
+  using namespace simd;
+  return sub(mul(a, swizzle<3, 0, 3, 0>(b)),
+             mul(swizzle<1, 0, 3, 2>(a), swizzle<2, 1, 2, 1>(b)));
 }
 
+// Inverts the matrix blockwise from its four 2x2 sub-matrices. The columns
+// are treated as rows, which inverts the transpose and gives the inverse in
+// the same column-major layout.
 mat4 mat4::invert() const
 {
-  float a00 = m[0];
-  float a01 = m[1];
-  float a02 = m[2];
-  float a03 = m[3];
-  float a10 = m[4];
-  float a11 = m[5];
-  float a12 = m[6];
-  float a13 = m[7];
-  float a20 = m[8];
-  float a21 = m[9];
-  float a22 = m[10];
-  float a23 = m[11];
-  float a30 = m[12];
-  float a31 = m[13];
-  float a32 = m[14];
-  float a33 = m[15];
-
-  float b00 = a00 * a11 - a01 * a10;
-  float b01 = a00 * a12 - a02 * a10;
-  float b02 = a00 * a13 - a03 * a10;
-  float b03 = a01 * a12 - a02 * a11;
-  float b04 = a01 * a13 - a03 * a11;
-  float b05 = a02 * a13 - a03 * a12;
-  float b06 = a20 * a31 - a21 * a30;
-  float b07 = a20 * a32 - a22 * a30;
-  float b08 = a20 * a33 - a23 * a30;
-  float b09 = a21 * a32 - a22 * a31;
-  float b10 = a21 * a33 - a23 * a31;
-  float b11 = a22 * a33 - a23 * a32;
-
-  float det = b00 * b11 - b01 * b10 + b02 * b09 + b03 * b08 - b04 * b07 + b05 * b06;
-
-  if (det == 0.0f)
+  using namespace simd;
+
+  float4 const c0 = load(m), c1 = load(m + 4), c2 = load(m + 8),
+               c3 = load(m + 12);
+
+  float4 const a = shuffle<0, 1, 0, 1>(c0, c1);
+  float4 const b = shuffle<2, 3, 2, 3>(c0, c1);
+  float4 const c = shuffle<0, 1, 0, 1>(c2, c3);
+  float4 const d = shuffle<2, 3, 2, 3>(c2, c3);
+
+  // Determinants of the sub-matrices as (|A|, |B|, |C|, |D|).
+  float4 const detSub =
+      sub(mul(shuffle<0, 2, 0, 2>(c0, c2), shuffle<1, 3, 1, 3>(c1, c3)),
+          mul(shuffle<1, 3, 1, 3>(c0, c2), shuffle<0, 2, 0, 2>(c1, c3)));
+  float4 const detA = splat<0>(detSub);
+  float4 const detB = splat<1>(detSub);
+  float4 const detC = splat<2>(detSub);
+  float4 const detD = splat<3>(detSub);
+
+  float4 const dc = mat2AdjMul(d, c);
+  float4 const ab = mat2AdjMul(a, b);
+
+  // Adjugates of the blocks of the inverse.
+  float4 x = sub(mul(detD, a), mat2Mul(b, dc));
+  float4 w = sub(mul(detA, d), mat2Mul(c, ab));
+  float4 y = sub(mul(detB, c), mat2MulAdj(d, ab));
+  float4 z = sub(mul(detC, b), mat2MulAdj(a, dc));
+
+  // |M| = |A||D| + |B||C| - tr(adj(A)B adj(D)C)
+  float4 tr = mul(ab, swizzle<0, 2, 1, 3>(dc));
+  tr = add(tr, swizzle<1, 0, 3, 2>(tr));
+  tr = add(tr, swizzle<2, 3, 0, 1>(tr));
+  float4 const det = sub(madd(detA, detD, mul(detB, detC)), tr);
+
+  if (first(det) == 0.0f)
     throw std::runtime_error("mat4::invert: zero determinant");
 
-  det = 1.0 / det;
+  float4 const rdet = div(set(1.0f, -1.0f, -1.0f, 1.0f), det);
+  x = mul(x, rdet);
+  y = mul(y, rdet);
+  z = mul(z, rdet);
+  w = mul(w, rdet);
 
   mat4 r;
-  float *out = r.m;
-  out[0] = (a11 * b11 - a12 * b10 + a13 * b09) * det;
-  out[1] = (a02 * b10 - a01 * b11 - a03 * b09) * det;
-  out[2] = (a31 * b05 - a32 * b04 + a33 * b03) * det;
-  out[3] = (a22 * b04 - a21 * b05 - a23 * b03) * det;
-  out[4] = (a12 * b08 - a10 * b11 - a13 * b07) * det;
-  out[5] = (a00 * b11 - a02 * b08 + a03 * b07) * det;
-  out[6] = (a32 * b02 - a30 * b05 - a33 * b01) * det;
-  out[7] = (a20 * b05 - a22 * b02 + a23 * b01) * det;
-  out[8] = (a10 * b10 - a11 * b08 + a13 * b06) * det;
-  out[9] = (a01 * b08 - a00 * b10 - a03 * b06) * det;
-  out[10] = (a30 * b04 - a31 * b02 + a33 * b00) * det;
-  out[11] = (a21 * b02 - a20 * b04 - a23 * b00) * det;
-  out[12] = (a11 * b07 - a10 * b09 - a12 * b06) * det;
-  out[13] = (a00 * b09 - a01 * b07 + a02 * b06) * det;
-  out[14] = (a31 * b01 - a30 * b03 - a32 * b00) * det;
-  out[15] = (a20 * b03 - a21 * b01 + a22 * b00) * det;
+  store(r.m, shuffle<3, 1, 3, 1>(x, y));
+  store(r.m + 4, shuffle<2, 0, 2, 0>(x, y));
+  store(r.m + 8, shuffle<3, 1, 3, 1>(z, w));
+  store(r.m + 12, shuffle<2, 0, 2, 0>(z, w));
   return r;
 }
 
@@ -250,15 +278,21 @@ mat4 mat4::project(float aspect, float fov, float near, float far)
       0.0f, 0.0f, (near * far) / (near - far), 0.0f);
 }
 
-vec4 cst::operator*(mat4 const &mat, vec4 const &vec)
+// Returns m . v for a column vector in a SIMD register.
+static inline simd::float4 mulColumn(float const *m, simd::float4 v)
 {
-  float const *m = mat.m;
-  float const *v = vec.d;
+  using namespace simd;
+  float4 r = mul(load(m), splat<0>(v));
+  r = madd(load(m + 4), splat<1>(v), r);
+  r = madd(load(m + 8), splat<2>(v), r);
+  return madd(load(m + 12), splat<3>(v), r);
+}
 
-  return vec4(m[0] * v[0] + m[4] * v[1] + m[8] * v[2] + m[12] * v[3],
-              m[1] * v[0] + m[5] * v[1] + m[9] * v[2] + m[13] * v[3],
-              m[2] * v[0] + m[6] * v[1] + m[10] * v[2] + m[14] * v[3],
-              m[3] * v[0] + m[7] * v[1] + m[11] * v[2] + m[15] * v[3]);
+vec4 cst::operator*(mat4 const &mat, vec4 const &vec)
+{
+  vec4 r;
+  simd::store(r.d, mulColumn(mat.m, simd::load(vec.d)));
+  return r;
 }
 
 mat4 cst::operator*(mat4 const &am, mat4 const &bm)
@@ -266,25 +300,82 @@ mat4 cst::operator*(mat4 const &am, mat4 const &bm)
   float const *a = am.m;
   float const *b = bm.m;
 
-  return mat4(a[0] * b[0] + a[4] * b[1] + a[8] * b[2] + a[12] * b[3],
-              a[1] * b[0] + a[5] * b[1] + a[9] * b[2] + a[13] * b[3],
-              a[2] * b[0] + a[6] * b[1] + a[10] * b[2] + a[14] * b[3],
-              a[3] * b[0] + a[7] * b[1] + a[11] * b[2] + a[15] * b[3],
-
-              a[0] * b[4] + a[4] * b[5] + a[8] * b[6] + a[12] * b[7],
-              a[1] * b[4] + a[5] * b[5] + a[9] * b[6] + a[13] * b[7],
-              a[2] * b[4] + a[6] * b[5] + a[10] * b[6] + a[14] * b[7],
-              a[3] * b[4] + a[7] * b[5] + a[11] * b[6] + a[15] * b[7],
-
-              a[0] * b[8] + a[4] * b[9] + a[8] * b[10] + a[12] * b[11],
-              a[1] * b[8] + a[5] * b[9] + a[9] * b[10] + a[13] * b[11],
-              a[2] * b[8] + a[6] * b[9] + a[10] * b[10] + a[14] * b[11],
-              a[3] * b[8] + a[7] * b[9] + a[11] * b[10] + a[15] * b[11],
-
-              a[0] * b[12] + a[4] * b[13] + a[8] * b[14] + a[12] * b[15],
-              a[1] * b[12] + a[5] * b[13] + a[9] * b[14] + a[13] * b[15],
-              a[2] * b[12] + a[6] * b[13] + a[10] * b[14] + a[14] * b[15],
-              a[3] * b[12] + a[7] * b[13] + a[11] * b[14] + a[15] * b[15]);
+  mat4 r;
+  for (int i = 0; i < 16; i += 4)
+    simd::store(r.m + i, mulColumn(a, simd::load(b + i)));
+  return r;
+}
+
+void cst::mulMatrices(mat4 const *a, mat4 const *b, mat4 *out, size_t n)
+{
+  for (size_t i = 0; i < n; i++)
+  {
+    float const *am = a[i].m;
+    simd::float4 c0 = mulColumn(am, simd::load(b[i].m));
+    simd::float4 c1 = mulColumn(am, simd::load(b[i].m + 4));
+    simd::float4 c2 = mulColumn(am, simd::load(b[i].m + 8));
+    simd::float4 c3 = mulColumn(am, simd::load(b[i].m + 12));
+    simd::store(out[i].m, c0);
+    simd::store(out[i].m + 4, c1);
+    simd::store(out[i].m + 8, c2);
+    simd::store(out[i].m + 12, c3);
+  }
+}
+
+void cst::mulMatrices(mat4 const &a, mat4 const *b, mat4 *out, size_t n)
+{
+  using namespace simd;
+
+  float4 const a0 = load(a.m), a1 = load(a.m + 4), a2 = load(a.m + 8),
+               a3 = load(a.m + 12);
+
+  for (size_t i = 0; i < n; i++)
+  {
+    float4 cols[4];
+    for (int j = 0; j < 4; j++)
+    {
+      float4 v = load(b[i].m + j * 4);
+      cols[j] = madd(a3, splat<3>(v),
+                     madd(a2, splat<2>(v),
+                          madd(a1, splat<1>(v), mul(a0, splat<0>(v)))));
+    }
+    for (int j = 0; j < 4; j++)
+      store(out[i].m + j * 4, cols[j]);
+  }
+}
+
+void cst::transformPoints(mat4 const &m, float const *x, float const *y,
+                          float const *z, float *ox, float *oy, float *oz,
+                          size_t n)
+{
+  using namespace simd;
+
+  float4 const m0 = splat(m.m[0]), m1 = splat(m.m[1]), m2 = splat(m.m[2]);
+  float4 const m4 = splat(m.m[4]), m5 = splat(m.m[5]), m6 = splat(m.m[6]);
+  float4 const m8 = splat(m.m[8]), m9 = splat(m.m[9]), m10 = splat(m.m[10]);
+  float4 const m12 = splat(m.m[12]), m13 = splat(m.m[13]),
+               m14 = splat(m.m[14]);
+
+  // Four points per iteration, the rest one at a time.
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4)
+  {
+    float4 const px = load(x + i), py = load(y + i), pz = load(z + i);
+    float4 const rx = madd(m0, px, madd(m4, py, madd(m8, pz, m12)));
+    float4 const ry = madd(m1, px, madd(m5, py, madd(m9, pz, m13)));
+    float4 const rz = madd(m2, px, madd(m6, py, madd(m10, pz, m14)));
+    store(ox + i, rx);
+    store(oy + i, ry);
+    store(oz + i, rz);
+  }
+
+  for (; i < n; i++)
+  {
+    float const px = x[i], py = y[i], pz = z[i];
+    ox[i] = m.m[0] * px + m.m[4] * py + m.m[8] * pz + m.m[12];
+    oy[i] = m.m[1] * px + m.m[5] * py + m.m[9] * pz + m.m[13];
+    oz[i] = m.m[2] * px + m.m[6] * py + m.m[10] * pz + m.m[14];
+  }
 }
 
 std::ostream &operator<<(std::ostream &fh, mat4 const &m)
@@ -102,6 +102,21 @@ inline vec4 operator*(mat4 const &m, vec3 const &v) {
 }
 
 mat4 operator*(mat4 const &a, mat4 const &b);
+
+// Batch operations on arrays. The math uses SIMD instructions (SSE or NEON)
+// when available.
+
+// out[i] = a[i] . b[i] for n matrices. out may be a or b.
+void mulMatrices(mat4 const *a, mat4 const *b, mat4 *out, size_t n);
+
+// out[i] = a . b[i] for n matrices. out may be b.
+void mulMatrices(mat4 const &a, mat4 const *b, mat4 *out, size_t n);
+
+// Transforms n points stored as separate x, y and z arrays (SoA) by m,
+// writing the results into ox, oy and oz. The outputs may be the inputs.
+void transformPoints(mat4 const &m, float const *x, float const *y,
+                     float const *z, float *ox, float *oy, float *oz,
+                     size_t n);
 } // namespace cst
 
 std::ostream &operator<<(std::ostream &fh, cst::mat4 const &m);
@@ -20,6 +20,9 @@
  SOFTWARE.
  */
 #include "mathutil.h"
+#include "core/parallel.h"
+
+#include <algorithm>
 #include <iostream>
 #include <unordered_map>
 
@@ -48,40 +51,133 @@ void cst::deduplicate(std::vector<vertex> &vertices,
   indices = out_indices;
 }
 
-void cst::calcTangents(std::vector<vertex> &vertices,
-                       std::vector<uint32_t> &indices) {
-
-  assert(indices.size() % 3 == 0);
-
-  for (uint32_t i = 0; i < indices.size(); i += 3) {
-    uint32_t i1 = indices[i];
-    uint32_t i2 = indices[i + 1];
-    uint32_t i3 = indices[i + 2];
+// Minimum number of triangles per task in calcTangents. Each task has its
+// own accumulation buffers so small meshes are processed on one thread.
+static constexpr size_t TANGENT_TRIS_PER_TASK = 16384;
 
-    vertex &v1 = vertices[i1];
-    vertex &v2 = vertices[i2];
-    vertex &v3 = vertices[i3];
-
-    vec3 const &pos1 = v1.pos;
-    vec3 const &pos2 = v2.pos;
-    vec3 const &pos3 = v3.pos;
+// Returns v projected to the plane defined by normal n.
+static vec3 projectToPlane(vec3 const &v, vec3 const &n) {
+  return v - n * n.dot(v);
+}
 
-    vec2 const &uv1 = v1.texcoord;
-    vec2 const &uv2 = v2.texcoord;
-    vec2 const &uv3 = v3.texcoord;
+// Returns a unit vector perpendicular to n.
+static vec3 anyPerpendicular(vec3 const &n) {
+  vec3 axis = fabsf(n.x()) < 0.9f ? vec3(1.0f, 0.0f, 0.0f)
+                                  : vec3(0.0f, 1.0f, 0.0f);
+  return projectToPlane(axis, n).normalize();
+}
 
-    vec3 const edge1 = pos2 - pos1;
-    vec3 const edge2 = pos3 - pos1;
+// Returns the angle between two edges of a triangle at their shared corner.
+static float cornerAngle(vec3 const &e1, vec3 const &e2) {
+  float l = e1.len() * e2.len();
+  if (l <= 0.0f)
+    return 0.0f;
+  return acosf(fmaxf(-1.0f, fminf(1.0f, e1.dot(e2) / l)));
+}
 
-    vec2 const duv1 = uv2 - uv1;
-    vec2 const duv2 = uv3 - uv1;
+void cst::calcTangents(std::vector<vertex> &vertices,
+                       std::vector<uint32_t> &indices) {
 
-    float f = 1.0f / (duv1.x() * duv2.y() - duv1.y() - duv2.x());
+  assert(indices.size() % 3 == 0);
 
-    v1.tangent = (edge1 * uv2.y() - edge2 * uv1.y()) * f;
-    v2.tangent = v1.tangent;
-    v3.tangent = v1.tangent;
-  }
+  size_t const numTris = indices.size() / 3;
+  size_t const numTasks = parallelTasks(numTris, TANGENT_TRIS_PER_TASK);
+
+  // Tangents and bitangents are accumulated per task and merged afterwards
+  // so that tasks never write to shared vertices. A task only covers the
+  // vertices its triangles use, so with the usual locality of the indices
+  // the buffers of all tasks take about as much as one for the whole mesh.
+  struct Accum {
+    uint32_t first = 0; // vertex of tan[0]
+    std::vector<vec3> tan, bitan;
+  };
+  std::vector<Accum> accums(numTasks);
+
+  parallelFor(numTris, TANGENT_TRIS_PER_TASK, [&](size_t begin, size_t end,
+                                                  size_t task) {
+    auto const [lo, hi] = std::minmax_element(indices.begin() + begin * 3,
+                                              indices.begin() + end * 3);
+    uint32_t const first = *lo;
+    Accum &accum = accums[task];
+    accum.first = first;
+    accum.tan.resize(*hi - first + 1);
+    accum.bitan.resize(*hi - first + 1);
+    std::vector<vec3> &tan = accum.tan;
+    std::vector<vec3> &bitan = accum.bitan;
+
+    for (size_t t = begin; t < end; t++) {
+      uint32_t const idx[3] = {indices[t * 3], indices[t * 3 + 1],
+                               indices[t * 3 + 2]};
+
+      vec3 const &pos1 = vertices[idx[0]].pos;
+      vec3 const &pos2 = vertices[idx[1]].pos;
+      vec3 const &pos3 = vertices[idx[2]].pos;
+
+      vec2 const duv1 = vertices[idx[1]].texcoord - vertices[idx[0]].texcoord;
+      vec2 const duv2 = vertices[idx[2]].texcoord - vertices[idx[0]].texcoord;
+
+      vec3 const edge1 = pos2 - pos1;
+      vec3 const edge2 = pos3 - pos1;
+
+      // Triangles with no texture space area do not define a tangent.
+      float const det = duv1.x() * duv2.y() - duv1.y() * duv2.x();
+      if (fabsf(det) < 1e-20f)
+        continue;
+
+      // Texture space orientation decides the handedness of the frame.
+      float const orient = det > 0.0f ? 1.0f : -1.0f;
+      vec3 const sdir = (edge1 * duv2.y() - edge2 * duv1.y()) * orient;
+      vec3 const tdir = (edge2 * duv1.x() - edge1 * duv2.x()) * orient;
+
+      vec3 const edges[3][2] = {{pos2 - pos1, pos3 - pos1},
+                                {pos3 - pos2, pos1 - pos2},
+                                {pos1 - pos3, pos2 - pos3}};
+
+      // Contributions are projected to the vertex tangent plane and weighted
+      // by the corner angle, as in MikkTSpace.
+      for (int c = 0; c < 3; c++) {
+        uint32_t const i = idx[c];
+        vec3 const &n = vertices[i].normal;
+        float const angle = cornerAngle(edges[c][0], edges[c][1]);
+
+        vec3 const s = projectToPlane(sdir, n);
+        vec3 const u = projectToPlane(tdir, n);
+        float const sl = s.len();
+        float const ul = u.len();
+
+        if (sl > 0.0f)
+          tan[i - first] = tan[i - first] + s * (angle / sl);
+        if (ul > 0.0f)
+          bitan[i - first] = bitan[i - first] + u * (angle / ul);
+      }
+    }
+  });
+
+  // Merge the task buffers and orthonormalize against the vertex normal.
+  parallelFor(vertices.size(), TANGENT_TRIS_PER_TASK, [&](size_t begin,
+                                                          size_t end, size_t) {
+    for (size_t i = begin; i < end; i++) {
+      vec3 t, b;
+      for (Accum const &accum : accums) {
+        size_t const j = i - accum.first;
+        if (i < accum.first || j >= accum.tan.size())
+          continue;
+        t = t + accum.tan[j];
+        b = b + accum.bitan[j];
+      }
+
+      vertex &v = vertices[i];
+      vec3 const &n = v.normal;
+
+      // Gram-Schmidt
+      t = projectToPlane(t, n);
+      float const tl = t.len();
+      t = tl > 1e-12f ? t / tl : anyPerpendicular(n);
+
+      float const w = n.cross(t).dot(b) < 0.0f ? -1.0f : 1.0f;
+      v.tangent = vec4(t, w);
+    }
+  });
 }
 
 void cst::flipNormals(std::vector<vertex> &vertices) {
@@ -28,6 +28,10 @@ namespace cst {
 
 // Depulicate vertices. Replaces arguments with the depulicated lists.
 void deduplicate(std::vector<vertex> &vertices, std::vector<uint32_t> &indices);
+
+// Calculates per-vertex tangents with the bitangent sign in w. Contributions
+// of the triangles are accumulated (in parallel for large meshes) and then
+// orthonormalized against the vertex normals.
 void calcTangents(std::vector<vertex> &vertices,
                   std::vector<uint32_t> &indices);
 void flipNormals(std::vector<vertex> &vertices);
@@ -0,0 +1,227 @@
+/*
+ Copyright (c) 2022 Tero Oinas
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+#ifndef _CST_LIB_MATH_SIMD_H
+#define _CST_LIB_MATH_SIMD_H
+
+// Four float SIMD vectors for the math kernels. The instruction set is
+// chosen at compile time: SSE (with FMA when enabled) on x86, NEON on ARM
+// and plain scalar code elsewhere or when CST_NO_SIMD is defined.
+
+#if !defined(CST_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64))
+#define CST_SIMD_SSE 1
+#include <immintrin.h>
+#elif !defined(CST_NO_SIMD) && (defined(__ARM_NEON) || defined(_M_ARM64))
+#define CST_SIMD_NEON 1
+#include <arm_neon.h>
+#else
+#define CST_SIMD_SCALAR 1
+#endif
+
+namespace cst::simd {
+
+#if defined(CST_SIMD_SSE)
+
+typedef __m128 float4;
+
+inline float4 load(float const *p) { return _mm_loadu_ps(p); }
+inline void store(float *p, float4 v) { _mm_storeu_ps(p, v); }
+inline float4 set(float x, float y, float z, float w) {
+  return _mm_setr_ps(x, y, z, w);
+}
+inline float4 splat(float v) { return _mm_set1_ps(v); }
+inline float4 add(float4 a, float4 b) { return _mm_add_ps(a, b); }
+inline float4 sub(float4 a, float4 b) { return _mm_sub_ps(a, b); }
+inline float4 mul(float4 a, float4 b) { return _mm_mul_ps(a, b); }
+inline float4 div(float4 a, float4 b) { return _mm_div_ps(a, b); }
+inline float4 min(float4 a, float4 b) { return _mm_min_ps(a, b); }
+inline float4 max(float4 a, float4 b) { return _mm_max_ps(a, b); }
+inline float4 abs(float4 a) {
+  return _mm_andnot_ps(_mm_set1_ps(-0.0f), a);
+}
+
+// a * b + c
+inline float4 madd(float4 a, float4 b, float4 c) {
+#ifdef __FMA__
+  return _mm_fmadd_ps(a, b, c);
+#else
+  return _mm_add_ps(_mm_mul_ps(a, b), c);
+#endif
+}
+
+inline float first(float4 v) { return _mm_cvtss_f32(v); }
+
+// Returns (a[x], a[y], b[z], b[w]).
+template <int x, int y, int z, int w> inline float4 shuffle(float4 a, float4 b) {
+  return _mm_shuffle_ps(a, b, x | (y << 2) | (z << 4) | (w << 6));
+}
+
+// Returns a bit mask of the lanes where a < b.
+inline int lessMask(float4 a, float4 b) {
+  return _mm_movemask_ps(_mm_cmplt_ps(a, b));
+}
+
+inline void transpose(float4 &r0, float4 &r1, float4 &r2, float4 &r3) {
+  _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+}
+
+#elif defined(CST_SIMD_NEON)
+
+typedef float32x4_t float4;
+
+inline float4 load(float const *p) { return vld1q_f32(p); }
+inline void store(float *p, float4 v) { vst1q_f32(p, v); }
+inline float4 set(float x, float y, float z, float w) {
+  float const v[4] = {x, y, z, w};
+  return vld1q_f32(v);
+}
+inline float4 splat(float v) { return vdupq_n_f32(v); }
+inline float4 add(float4 a, float4 b) { return vaddq_f32(a, b); }
+inline float4 sub(float4 a, float4 b) { return vsubq_f32(a, b); }
+inline float4 mul(float4 a, float4 b) { return vmulq_f32(a, b); }
+inline float4 div(float4 a, float4 b) {
+#if defined(__aarch64__) || defined(_M_ARM64)
+  return vdivq_f32(a, b);
+#else
+  // Two Newton-Raphson steps refine the reciprocal estimate.
+  float4 r = vrecpeq_f32(b);
+  r = vmulq_f32(vrecpsq_f32(b, r), r);
+  r = vmulq_f32(vrecpsq_f32(b, r), r);
+  return vmulq_f32(a, r);
+#endif
+}
+inline float4 min(float4 a, float4 b) { return vminq_f32(a, b); }
+inline float4 max(float4 a, float4 b) { return vmaxq_f32(a, b); }
+inline float4 abs(float4 a) { return vabsq_f32(a); }
+
+// a * b + c
+inline float4 madd(float4 a, float4 b, float4 c) {
+  return vmlaq_f32(c, a, b);
+}
+
+inline float first(float4 v) { return vgetq_lane_f32(v, 0); }
+
+// Returns (a[x], a[y], b[z], b[w]).
+template <int x, int y, int z, int w> inline float4 shuffle(float4 a, float4 b) {
+  float4 r = vmovq_n_f32(vgetq_lane_f32(a, x));
+  r = vsetq_lane_f32(vgetq_lane_f32(a, y), r, 1);
+  r = vsetq_lane_f32(vgetq_lane_f32(b, z), r, 2);
+  return vsetq_lane_f32(vgetq_lane_f32(b, w), r, 3);
+}
+
+// Returns a bit mask of the lanes where a < b.
+inline int lessMask(float4 a, float4 b) {
+  uint32x4_t c = vcltq_f32(a, b);
+  return (vgetq_lane_u32(c, 0) & 1) | (vgetq_lane_u32(c, 1) & 2) |
+         (vgetq_lane_u32(c, 2) & 4) | (vgetq_lane_u32(c, 3) & 8);
+}
+
+inline void transpose(float4 &r0, float4 &r1, float4 &r2, float4 &r3) {
+  float32x4x2_t a = vtrnq_f32(r0, r1);
+  float32x4x2_t b = vtrnq_f32(r2, r3);
+  r0 = vcombine_f32(vget_low_f32(a.val[0]), vget_low_f32(b.val[0]));
+  r1 = vcombine_f32(vget_low_f32(a.val[1]), vget_low_f32(b.val[1]));
+  r2 = vcombine_f32(vget_high_f32(a.val[0]), vget_high_f32(b.val[0]));
+  r3 = vcombine_f32(vget_high_f32(a.val[1]), vget_high_f32(b.val[1]));
+}
+
+#else
+
+struct float4 {
+  float v[4];
+};
+
+inline float4 load(float const *p) { return {{p[0], p[1], p[2], p[3]}}; }
+inline void store(float *p, float4 v) {
+  for (int i = 0; i < 4; i++)
+    p[i] = v.v[i];
+}
+inline float4 set(float x, float y, float z, float w) {
+  return {{x, y, z, w}};
+}
+inline float4 splat(float v) { return {{v, v, v, v}}; }
+
+#define CST_SIMD_SCALAR_OP(name, expr)                                         \
+  inline float4 name(float4 a, float4 b) {                                     \
+    float4 r;                                                                  \
+    for (int i = 0; i < 4; i++)                                                \
+      r.v[i] = expr;                                                           \
+    return r;                                                                  \
+  }
+
+CST_SIMD_SCALAR_OP(add, a.v[i] + b.v[i])
+CST_SIMD_SCALAR_OP(sub, a.v[i] - b.v[i])
+CST_SIMD_SCALAR_OP(mul, a.v[i] * b.v[i])
+CST_SIMD_SCALAR_OP(div, a.v[i] / b.v[i])
+CST_SIMD_SCALAR_OP(min, a.v[i] < b.v[i] ? a.v[i] : b.v[i])
+CST_SIMD_SCALAR_OP(max, a.v[i] > b.v[i] ? a.v[i] : b.v[i])
+
+#undef CST_SIMD_SCALAR_OP
+
+inline float4 abs(float4 a) {
+  return {{a.v[0] < 0.0f ? -a.v[0] : a.v[0], a.v[1] < 0.0f ? -a.v[1] : a.v[1],
+           a.v[2] < 0.0f ? -a.v[2] : a.v[2], a.v[3] < 0.0f ? -a.v[3] : a.v[3]}};
+}
+
+// a * b + c
+inline float4 madd(float4 a, float4 b, float4 c) { return add(mul(a, b), c); }
+
+inline float first(float4 v) { return v.v[0]; }
+
+// Returns (a[x], a[y], b[z], b[w]).
+template <int x, int y, int z, int w> inline float4 shuffle(float4 a, float4 b) {
+  return {{a.v[x], a.v[y], b.v[z], b.v[w]}};
+}
+
+// Returns a bit mask of the lanes where a < b.
+inline int lessMask(float4 a, float4 b) {
+  int mask = 0;
+  for (int i = 0; i < 4; i++)
+    mask |= (a.v[i] < b.v[i]) << i;
+  return mask;
+}
+
+inline void transpose(float4 &r0, float4 &r1, float4 &r2, float4 &r3) {
+  float4 t0 = {{r0.v[0], r1.v[0], r2.v[0], r3.v[0]}};
+  float4 t1 = {{r0.v[1], r1.v[1], r2.v[1], r3.v[1]}};
+  float4 t2 = {{r0.v[2], r1.v[2], r2.v[2], r3.v[2]}};
+  float4 t3 = {{r0.v[3], r1.v[3], r2.v[3], r3.v[3]}};
+  r0 = t0;
+  r1 = t1;
+  r2 = t2;
+  r3 = t3;
+}
+
+#endif
+
+// Returns (a[x], a[y], a[z], a[w]).
+template <int x, int y, int z, int w> inline float4 swizzle(float4 a) {
+  return shuffle<x, y, z, w>(a, a);
+}
+
+// Returns a[i] in all lanes.
+template <int i> inline float4 splat(float4 a) {
+  return shuffle<i, i, i, i>(a, a);
+}
+
+} // namespace cst::simd
+
+#endif // _CST_LIB_MATH_SIMD_H
@@ -101,6 +101,11 @@ struct vec3 {
     return d[0] * b.d[0] + d[1] * b.d[1] + d[2] * b.d[2];
   }
 
+  vec3 cross(vec3 const &b) const {
+    return vec3(d[1] * b.d[2] - d[2] * b.d[1], d[2] * b.d[0] - d[0] * b.d[2],
+                d[0] * b.d[1] - d[1] * b.d[0]);
+  }
+
   // Clip all values of this vector to be between min and max inclusive.
   vec3 clip(float min = 0.0f, float max = 1.0f) {
     return vec3(fmax(fmin(d[0], max), min), fmax(fmin(d[1], max), min),
@@ -131,4 +131,14 @@ std::ostream &operator<<(std::ostream &fh, cst::vec4 const &v);
 
 } // namespace cst
 
+template <> struct std::hash<cst::vec4> {
+  size_t operator()(cst::vec4 const &v) const noexcept {
+    size_t h1 = std::hash<float>{}(v.d[0]);
+    size_t h2 = std::hash<float>{}(v.d[1]);
+    size_t h3 = std::hash<float>{}(v.d[2]);
+    size_t h4 = std::hash<float>{}(v.d[3]);
+    return h1 ^ (h2 << 1) ^ (h3 << 2) ^ (h4 << 3);
+  }
+};
+
 #endif // _CST_LIB_MATH_VEC4_H
\ No newline at end of file
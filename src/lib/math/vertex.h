@@ -24,17 +24,18 @@
 
 #include "vec2.h"
 #include "vec3.h"
+#include "vec4.h"
 
 namespace cst {
 
 /**
- * vertex
+ * vertex. The tangent has the bitangent sign (handedness) in w.
  */
 struct vertex {
   alignas(4) vec3 pos;
   alignas(4) vec3 normal;
   alignas(4) vec2 texcoord;
-  alignas(4) vec3 tangent;
+  alignas(4) vec4 tangent;
 
   bool operator==(const vertex &b) const {
     return pos == b.pos && texcoord == b.texcoord && normal == b.normal &&
@@ -51,7 +52,7 @@ template <> struct std::hash<cst::vertex> {
     size_t h1 = hash<cst::vec3>{}(v.pos);
     size_t h2 = hash<cst::vec2>{}(v.texcoord);
     size_t h3 = hash<cst::vec3>{}(v.normal);
-    size_t h4 = hash<cst::vec3>{}(v.tangent);
+    size_t h4 = hash<cst::vec4>{}(v.tangent);
     return h1 ^ (h2 << 1) ^ (h3 << 2) ^ (h4 << 3);
   }
 };
@@ -0,0 +1,304 @@
+/*
+ Copyright (c) 2022 Tero Oinas
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+#include "bvh.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <functional>
+#include <numeric>
+
+using namespace cst;
+
+// Ranges of at most this many items are always leaves.
+static const uint32_t MIN_LEAF_ITEMS = 4;
+
+// Ranges of more items are split even if SAH prefers a leaf.
+static const uint32_t MAX_LEAF_ITEMS = 16;
+
+// Number of bins along the split axis for evaluating SAH.
+static const int NUM_BINS = 16;
+
+static AABB emptyBox() { return AABB(vec3(FLT_MAX), vec3(-FLT_MAX)); }
+
+// Half of the surface area, which is enough for comparing SAH costs.
+static float halfArea(AABB const &b) {
+  vec3 const s = b.p2 - b.p1;
+  return s.x() * s.y() + s.y() * s.z() + s.z() * s.x();
+}
+
+void BVH::build(std::vector<node_ptr> const &nodes) {
+  std::vector<uint32_t> indices(nodes.size());
+  std::iota(indices.begin(), indices.end(), 0);
+  build(nodes, indices);
+}
+
+void BVH::build(std::vector<node_ptr> const &nodes,
+                std::vector<uint32_t> const &indices) {
+  tree.clear();
+  parents.clear();
+  items.clear();
+  leaves.clear();
+  itemOf.clear();
+  for (auto &v : itemBoxes)
+    v.clear();
+  movedPos = TransformStore::NO_POSITION;
+
+  if (indices.empty())
+    return;
+
+  uint32_t const n = indices.size();
+  std::vector<AABB> boxes(n);
+  std::vector<vec3> centroids(n);
+  for (uint32_t i = 0; i < n; i++) {
+    boxes[i] = nodes[indices[i]]->getWorldAABB();
+    centroids[i] = boxes[i].center();
+  }
+
+  std::vector<uint32_t> perm(n);
+  std::iota(perm.begin(), perm.end(), 0);
+
+  tree.reserve(2 * n / MIN_LEAF_ITEMS + 1);
+  parents.reserve(tree.capacity());
+  leaves.resize(n);
+  buildRange(0, 0, n, perm, boxes, centroids);
+
+  for (auto &v : itemBoxes)
+    v.resize(n);
+  itemOf.reserve(n);
+  for (uint32_t i = 0; i < n; i++) {
+    node_ptr const &node = nodes[indices[perm[i]]];
+    items.push_back({node, indices[perm[i]], node->getTransformVersion()});
+    itemOf[node.get()] = i;
+    setItemBox(i, boxes[perm[i]]);
+  }
+  refitting.assign(tree.size(), 0);
+}
+
+uint32_t BVH::buildRange(uint32_t parent, uint32_t begin, uint32_t end,
+                         std::vector<uint32_t> &perm,
+                         std::vector<AABB> const &boxes,
+                         std::vector<vec3> const &centroids) {
+  uint32_t const index = tree.size();
+  tree.push_back({});
+  parents.push_back(parent);
+
+  AABB box = emptyBox(), cbox = emptyBox();
+  for (uint32_t i = begin; i < end; i++) {
+    box.extend(boxes[perm[i]]);
+    cbox.extend(centroids[perm[i]]);
+  }
+
+  uint32_t const count = end - begin;
+  tree[index] = {box, begin, end, 0};
+  std::fill(leaves.begin() + begin, leaves.begin() + end, index);
+  if (count <= MIN_LEAF_ITEMS)
+    return index;
+
+  // Split along the longest axis of the centroids.
+  vec3 const size = cbox.p2 - cbox.p1;
+  int axis = 0;
+  if (size.d[1] > size.d[axis])
+    axis = 1;
+  if (size.d[2] > size.d[axis])
+    axis = 2;
+
+  float const lo = cbox.p1.d[axis];
+  float const extent = size.d[axis];
+  uint32_t *const first = perm.data() + begin;
+  uint32_t *mid = first + count / 2;
+
+  if (extent > 0.0f) {
+    auto binOf = [&](uint32_t item) {
+      int bin = int((centroids[item].d[axis] - lo) / extent * NUM_BINS);
+      return std::min(bin, NUM_BINS - 1);
+    };
+
+    AABB binBoxes[NUM_BINS];
+    uint32_t binCounts[NUM_BINS] = {};
+    for (auto &b : binBoxes)
+      b = emptyBox();
+    for (uint32_t i = begin; i < end; i++) {
+      int bin = binOf(perm[i]);
+      binBoxes[bin].extend(boxes[perm[i]]);
+      binCounts[bin]++;
+    }
+
+    // Cost of the items right of each split, swept from the right.
+    float rightCost[NUM_BINS];
+    AABB right = emptyBox();
+    uint32_t rightCount = 0;
+    for (int i = NUM_BINS - 1; i > 0; i--) {
+      right.extend(binBoxes[i]);
+      rightCount += binCounts[i];
+      rightCost[i] = rightCount > 0 ? halfArea(right) * rightCount : 0.0f;
+    }
+
+    float bestCost = FLT_MAX;
+    int bestSplit = 0;
+    AABB left = emptyBox();
+    uint32_t leftCount = 0;
+    for (int i = 0; i < NUM_BINS - 1; i++) {
+      left.extend(binBoxes[i]);
+      leftCount += binCounts[i];
+      if (leftCount == 0 || leftCount == count)
+        continue;
+
+      float cost = halfArea(left) * leftCount + rightCost[i + 1];
+      if (cost < bestCost) {
+        bestCost = cost;
+        bestSplit = i;
+      }
+    }
+
+    if (count <= MAX_LEAF_ITEMS && bestCost >= halfArea(box) * count)
+      return index;
+
+    if (bestCost < FLT_MAX)
+      mid = std::partition(first, first + count, [&](uint32_t item) {
+        return binOf(item) <= bestSplit;
+      });
+  }
+
+  uint32_t const split = mid - perm.data();
+  buildRange(index, begin, split, perm, boxes, centroids);
+  tree[index].second = buildRange(index, split, end, perm, boxes, centroids);
+  return index;
+}
+
+void BVH::setItemBox(size_t i, AABB const &box) {
+  vec3 const c = box.center();
+  vec3 const e = box.extent();
+  for (int j = 0; j < 3; j++) {
+    itemBoxes[j][i] = c.d[j];
+    itemBoxes[3 + j][i] = e.d[j];
+  }
+}
+
+void BVH::fitNode(uint32_t i) {
+  TreeNode &t = tree[i];
+  if (t.second == 0) {
+    t.box = emptyBox();
+    for (uint32_t j = t.begin; j < t.end; j++) {
+      vec3 const c(itemBoxes[0][j], itemBoxes[1][j], itemBoxes[2][j]);
+      vec3 const e(itemBoxes[3][j], itemBoxes[4][j], itemBoxes[5][j]);
+      t.box.extend(AABB(c - e, c + e));
+    }
+  } else {
+    t.box = tree[i + 1].box;
+    t.box.extend(tree[t.second].box);
+  }
+}
+
+void BVH::refitAll() {
+  bool changed = false;
+  for (size_t i = 0; i < items.size(); i++) {
+    Item &item = items[i];
+    uint32_t version = item.node->getTransformVersion();
+    if (version != item.transformVersion) {
+      item.transformVersion = version;
+      setItemBox(i, item.node->getWorldAABB());
+      changed = true;
+    }
+  }
+
+  if (!changed)
+    return;
+
+  // Children come after their parents, so the boxes are updated bottom up
+  // by going through the tree backwards.
+  for (size_t i = tree.size(); i-- > 0;)
+    fitNode(i);
+}
+
+void BVH::refit(TransformStore const &store) {
+  if (tree.empty())
+    return;
+
+  refitNodes.clear();
+  bool const logged = store.forMoved(movedPos, [this](Node const *node) {
+    auto it = itemOf.find(node);
+    if (it == itemOf.end())
+      return;
+
+    Item &item = items[it->second];
+    uint32_t version = item.node->getTransformVersion();
+    if (version == item.transformVersion)
+      return;
+    item.transformVersion = version;
+    setItemBox(it->second, item.node->getWorldAABB());
+
+    // The leaf of the item and its ancestors, up to one already added.
+    for (uint32_t t = leaves[it->second]; !refitting[t]; t = parents[t]) {
+      refitting[t] = 1;
+      refitNodes.push_back(t);
+      if (t == 0)
+        break;
+    }
+  });
+
+  if (!logged) {
+    refitAll();
+    return;
+  }
+
+  // Children have larger indices than their parents.
+  std::sort(refitNodes.begin(), refitNodes.end(), std::greater<uint32_t>());
+  for (uint32_t t : refitNodes) {
+    fitNode(t);
+    refitting[t] = 0;
+  }
+}
+
+void BVH::cull(Frustum const &frustum, std::vector<uint32_t> &out) const {
+  if (tree.empty())
+    return;
+
+  std::vector<uint32_t> stack = {0};
+  uint8_t visible[MAX_LEAF_ITEMS];
+
+  while (!stack.empty()) {
+    uint32_t const i = stack.back();
+    stack.pop_back();
+
+    TreeNode const &t = tree[i];
+    if (!frustum.isVisible(t.box))
+      continue;
+
+    // Subtrees entirely inside need no more tests.
+    if (frustum.contains(t.box)) {
+      for (uint32_t j = t.begin; j < t.end; j++)
+        out.push_back(items[j].index);
+    } else if (t.second == 0) {
+      frustum.testBoxes(&itemBoxes[0][t.begin], &itemBoxes[1][t.begin],
+                        &itemBoxes[2][t.begin], &itemBoxes[3][t.begin],
+                        &itemBoxes[4][t.begin], &itemBoxes[5][t.begin],
+                        t.end - t.begin, visible);
+      for (uint32_t j = t.begin; j < t.end; j++) {
+        if (visible[j - t.begin])
+          out.push_back(items[j].index);
+      }
+    } else {
+      stack.push_back(t.second);
+      stack.push_back(i + 1);
+    }
+  }
+}
@@ -0,0 +1,112 @@
+/*
+ Copyright (c) 2022 Tero Oinas
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+#ifndef _CST_LIB_SG_BVH_H
+#define _CST_LIB_SG_BVH_H
+
+#include "math/frustum.h"
+#include "node.h"
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace cst {
+
+/**
+ * BVH is a bounding volume hierarchy over the world space boxes of nodes,
+ * used for culling. It is built with the surface area heuristic and refitted
+ * when the nodes move. Culling descends the tree with a frustum and skips
+ * the subtrees outside of it.
+ */
+class BVH {
+public:
+  // Builds the hierarchy over the given nodes.
+  void build(std::vector<node_ptr> const &nodes);
+
+  // Builds the hierarchy over the nodes at the given indices of nodes.
+  void build(std::vector<node_ptr> const &nodes,
+             std::vector<uint32_t> const &indices);
+
+  // Updates the boxes of the nodes that have moved since the last refit,
+  // as logged by the store of their transforms, and the boxes of the tree
+  // above them. Every node is checked if the log does not reach back far
+  // enough. The tree structure is kept, so it fits worse the farther the
+  // nodes move from where they were when built. The caller must hold the
+  // mutex of the store shared.
+  void refit(TransformStore const &store);
+
+  // Appends the indices (in the vector given to build) of the nodes that
+  // are at least partly inside the frustum to out.
+  void cull(Frustum const &frustum, std::vector<uint32_t> &out) const;
+
+  size_t size() const { return items.size(); }
+
+private:
+  // A node of the tree. Inner nodes have their first child next to them
+  // and the second one at index second. The items of a subtree are
+  // [begin, end) in tree order.
+  struct TreeNode {
+    AABB box;
+    uint32_t begin, end;
+    uint32_t second; // 0 for leaves
+  };
+
+  struct Item {
+    node_ptr node;
+    uint32_t index; // in the vector given to build
+    uint32_t transformVersion;
+  };
+
+  // Builds the subtree of the items perm[begin, end) below the tree node
+  // parent and returns its index.
+  uint32_t buildRange(uint32_t parent, uint32_t begin, uint32_t end,
+                      std::vector<uint32_t> &perm,
+                      std::vector<AABB> const &boxes,
+                      std::vector<vec3> const &centroids);
+
+  // Sets the box of item i in tree order.
+  void setItemBox(size_t i, AABB const &box);
+
+  // Recalculates the box of tree node i from its items or children.
+  void fitNode(uint32_t i);
+
+  // Checks every item and refits the whole tree.
+  void refitAll();
+
+  std::vector<TreeNode> tree;
+  std::vector<uint32_t> parents; // of the tree nodes, 0 for the root
+  std::vector<Item> items;       // in tree order
+  std::vector<uint32_t> leaves;  // tree node of each item
+
+  std::unordered_map<Node const *, uint32_t> itemOf;
+  uint64_t movedPos = TransformStore::NO_POSITION;
+  std::vector<uint32_t> refitNodes;
+  std::vector<uint8_t> refitting; // tree nodes in refitNodes
+
+  // Item boxes in tree order as centers and extents (SoA), so leaves can
+  // be tested with Frustum::testBoxes.
+  std::vector<float> itemBoxes[6];
+};
+
+} // namespace cst
+
+#endif // _CST_LIB_SG_BVH_H
@@ -30,8 +30,7 @@ mat4 Camera::perspectiveFor(float fov, float near, float far) {
                        far);
 }
 
-void Camera::updateGlobalTransform(mat4 const &p) {
-  Node::updateGlobalTransform(p);
+void Camera::globalTransformChanged() {
   vec3 const &pos = getGlobalPosition();
   mat4 const &rot = getGlobalRotation();
   view = rot.transpose() * mat4::translate(-pos);
@@ -45,10 +45,17 @@ public:
   mat4 perspectiveFor(float fov, float near, float far);
 
   void setPerspective(float fov, float near, float far) {
-    proj = perspectiveFor(fov, near, far);
+    mat4 const p = perspectiveFor(fov, near, far);
+    if (p != proj) {
+      proj = p;
+      markTransformDirty();
+    }
   }
 
-  void updateGlobalTransform(mat4 const &p) override;
+protected:
+  void globalTransformChanged() override;
+  bool hasTransformHook() const override { return true; }
+
 private:
   mat4 proj;
   mat4 view;
@@ -0,0 +1,143 @@
+/*
+ Copyright (c) 2022 Tero Oinas
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+#include "camera_path.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+using namespace cst;
+
+// Number of keys of an orbit.
+static const int ORBIT_KEYS = 16;
+
+static float lerp(float a, float b, float t) { return a + (b - a) * t; }
+
+// Catmull-Rom spline segment from p1 to p2.
+static vec3 catmullRom(vec3 const &p0, vec3 const &p1, vec3 const &p2,
+                       vec3 const &p3, float t) {
+  float const t2 = t * t;
+  float const t3 = t2 * t;
+  return (p1 * 2.0f + (p2 - p0) * t +
+          (p0 * 2.0f - p1 * 5.0f + p2 * 4.0f - p3) * t2 +
+          (p1 * 3.0f - p0 - p2 * 3.0f + p3) * t3) *
+         0.5f;
+}
+
+CameraPath CameraPath::orbit(AABB const &box, float duration) {
+  vec3 const center = box.center();
+  vec3 const ext = box.extent();
+  float const radius = std::max(ext.x(), ext.z()) * 1.5f + 1.0f;
+  float const height = center.y() + ext.y() * 0.5f;
+
+  CameraPath path;
+  for (int i = 0; i <= ORBIT_KEYS; i++) {
+    float const a = 2.0f * float(M_PI) * i / ORBIT_KEYS;
+    vec3 const pos(center.x() + radius * sinf(a), height,
+                   center.z() + radius * cosf(a));
+
+    // The camera looks towards -z when yaw and pitch are zero.
+    vec3 const dir = center - pos;
+    float const yaw = atan2f(-dir.x(), -dir.z());
+    float const pitch =
+        atan2f(dir.y(), sqrtf(dir.x() * dir.x() + dir.z() * dir.z()));
+
+    // Keep the yaw continuous so that it is interpolated the short way.
+    float const unwrapped = (i == 0) ? yaw : path.keys[0].yaw + a;
+    path.addKey({duration * i / ORBIT_KEYS, pos, unwrapped, pitch});
+  }
+  return path;
+}
+
+CameraPath CameraPath::load(std::string const &filename) {
+  std::ifstream in(filename);
+  if (!in)
+    throw std::runtime_error("failed to open camera path " + filename);
+
+  CameraPath path;
+  std::string line;
+  while (std::getline(in, line)) {
+    if (line.empty() || line[0] == '#')
+      continue;
+
+    std::istringstream ls(line);
+    Key key;
+    if (!(ls >> key.time >> key.position.d[0] >> key.position.d[1] >>
+          key.position.d[2] >> key.yaw >> key.pitch))
+      throw std::runtime_error("invalid camera path key in " + filename +
+                               ": " + line);
+    if (!path.keys.empty() && key.time < path.keys.back().time)
+      throw std::runtime_error("camera path keys out of order in " +
+                               filename);
+    path.addKey(key);
+  }
+
+  if (path.empty())
+    throw std::runtime_error("empty camera path " + filename);
+  return path;
+}
+
+void CameraPath::save(std::string const &filename) const {
+  std::ofstream out(filename);
+  if (!out)
+    throw std::runtime_error("failed to create camera path " + filename);
+
+  out << "# time x y z yaw pitch\n";
+  for (Key const &k : keys)
+    out << k.time << " " << k.position.x() << " " << k.position.y() << " "
+        << k.position.z() << " " << k.yaw << " " << k.pitch << "\n";
+
+  if (!out)
+    throw std::runtime_error("failed to write camera path " + filename);
+}
+
+void CameraPath::addKey(Key const &key) { keys.push_back(key); }
+
+CameraPath::Key CameraPath::sample(float time) const {
+  if (keys.empty())
+    return Key{time, vec3(), 0.0f, 0.0f};
+
+  float const duration = getDuration();
+  if (keys.size() == 1 || duration <= 0.0f)
+    return keys[0];
+
+  float const t = keys[0].time + fmodf(std::max(time, 0.0f), duration);
+
+  // The segment [i, i + 1] that contains t.
+  auto it = std::upper_bound(keys.begin() + 1, keys.end(), t,
+                             [](float t, Key const &k) { return t < k.time; });
+  size_t const i = std::min(size_t(it - keys.begin()), keys.size() - 1) - 1;
+
+  Key const &k1 = keys[i];
+  Key const &k2 = keys[i + 1];
+  Key const &k0 = keys[(i > 0) ? i - 1 : i];
+  Key const &k3 = keys[std::min(i + 2, keys.size() - 1)];
+
+  float const span = k2.time - k1.time;
+  float const f = (span > 0.0f) ? (t - k1.time) / span : 0.0f;
+
+  return Key{time,
+             catmullRom(k0.position, k1.position, k2.position, k3.position, f),
+             lerp(k1.yaw, k2.yaw, f), lerp(k1.pitch, k2.pitch, f)};
+}
@@ -0,0 +1,77 @@
+/*
+ Copyright (c) 2022 Tero Oinas
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+#ifndef _CST_LIB_SG_CAMERA_PATH_H
+#define _CST_LIB_SG_CAMERA_PATH_H
+
+#include "math/aabb.h"
+#include "math/vec3.h"
+
+#include <string>
+#include <vector>
+
+namespace cst {
+
+/**
+ * CameraPath is a timed sequence of camera positions and orientations.
+ * Positions are interpolated along a Catmull-Rom spline through the keys,
+ * yaw and pitch linearly. Paths can be recorded while flying and saved
+ * into a text file with one "time x y z yaw pitch" key per line.
+ */
+class CameraPath {
+public:
+  struct Key {
+    float time; // seconds
+    vec3 position;
+    float yaw, pitch;
+  };
+
+  // Returns a closed path that circles the box horizontally, looking at
+  // its center, once in the given duration.
+  static CameraPath orbit(AABB const &box, float duration);
+
+  // Loads a path from a file. Throws std::runtime_error on failure.
+  static CameraPath load(std::string const &filename);
+
+  // Saves the path into a file. Throws std::runtime_error on failure.
+  void save(std::string const &filename) const;
+
+  // Appends a key. Keys must be added in time order.
+  void addKey(Key const &key);
+
+  bool empty() const { return keys.empty(); }
+
+  // Returns the time from the first key to the last one.
+  float getDuration() const {
+    return keys.empty() ? 0.0f : keys.back().time - keys.front().time;
+  }
+
+  // Returns the camera at the given time from the first key. Times past the
+  // end wrap around.
+  Key sample(float time) const;
+
+private:
+  std::vector<Key> keys;
+};
+
+} // namespace cst
+
+#endif // _CST_LIB_SG_CAMERA_PATH_H
@@ -21,67 +21,130 @@
  SOFTWARE.
  */
 #include "cubetexture.h"
-#include <cstring>
-#include <iostream>
+#include "core/fileutil.h"
+#include "core/parallel.h"
+#include "image/decoder.h"
+#include "ktx2.h"
 
-using namespace cst;
+#include <cassert>
 
-static stbi_uc *load_image(std::string const &filename, int &width, int &height,
-                           int &depth, int req_comp) {
-  stbi_uc *pix = stbi_load(filename.c_str(), &width, &height, &depth, 4);
-  if (pix == nullptr)
-    throw std::runtime_error(std::string("failed to load image: ") + filename);
-  return pix;
-}
+using namespace cst;
 
 CubeTexture::CubeTexture(TextureType type,
                          std::string const &front, std::string const &back,
                          std::string const &top, std::string const &bottom,
                          std::string const &right, std::string const &left,
-												 std::string const &name)
-    : Texture(name, type), front(front), back(back), top(top), bottom(bottom),
-      right(right), left(left) {}
+                         std::string const &name)
+    : Texture(name, type), files{front, back, top, bottom, right, left} {}
+
+CubeTexture::CubeTexture(TextureType type, std::string const &filename,
+                         std::string const &name)
+    : Texture(name, type), filename(filename) {}
+
+CubeTexture::~CubeTexture() {}
+
+uint8_t *CubeTexture::getPixels() const {
+  assert(!data.empty());
+  return const_cast<uint8_t *>(data.data());
+}
 
-CubeTexture::~CubeTexture() { delete[] pix; }
+size_t CubeTexture::getMemorySize() const {
+  size_t size = data.size();
+  for (Face const &face : faces)
+    size += face.encoded.size();
+  return size;
+}
 
 void CubeTexture::load() {
-  stbi_uc *front_pix = load_image(front, width, height, depth, 4);
-	depth = 4;
-
-  int w, h, d;
-  stbi_uc *back_pix = load_image(back, w, h, d, 4);
-  if (width != w || height != h)
-    throw std::runtime_error("CubeTexture: all faces must have the same size");
-
-  stbi_uc *top_pix = load_image(top, w, h, d, 4);
-  if (width != w || height != h)
-    throw std::runtime_error("CubeTexture: all faces must have the same size");
-
-  stbi_uc *bottom_pix = load_image(bottom, w, h, d, 4);
-  if (width != w || height != h)
-    throw std::runtime_error("CubeTexture: all faces must have the same size");
-
-  stbi_uc *right_pix = load_image(right, w, h, d, 4);
-  if (width != w || height != h)
-    throw std::runtime_error("CubeTexture: all faces must have the same size");
-
-  stbi_uc *left_pix = load_image(left, w, h, d, 4);
-  if (width != w || height != h)
-    throw std::runtime_error("CubeTexture: all faces must have the same size");
-
-  size_t layer_size = width * height * 4;
-	pix = new uint8_t[layer_size * 6];
-  memcpy(pix, front_pix, layer_size);
-  memcpy(pix + layer_size, back_pix, layer_size);
-  memcpy(pix + layer_size * 2, top_pix, layer_size);
-  memcpy(pix + layer_size * 3, bottom_pix, layer_size);
-  memcpy(pix + layer_size * 4, right_pix, layer_size);
-  memcpy(pix + layer_size * 5, left_pix, layer_size);
-
-  stbi_image_free(left_pix);
-  stbi_image_free(right_pix);
-  stbi_image_free(bottom_pix);
-  stbi_image_free(top_pix);
-  stbi_image_free(back_pix);
-  stbi_image_free(front_pix);
+  if (!data.empty())
+    return;
+
+  if (!filename.empty()) {
+    KTX2Image img = loadKTX2(filename, getType(), getSupportedFormats());
+    if (img.layers != 6)
+      throw std::runtime_error("not a cube map: " + filename);
+
+    format = img.format;
+    width = img.width;
+    height = img.height;
+    levels = std::move(img.levels);
+    data = std::move(img.data);
+    return;
+  }
+
+  std::vector<uint8_t> pixels(prepareDecode());
+  decodeInto(pixels.data());
+  data = std::move(pixels);
+}
+
+void CubeTexture::unload() {
+  std::vector<uint8_t>().swap(data);
+  levels.clear();
+  format = PIXEL_FORMAT_RGBA8;
+  for (Face &face : faces)
+    std::vector<uint8_t>().swap(face.encoded);
+}
+
+size_t CubeTexture::prepareDecode() {
+  if (!data.empty() || !filename.empty())
+    return 0;
+
+  // The files are read and their headers parsed in parallel.
+  std::array<ImageInfo, 6> infos;
+  try {
+    parallelFor(6, 1, [this, &infos](size_t begin, size_t end, size_t) {
+      for (size_t i = begin; i < end; i++) {
+        Face &face = faces[i];
+        face.encoded = loadFile(files[i].c_str());
+        face.decoder =
+            &findImageDecoder(face.encoded.data(), face.encoded.size());
+        try {
+          infos[i] = face.decoder->readInfo(face.encoded.data(),
+                                            face.encoded.size());
+        } catch (std::runtime_error const &e) {
+          throw std::runtime_error(std::string(e.what()) + ": " + files[i]);
+        }
+      }
+    });
+  } catch (...) {
+    unload();
+    throw;
+  }
+
+  for (ImageInfo const &info : infos) {
+    if (info.width != infos[0].width || info.height != infos[0].height) {
+      unload();
+      throw std::runtime_error(
+          "CubeTexture: all faces must have the same size");
+    }
+  }
+
+  width = infos[0].width;
+  height = infos[0].height;
+  depth = 4;
+  return size_t(width) * height * 4 * 6;
+}
+
+void CubeTexture::decodeInto(uint8_t *dst) {
+  size_t layerSize = size_t(width) * height * 4;
+
+  // Each face is decoded straight into its layer.
+  try {
+    parallelFor(6, 1, [this, dst, layerSize](size_t begin, size_t end, size_t) {
+      for (size_t i = begin; i < end; i++) {
+        Face &face = faces[i];
+        assert(!face.encoded.empty() && face.decoder != nullptr);
+        try {
+          face.decoder->decode(face.encoded.data(), face.encoded.size(),
+                               {width, height}, dst + layerSize * i);
+        } catch (std::runtime_error const &e) {
+          throw std::runtime_error(std::string(e.what()) + ": " + files[i]);
+        }
+        std::vector<uint8_t>().swap(face.encoded);
+      }
+    });
+  } catch (...) {
+    unload();
+    throw;
+  }
 }
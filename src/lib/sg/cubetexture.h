@@ -24,11 +24,13 @@
 
 #include "texture.h"
 
+#include <array>
+
 namespace cst {
 
 /**
  * CubeTexture is a texture with six images. It is staged as normal
- * texture with the individual images appended together
+ * texture with the individual images stored one after another
  * and can be used as a skybox.
  */
 class CubeTexture : public Texture {
@@ -39,6 +41,11 @@ public:
               std::string const &right, std::string const &left,
               std::string const &name="");
 
+  // Create a cube texture from a KTX2 cube map, e.g. a prefiltered one with
+  // its mip levels.
+  CubeTexture(TextureType type, std::string const &filename,
+              std::string const &name = "");
+
   ~CubeTexture();
 
   int getWidth() const override { return width; };
@@ -49,18 +56,45 @@ public:
 
   int getLayers() const override { return 6; };
 
-  uint8_t *getPixels() const override { return pix; };
+  uint8_t *getPixels() const override;
+
+  PixelFormat getFormat() const override { return format; }
+
+  std::vector<TextureLevel> const &getLevels() const override {
+    return levels;
+  }
+
+  size_t getMemorySize() const override;
 
   bool isStaged() const override { return false; }
 
+  // Loads the faces into a single buffer, decoding them in parallel.
   void load() override;
 
+  void unload() override;
+
+  // Decoding into a provided buffer is supported for cube maps loaded from
+  // six images.
+  size_t prepareDecode() override;
+  void decodeInto(uint8_t *dst) override;
+
 private:
-  std::string const front, back, top, bottom, right, left;
-  int width, height, depth;
-  uint8_t *pix = nullptr;
+  // An encoded face between prepareDecode() and decodeInto().
+  struct Face {
+    std::vector<uint8_t> encoded;
+    ImageDecoder const *decoder = nullptr;
+  };
+
+  std::array<std::string, 6> const files; // in the order of the cube layers
+  std::string const filename;             // KTX2 cube map
+  int width = 0, height = 0, depth = 4;
+
+  PixelFormat format = PIXEL_FORMAT_RGBA8;
+  std::vector<TextureLevel> levels;
+  std::vector<uint8_t> data;
+  std::array<Face, 6> faces;
 };
 
 } // namespace cst
 
-#endif // _CST_LIB_SG_CUBETEXTURE_H
\ No newline at end of file
+#endif // _CST_LIB_SG_CUBETEXTURE_H
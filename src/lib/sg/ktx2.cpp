@@ -0,0 +1,424 @@
+/*
+ Copyright (c) 2022 Tero Oinas
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+#include "ktx2.h"
+#include "core/fileutil.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+
+#ifdef WALK_WITH_BASISU
+#include <basisu_transcoder.h>
+#endif
+
+using namespace cst;
+
+static const uint8_t KTX2_IDENTIFIER[12] = {0xAB, 'K',  'T',  'X',
+                                            ' ',  '2',  '0',  0xBB,
+                                            '\r', '\n', 0x1A, '\n'};
+
+// Supercompression schemes
+static const uint32_t KTX2_SUPERCOMPRESSION_NONE = 0;
+static const uint32_t KTX2_SUPERCOMPRESSION_BASISLZ = 1;
+
+// File header following the identifier. The 64-bit fields are not
+// naturally aligned in the file.
+#pragma pack(push, 1)
+struct KTX2Header {
+  uint32_t vkFormat;
+  uint32_t typeSize;
+  uint32_t pixelWidth;
+  uint32_t pixelHeight;
+  uint32_t pixelDepth;
+  uint32_t layerCount;
+  uint32_t faceCount;
+  uint32_t levelCount;
+  uint32_t supercompressionScheme;
+  uint32_t dfdByteOffset;
+  uint32_t dfdByteLength;
+  uint32_t kvdByteOffset;
+  uint32_t kvdByteLength;
+  uint64_t sgdByteOffset;
+  uint64_t sgdByteLength;
+};
+#pragma pack(pop)
+
+static_assert(sizeof(KTX2Header) == 68);
+
+struct KTX2LevelIndex {
+  uint64_t byteOffset;
+  uint64_t byteLength;
+  uint64_t uncompressedByteLength;
+};
+
+// Returns the pixel format of a VkFormat value, or false if not supported.
+static bool formatFromVk(uint32_t vkFormat, PixelFormat &format) {
+  switch (vkFormat) {
+  case 37: // VK_FORMAT_R8G8B8A8_UNORM
+  case 43: // VK_FORMAT_R8G8B8A8_SRGB
+    format = PIXEL_FORMAT_RGBA8;
+    return true;
+  case 131: // VK_FORMAT_BC1_RGB_UNORM_BLOCK
+  case 132: // VK_FORMAT_BC1_RGB_SRGB_BLOCK
+  case 133: // VK_FORMAT_BC1_RGBA_UNORM_BLOCK
+  case 134: // VK_FORMAT_BC1_RGBA_SRGB_BLOCK
+    format = PIXEL_FORMAT_BC1;
+    return true;
+  case 137: // VK_FORMAT_BC3_UNORM_BLOCK
+  case 138: // VK_FORMAT_BC3_SRGB_BLOCK
+    format = PIXEL_FORMAT_BC3;
+    return true;
+  case 141: // VK_FORMAT_BC5_UNORM_BLOCK
+    format = PIXEL_FORMAT_BC5;
+    return true;
+  case 145: // VK_FORMAT_BC7_UNORM_BLOCK
+  case 146: // VK_FORMAT_BC7_SRGB_BLOCK
+    format = PIXEL_FORMAT_BC7;
+    return true;
+  case 151: // VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK
+  case 152: // VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK
+    format = PIXEL_FORMAT_ETC2;
+    return true;
+  case 157: // VK_FORMAT_ASTC_4x4_UNORM_BLOCK
+  case 158: // VK_FORMAT_ASTC_4x4_SRGB_BLOCK
+    format = PIXEL_FORMAT_ASTC_4X4;
+    return true;
+  }
+  return false;
+}
+
+bool cst::isKTX2File(std::string const &filename) {
+  std::string const ext = ".ktx2";
+  if (filename.size() <= ext.size())
+    return false;
+
+  return std::equal(ext.rbegin(), ext.rend(), filename.rbegin(),
+                    [](char a, char b) { return a == tolower(b); });
+}
+
+#ifdef WALK_WITH_BASISU
+
+// Returns the best supported transcode target for the texture type.
+static PixelFormat selectTranscodeFormat(TextureType type, uint32_t formats) {
+  static const PixelFormat colorFormats[] = {
+      PIXEL_FORMAT_BC7, PIXEL_FORMAT_ASTC_4X4, PIXEL_FORMAT_ETC2,
+      PIXEL_FORMAT_BC3, PIXEL_FORMAT_BC1};
+  static const PixelFormat normalFormats[] = {
+      PIXEL_FORMAT_BC5, PIXEL_FORMAT_BC7, PIXEL_FORMAT_ASTC_4X4,
+      PIXEL_FORMAT_ETC2};
+
+  if (type == TEXTURE_TYPE_NORMAL) {
+    for (PixelFormat f : normalFormats)
+      if (formats & (1 << f))
+        return f;
+  } else {
+    for (PixelFormat f : colorFormats)
+      if (formats & (1 << f))
+        return f;
+  }
+  return PIXEL_FORMAT_RGBA8;
+}
+
+static basist::transcoder_texture_format toBasis(PixelFormat format) {
+  switch (format) {
+  case PIXEL_FORMAT_RGBA8:
+    return basist::transcoder_texture_format::cTFRGBA32;
+  case PIXEL_FORMAT_BC1:
+    return basist::transcoder_texture_format::cTFBC1_RGB;
+  case PIXEL_FORMAT_BC3:
+    return basist::transcoder_texture_format::cTFBC3_RGBA;
+  case PIXEL_FORMAT_BC5:
+    return basist::transcoder_texture_format::cTFBC5_RG;
+  case PIXEL_FORMAT_BC7:
+    return basist::transcoder_texture_format::cTFBC7_RGBA;
+  case PIXEL_FORMAT_ETC2:
+    return basist::transcoder_texture_format::cTFETC2_RGBA;
+  case PIXEL_FORMAT_ASTC_4X4:
+    return basist::transcoder_texture_format::cTFASTC_4x4_RGBA;
+  }
+  throw std::runtime_error("unknown pixel format");
+}
+
+static KTX2Image transcodeBasis(std::string const &filename,
+                                std::vector<uint8_t> const &file,
+                                TextureType type, uint32_t formats) {
+  static std::once_flag initialized;
+  std::call_once(initialized, [] { basist::basisu_transcoder_init(); });
+
+  basist::ktx2_transcoder tr;
+  if (!tr.init(file.data(), file.size()) || !tr.start_transcoding())
+    throw std::runtime_error("failed to read basis texture: " + filename);
+
+  KTX2Image img;
+  img.format = selectTranscodeFormat(type, formats);
+  img.width = tr.get_width();
+  img.height = tr.get_height();
+
+  uint32_t const faces = tr.get_faces();
+  uint32_t const layers = std::max(1u, tr.get_layers());
+  img.layers = faces * layers;
+
+  basist::transcoder_texture_format const tf = toBasis(img.format);
+
+  for (uint32_t level = 0; level < tr.get_levels(); level++) {
+    TextureLevel lv;
+    lv.offset = img.data.size();
+    lv.width = std::max(1, img.width >> level);
+    lv.height = std::max(1, img.height >> level);
+    lv.size = pixelDataSize(img.format, lv.width, lv.height);
+    img.levels.push_back(lv);
+
+    img.data.resize(lv.offset + lv.size * img.layers);
+
+    for (uint32_t layer = 0; layer < layers; layer++) {
+      for (uint32_t face = 0; face < faces; face++) {
+        uint8_t *out = img.data.data() + lv.offset +
+                       lv.size * (layer * faces + face);
+
+        uint32_t blocks = (img.format == PIXEL_FORMAT_RGBA8)
+                              ? lv.width * lv.height
+                              : ((lv.width + 3) / 4) * ((lv.height + 3) / 4);
+
+        if (!tr.transcode_image_level(level, layer, face, out, blocks, tf))
+          throw std::runtime_error("failed to transcode basis texture: " +
+                                   filename);
+      }
+    }
+  }
+
+  return img;
+}
+
+#endif // WALK_WITH_BASISU
+
+KTX2Image cst::loadKTX2(std::string const &filename, TextureType type,
+                        uint32_t formats) {
+  std::vector<uint8_t> file = loadFile(filename.c_str());
+
+  KTX2Header hdr;
+  if (file.size() < sizeof(KTX2_IDENTIFIER) + sizeof(hdr) ||
+      memcmp(file.data(), KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) != 0)
+    throw std::runtime_error("not a KTX2 file: " + filename);
+
+  memcpy(&hdr, file.data() + sizeof(KTX2_IDENTIFIER), sizeof(hdr));
+
+  if (hdr.pixelDepth > 1)
+    throw std::runtime_error("3D textures are not supported: " + filename);
+
+  // Basis Universal payloads have no VkFormat.
+  if (hdr.vkFormat == 0 ||
+      hdr.supercompressionScheme == KTX2_SUPERCOMPRESSION_BASISLZ) {
+#ifdef WALK_WITH_BASISU
+    return transcodeBasis(filename, file, type, formats);
+#else
+    throw std::runtime_error(
+        "basis universal textures need a build with the basisu transcoder: " +
+        filename);
+#endif
+  }
+
+  if (hdr.supercompressionScheme != KTX2_SUPERCOMPRESSION_NONE)
+    throw std::runtime_error("unsupported KTX2 supercompression: " + filename);
+
+  KTX2Image img;
+  if (!formatFromVk(hdr.vkFormat, img.format))
+    throw std::runtime_error("unsupported KTX2 format " +
+                             std::to_string(hdr.vkFormat) + ": " + filename);
+
+  if (!(formats & (1 << img.format)))
+    throw std::runtime_error("texture format not supported by the device: " +
+                             filename);
+
+  img.width = hdr.pixelWidth;
+  img.height = std::max(1u, hdr.pixelHeight);
+  img.layers = std::max(1u, hdr.layerCount) * std::max(1u, hdr.faceCount);
+
+  uint32_t const numLevels = std::max(1u, hdr.levelCount);
+  size_t const indexOffset = sizeof(KTX2_IDENTIFIER) + sizeof(hdr);
+  if (file.size() < indexOffset + numLevels * sizeof(KTX2LevelIndex))
+    throw std::runtime_error("truncated KTX2 file: " + filename);
+
+  // Levels are stored smallest first in the file, but the index starts from
+  // the base level. The output keeps the base level first.
+  size_t total = 0;
+  std::vector<KTX2LevelIndex> index(numLevels);
+  for (uint32_t i = 0; i < numLevels; i++) {
+    memcpy(&index[i], file.data() + indexOffset + i * sizeof(KTX2LevelIndex),
+           sizeof(KTX2LevelIndex));
+
+    TextureLevel lv;
+    lv.offset = total;
+    lv.width = std::max(1, img.width >> i);
+    lv.height = std::max(1, img.height >> i);
+    lv.size = pixelDataSize(img.format, lv.width, lv.height);
+
+    if (index[i].byteLength != lv.size * img.layers ||
+        index[i].byteOffset + index[i].byteLength > file.size())
+      throw std::runtime_error("invalid KTX2 level index: " + filename);
+
+    img.levels.push_back(lv);
+    total += lv.size * img.layers;
+  }
+
+  img.data.resize(total);
+  for (uint32_t i = 0; i < numLevels; i++)
+    memcpy(img.data.data() + img.levels[i].offset,
+           file.data() + index[i].byteOffset, index[i].byteLength);
+
+  return img;
+}
+
+// Data format descriptor values (Khronos Data Format Specification)
+static const uint32_t KHR_DF_MODEL_RGBSDA = 1;
+static const uint32_t KHR_DF_MODEL_BC1A = 128;
+static const uint32_t KHR_DF_MODEL_BC5 = 132;
+static const uint32_t KHR_DF_MODEL_BC7 = 134;
+static const uint32_t KHR_DF_PRIMARIES_BT709 = 1;
+static const uint32_t KHR_DF_TRANSFER_LINEAR = 1;
+static const uint32_t KHR_DF_TRANSFER_SRGB = 2;
+
+// Builds a basic data format descriptor with one sample per channel.
+static std::vector<uint32_t> buildDFD(PixelFormat format, bool srgb) {
+  uint32_t model, blockDim, bytes;
+  std::vector<std::pair<uint32_t, uint32_t>> samples; // (channel, bits)
+
+  switch (format) {
+  case PIXEL_FORMAT_RGBA8:
+    model = KHR_DF_MODEL_RGBSDA;
+    blockDim = 0;
+    bytes = 4;
+    samples = {{0, 8}, {1, 8}, {2, 8}, {15, 8}};
+    break;
+  case PIXEL_FORMAT_BC1:
+    model = KHR_DF_MODEL_BC1A;
+    blockDim = 3 | (3 << 8);
+    bytes = 8;
+    samples = {{0, 64}};
+    break;
+  case PIXEL_FORMAT_BC5:
+    model = KHR_DF_MODEL_BC5;
+    blockDim = 3 | (3 << 8);
+    bytes = 16;
+    samples = {{0, 64}, {1, 64}};
+    break;
+  case PIXEL_FORMAT_BC7:
+    model = KHR_DF_MODEL_BC7;
+    blockDim = 3 | (3 << 8);
+    bytes = 16;
+    samples = {{0, 128}};
+    break;
+  default:
+    throw std::runtime_error("unsupported KTX2 output format");
+  }
+
+  // sRGB does not apply to the alpha channel.
+  uint32_t transfer = srgb ? KHR_DF_TRANSFER_SRGB : KHR_DF_TRANSFER_LINEAR;
+  uint32_t blockSize = 24 + 16 * samples.size();
+
+  std::vector<uint32_t> dfd;
+  dfd.push_back(4 + blockSize);
+  dfd.push_back(0);                   // vendor, descriptor type
+  dfd.push_back(2 | (blockSize << 16)); // version, block size
+  dfd.push_back(model | (KHR_DF_PRIMARIES_BT709 << 8) | (transfer << 16));
+  dfd.push_back(blockDim);
+  dfd.push_back(bytes);
+  dfd.push_back(0);
+
+  uint32_t offset = 0;
+  for (auto [channel, bits] : samples) {
+    dfd.push_back(offset | ((bits - 1) << 16) | (channel << 24));
+    dfd.push_back(0);
+    dfd.push_back(0);
+    dfd.push_back(bits >= 32 ? 0xffffffff : (1u << bits) - 1);
+    offset += bits;
+  }
+  return dfd;
+}
+
+static uint32_t vkFormatOf(PixelFormat format, bool srgb) {
+  switch (format) {
+  case PIXEL_FORMAT_RGBA8:
+    return srgb ? 43 : 37;
+  case PIXEL_FORMAT_BC1:
+    return srgb ? 134 : 133;
+  case PIXEL_FORMAT_BC5:
+    return 141;
+  case PIXEL_FORMAT_BC7:
+    return srgb ? 146 : 145;
+  default:
+    throw std::runtime_error("unsupported KTX2 output format");
+  }
+}
+
+void cst::saveKTX2(std::string const &filename, KTX2Image const &img,
+                   bool srgb) {
+  if (img.layers != 1 || img.levels.empty())
+    throw std::runtime_error("unsupported KTX2 image layout: " + filename);
+
+  std::vector<uint32_t> dfd =
+      buildDFD(img.format, srgb && img.format != PIXEL_FORMAT_BC5);
+  size_t const numLevels = img.levels.size();
+
+  KTX2Header hdr{};
+  hdr.vkFormat = vkFormatOf(img.format, srgb);
+  hdr.typeSize = 1;
+  hdr.pixelWidth = img.width;
+  hdr.pixelHeight = img.height;
+  hdr.faceCount = 1;
+  hdr.levelCount = numLevels;
+  hdr.supercompressionScheme = KTX2_SUPERCOMPRESSION_NONE;
+  hdr.dfdByteOffset = sizeof(KTX2_IDENTIFIER) + sizeof(hdr) +
+                      numLevels * sizeof(KTX2LevelIndex);
+  hdr.dfdByteLength = dfd.size() * sizeof(uint32_t);
+
+  // Level data is stored smallest level first, each aligned to the block
+  // size (or 4 bytes for RGBA8).
+  size_t const align = (img.format == PIXEL_FORMAT_BC1) ? 8
+                       : (img.format == PIXEL_FORMAT_RGBA8) ? 4
+                                                            : 16;
+  std::vector<KTX2LevelIndex> index(numLevels);
+  size_t pos = hdr.dfdByteOffset + hdr.dfdByteLength;
+  for (size_t i = numLevels; i-- > 0;) {
+    pos = (pos + align - 1) / align * align;
+    index[i].byteOffset = pos;
+    index[i].byteLength = img.levels[i].size;
+    index[i].uncompressedByteLength = img.levels[i].size;
+    pos += img.levels[i].size;
+  }
+
+  std::vector<uint8_t> file(pos, 0);
+  memcpy(file.data(), KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER));
+  memcpy(file.data() + sizeof(KTX2_IDENTIFIER), &hdr, sizeof(hdr));
+  memcpy(file.data() + sizeof(KTX2_IDENTIFIER) + sizeof(hdr), index.data(),
+         numLevels * sizeof(KTX2LevelIndex));
+  memcpy(file.data() + hdr.dfdByteOffset, dfd.data(), hdr.dfdByteLength);
+  for (size_t i = 0; i < numLevels; i++)
+    memcpy(file.data() + index[i].byteOffset,
+           img.data.data() + img.levels[i].offset, img.levels[i].size);
+
+  std::ofstream fh(filename, std::ios::binary | std::ios::out);
+  fh.write((char const *)file.data(), file.size());
+  if (!fh.good())
+    throw std::runtime_error("failed to write " + filename);
+}
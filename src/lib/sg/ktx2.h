@@ -0,0 +1,66 @@
+/*
+ Copyright (c) 2022 Tero Oinas
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+#ifndef _CST_LIB_SG_KTX2_H
+#define _CST_LIB_SG_KTX2_H
+
+#include "texture.h"
+
+#include <string>
+#include <vector>
+
+namespace cst {
+
+/**
+ * KTX2Image is the pixel data of a KTX2 file with its mip levels. Array
+ * layers and cube faces are stored as layers, face-major within a layer.
+ */
+struct KTX2Image {
+  PixelFormat format = PIXEL_FORMAT_RGBA8;
+  int width = 0;
+  int height = 0;
+  int layers = 1;
+  std::vector<TextureLevel> levels;
+  std::vector<uint8_t> data;
+};
+
+// Returns true if the filename has a .ktx2 extension.
+bool isKTX2File(std::string const &filename);
+
+/**
+ * Loads a KTX2 file. Block compressed and RGBA8 payloads are loaded as is
+ * and must be in one of the given formats (a mask of 1 << PixelFormat).
+ * Basis Universal payloads (KHR_texture_basisu) are transcoded into the best
+ * supported format for the texture type. Transcoding requires building with
+ * the Basis Universal transcoder.
+ */
+KTX2Image loadKTX2(std::string const &filename, TextureType type,
+                   uint32_t formats);
+
+/**
+ * Saves an image as a KTX2 file without supercompression. Supports RGBA8,
+ * BC1, BC5 and BC7 data with a single layer.
+ */
+void saveKTX2(std::string const &filename, KTX2Image const &img, bool srgb);
+
+} // namespace cst
+
+#endif // _CST_LIB_SG_KTX2_H
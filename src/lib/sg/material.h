@@ -40,6 +40,11 @@ public:
   Material() {}
   virtual ~Material() {}
 
+  // Returns the name of the material, e.g. from the model file. May be
+  // empty.
+  std::string const &getName() const { return name; }
+  void setName(std::string const &name) { this->name = name; }
+
   // Returns true if this material is staged (i.e. is ready to be displayed)
   virtual bool isStaged() const = 0;
 
@@ -68,6 +73,7 @@ public:
   virtual texture_ptr getNormalTex() const = 0;
 
 private:
+  std::string name;
 };
 
 typedef std::shared_ptr<Material> material_ptr;
@@ -21,6 +21,8 @@
  */
 #include "node.h"
 
+#include <cassert>
+
 using namespace cst;
 
 Node::Node(mesh_ptr mesh, std::string const &name) : name(name) {
@@ -28,14 +30,59 @@ Node::Node(mesh_ptr mesh, std::string const &name) : name(name) {
 }
 
 Node::Node(node_ptr node)
-    : name(node->name), meshes(node->meshes), local(node->local),
-      global(node->global), children(node->children) {}
+    : name(node->name), meshes(node->meshes),
+      local(node->getLocalTransform()), global(node->getGlobalTransform()),
+      parent(node->parent), children(node->children) {
+  for (node_ptr &ch : children)
+    ch->parent = this;
+}
 
-void Node::updateGlobalTransform(mat4 const &p) {
-  std::scoped_lock lock(mutex());
-  global = p * local;
+Node::~Node() {
+  if (TransformStore *store = transforms)
+    store->remove(this);
+  for (node_ptr &ch : children) {
+    if (ch->parent == this)
+      ch->parent = nullptr;
+  }
+}
+
+void Node::updateGlobalTransform(mat4 const &p, bool parentChanged) {
+  assert(transforms == nullptr);
+  if (!parentChanged && !transformDirty && !childDirty)
+    return;
+
+  bool moved = false;
+  if (parentChanged || transformDirty) {
+    std::scoped_lock lock(mutex());
+    mat4 const g = p * local;
+    transformDirty = false;
+    if (g != global) {
+      global = g;
+      transformVersion++;
+      moved = true;
+    }
+    globalTransformChanged();
+  }
+
+  childDirty = false;
   for (node_ptr &ch : children)
-    ch->updateGlobalTransform(global);
+    ch->updateGlobalTransform(global, moved);
+}
+
+void Node::markTransformDirty() {
+  if (TransformStore *store = transforms) {
+    store->markDirty(transformIndex);
+    return;
+  }
+
+  transformDirty = true;
+  if (parent != nullptr)
+    parent->markChildDirty();
+}
+
+void Node::markChildDirty() {
+  for (Node *n = this; n != nullptr && !n->childDirty; n = n->parent)
+    n->childDirty = true;
 }
 
 void Node::move(vec3 const &rel, bool limitY) {
@@ -67,13 +114,12 @@ void Node::calcAABB() const {
   aabbIsUpToDate = true;
 }
 
-bool Node::isCulled(mat4 const &projView) const {
-  AABB const &aabb = getAABB() * getGlobalTransform();
-  return !aabb.isVisible(projView);
-}
-
 node_ptr Node::addChild(node_ptr child) {
   children.push_back(child);
+  child->parent = this;
+  markChildDirty();
+  if (TransformStore *store = transforms)
+    store->invalidate();
   return child;
 }
 
@@ -105,7 +151,11 @@ void Node::mapChildren(std::function<node_ptr(node_ptr)> f) {
     // std::scoped_lock lock(ch->mutex());
     ch->mapChildren(f);
     ch = f(ch);
+    ch->parent = this;
   }
+  markChildDirty();
+  if (TransformStore *store = transforms)
+    store->invalidate();
 }
 
 void Node::forMeshes(std::function<void(mesh_ptr)> const &f) const {
@@ -23,9 +23,12 @@
 #define _CST_LIB_SG_NODE_H
 
 #include "core/lockable.h"
+#include "math/frustum.h"
 #include "math/mat4.h"
 #include "mesh.h"
+#include "transform_store.h"
 
+#include <atomic>
 #include <functional>
 #include <iostream>
 #include <memory>
@@ -39,7 +42,11 @@ typedef std::shared_ptr<Node> node_ptr;
 class Renderer;
 
 /**
- * Node is a scene graph node.
+ * Node is a scene graph node. Once the hierarchy of a node is built into a
+ * TransformStore, the transforms of the node are kept in the store and the
+ * node accesses them by its index there. Threads other than the one
+ * updating the store must then hold the mutex of the store shared while
+ * reading the transforms.
  */
 class Node : public Lockable {
 public:
@@ -48,7 +55,7 @@ public:
   Node(std::vector<mesh_ptr> const &meshes, std::string const &name = "")
       : name(name), meshes(meshes) {}
   Node(node_ptr node);
-  virtual ~Node() {}
+  virtual ~Node();
 
   std::string const &getName() const { return name; }
 
@@ -62,40 +69,67 @@ public:
   // Returns the local transform of this node. Global transform
   // of this node is the product of its local transform and the
   // global transform of its parent.
-  mat4 const &getLocalTransform() const { return local; }
+  mat4 const &getLocalTransform() const {
+    TransformStore const *s = transforms;
+    return s ? s->getLocal(transformIndex) : local;
+  }
 
   // Sets the local transform. updateGlobalTransform() must be
   // called before this takes into effect.
-  void setLocalTransform(mat4 const &m) { local = m; }
+  void setLocalTransform(mat4 const &m) {
+    mat4 &l = localTransform();
+    if (m != l) {
+      l = m;
+      markTransformDirty();
+    }
+  }
 
   // Global transform is the effective world-space object transform.
-  mat4 const &getGlobalTransform() const { return global; }
+  mat4 const &getGlobalTransform() const {
+    TransformStore const *s = transforms;
+    return s ? s->getWorld(transformIndex) : global;
+  }
 
-  // Subclass might override to copy to UBOs etc.
-  virtual void updateGlobalTransform(mat4 const &p);
+  // Updates the global transforms from the global transform p of the parent.
+  // Only the nodes whose local transforms have changed and their subtrees
+  // are updated, or the whole subtree if parentChanged is set. Nodes in a
+  // TransformStore are updated with TransformStore::update() instead.
+  void updateGlobalTransform(mat4 const &p, bool parentChanged = false);
+
+  // Returns a counter that is incremented when the global transform changes.
+  uint32_t getTransformVersion() const {
+    TransformStore const *s = transforms;
+    return s ? s->getVersion(transformIndex) : transformVersion;
+  }
 
   // Sets the translation part of the local transform.
   vec3 getLocalPosition() const {
-    return vec3(local.m[12], local.m[13], local.m[14]);
+    mat4 const &l = getLocalTransform();
+    return vec3(l.m[12], l.m[13], l.m[14]);
   }
 
-  mat4 getLocalRotation() const { return local.getRotation(); }
+  mat4 getLocalRotation() const { return getLocalTransform().getRotation(); }
 
   // Sets the translation part of the local transform.
   void setLocalPosition(vec3 const &p) {
-    local.m[12] = p.d[0];
-    local.m[13] = p.d[1];
-    local.m[14] = p.d[2];
+    if (p != getLocalPosition()) {
+      mat4 &l = localTransform();
+      l.m[12] = p.d[0];
+      l.m[13] = p.d[1];
+      l.m[14] = p.d[2];
+      markTransformDirty();
+    }
   }
 
   // Returns the position in global space.
   vec3 getGlobalPosition() const {
-    return vec3(global.m[12], global.m[13], global.m[14]);
+    mat4 const &g = getGlobalTransform();
+    return vec3(g.m[12], g.m[13], g.m[14]);
   }
 
   // Returns the rotation part of the global transform as mat4.
   // The translation part is set to zero.
-  mat4 getGlobalRotation() const { return global.getRotation(); }
+  mat4 getGlobalRotation() const { return getGlobalTransform().getRotation(); }
 
   // Move to node by local transform * rel.
   void move(vec3 const &rel, bool limitY = false);
@@ -110,8 +144,18 @@ public:
   // needed. The box is in local space.
   AABB const &getAABB() const;
 
+  // Returns the bounding box of this node in world space.
+  AABB getWorldAABB() const { return getAABB() * getGlobalTransform(); }
+
   // Returns true if this node is culled by the given projection * view matrix.
-  bool isCulled(mat4 const &projView) const;
+  bool isCulled(mat4 const &projView) const {
+    return isCulled(Frustum(projView));
+  }
+
+  // Returns true if this node is outside the frustum.
+  bool isCulled(Frustum const &frustum) const {
+    return !frustum.isVisible(getWorldAABB());
+  }
 
   // Add a child node. Returns the added node.
   node_ptr addChild(node_ptr child);
@@ -143,7 +187,30 @@ public:
   // Updates the state of this mesh to the renderer.
   virtual void update(Renderer *renderer) {}
 
+protected:
+  // Called by updateGlobalTransform when the global transform of this node
+  // has been recalculated. Subclasses override this to e.g. update a view.
+  virtual void globalTransformChanged() {}
+
+  // Returns true if globalTransformChanged() is overridden. TransformStore
+  // calls it only for the nodes that return true.
+  virtual bool hasTransformHook() const { return false; }
+
+  // Marks the local transform changed, so updateGlobalTransform visits this
+  // node and its ancestors.
+  void markTransformDirty();
+
 private:
+  friend class TransformStore;
+
+  mat4 &localTransform() {
+    TransformStore *s = transforms;
+    return s ? s->getLocal(transformIndex) : local;
+  }
+
+  // Marks this node and its ancestors to have changed nodes below them.
+  void markChildDirty();
+
   // Calculates AABB of this node and its children and stores it into aaBB
   // variable.
   void calcAABB() const;
@@ -151,8 +218,17 @@ private:
   std::string name;
   bool visible = true;
   std::vector<mesh_ptr> meshes;
+
+  // Transforms of a node that is not in a TransformStore.
   mat4 local;
   mat4 global;
+  uint32_t transformVersion = 0;
+  // Set and cleared by the store with its mutex locked.
+  std::atomic<TransformStore *> transforms = nullptr;
+  uint32_t transformIndex = 0;
+  Node *parent = nullptr;
+  bool transformDirty = true; // local transform changed
+  bool childDirty = false;    // a node below has transformDirty set
   mutable AABB aaBB;
   mutable bool aabbIsUpToDate = false;
   std::vector<node_ptr> children;
@@ -21,6 +21,8 @@
  */
 #include "nodeutil.h"
 #include "cubetexture.h"
+#include "ktx2.h"
+#include "texture_cache.h"
 #include "math/geometry.h"
 #include "math/mathutil.h"
 
@@ -43,28 +45,12 @@ node_ptr cst::createMeshNode(
   material_ptr mat = std::make_shared<MaterialStd>(
       SHADE_MODE_SMOOTH, vec4(1.0f), 0.1f, 0.9f, 1.0f, false);
 
-  {
-    texture_ptr tex = Texture::getNamed(textureRoot + "/" + albedo);
-    if (tex == nullptr) {
-      tex = std::make_shared<TextureStd>(textureRoot + "/" + albedo,
-                                         TEXTURE_TYPE_ALBEDO);
-      Texture::storeNamed(tex);
-    }
-    tex->load();
-    mat->setAlbedoTex(tex);
-  }
+  mat->setAlbedoTex(loadTexture(textureRoot + "/" + albedo,
+                                 TEXTURE_TYPE_ALBEDO));
 
-  if (normal != "") {
-    texture_ptr tex = Texture::getNamed(textureRoot + "/" + normal);
-
-    if (tex == nullptr) {
-      tex = std::make_shared<TextureStd>(textureRoot + "/" + normal,
-                                         TEXTURE_TYPE_NORMAL);
-      Texture::storeNamed(tex);
-    }
-    tex->load();
-    mat->setNormalTex(tex);
-  }
+  if (normal != "")
+    mat->setNormalTex(loadTexture(textureRoot + "/" + normal,
+                                  TEXTURE_TYPE_NORMAL));
 
   return createMeshNode(name, vertices, indices, mat);
 }
@@ -82,12 +68,17 @@ node_ptr cst::createSkyBox(float size, material_ptr mat,
 
 node_ptr cst::createSkyBox(float size, std::string const &textureDir,
                            std::string const &name) {
-  texture_ptr tex = std::make_shared<CubeTexture>(
-      TEXTURE_TYPE_ALBEDO, //
-      textureDir + "/px.jpg", textureDir + "/nx.jpg", textureDir + "/py.jpg",
-      textureDir + "/ny.jpg", textureDir + "/pz.jpg", textureDir + "/nz.jpg",
-      "skybox");
-  tex->load();
+  // The faces are decoded when the texture is staged.
+  texture_ptr tex;
+  if (isKTX2File(textureDir))
+    tex = std::make_shared<CubeTexture>(TEXTURE_TYPE_ALBEDO, textureDir,
+                                        "skybox");
+  else
+    tex = std::make_shared<CubeTexture>(
+        TEXTURE_TYPE_ALBEDO, //
+        textureDir + "/px.jpg", textureDir + "/nx.jpg", textureDir + "/py.jpg",
+        textureDir + "/ny.jpg", textureDir + "/pz.jpg", textureDir + "/nz.jpg",
+        "skybox");
 
   material_ptr mat = std::make_shared<MaterialStd>(
       SHADE_MODE_UNSHADED, vec4(1.0f), 0.1f, 0.9f, 1.0f, true);
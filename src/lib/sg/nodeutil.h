@@ -46,7 +46,8 @@ node_ptr createSkyBox(float size, material_ptr mat,
                       std::string const &name = "skybox");
 
 // Create a cube suitable for a skybox. It is textured using a cube
-// texture from textureDir.
+// texture from the six images in textureDir, or from textureDir itself if it
+// is a KTX2 cube map.
 node_ptr createSkyBox(float size, std::string const &textureDir,
                       std::string const &name = "skybox");
 
@@ -21,41 +21,165 @@
  SOFTWARE.
  */
 #include "texture.h"
+#include "core/fileutil.h"
+#include "image/decoder.h"
+#include "ktx2.h"
+
 #include <cassert>
 #include <cstring>
+#include <filesystem>
+#include <iostream>
 #include <map>
 
 using namespace cst;
 
-static std::map<std::string, std::weak_ptr<Texture>> textures;
+static uint32_t supportedFormats = 1 << PIXEL_FORMAT_RGBA8;
 
-texture_ptr Texture::getNamed(std::string const &name) {
-  if (textures.count(name) > 0) {
-    std::weak_ptr<Texture> tw = textures[name];
+size_t cst::pixelDataSize(PixelFormat format, int width, int height) {
+  size_t blocks = size_t((width + 3) / 4) * ((height + 3) / 4);
 
-    if (!tw.expired())
-      return tw.lock();
+  switch (format) {
+  case PIXEL_FORMAT_RGBA8:
+    return size_t(width) * height * 4;
+  case PIXEL_FORMAT_BC1:
+    return blocks * 8;
+  case PIXEL_FORMAT_BC3:
+  case PIXEL_FORMAT_BC5:
+  case PIXEL_FORMAT_BC7:
+  case PIXEL_FORMAT_ETC2:
+  case PIXEL_FORMAT_ASTC_4X4:
+    return blocks * 16;
   }
-  return nullptr;
+  throw std::runtime_error("unknown pixel format");
 }
 
-void Texture::storeNamed(texture_ptr tex) { textures[tex->getName()] = tex; }
+std::string cst::bakedTexturePath(std::string const &filename,
+                                  TextureType type) {
+  static const std::map<TextureType, std::string> suffixes = {
+      {TEXTURE_TYPE_ALBEDO, "albedo"},
+      {TEXTURE_TYPE_ROUGHNESS, "rough"},
+      {TEXTURE_TYPE_NORMAL, "normal"},
+      {TEXTURE_TYPE_ARM, "arm"}};
+
+  auto slash = filename.rfind('/');
+  std::string base =
+      (slash == std::string::npos) ? filename : filename.substr(slash + 1);
 
-void Texture::clearCache() { textures.clear(); }
+  return dirPart(filename) + "/" + BAKED_TEXTURE_DIR + "/" + base + "." +
+         suffixes.at(type) + ".ktx2";
+}
 
-TextureStd::~TextureStd() { stbi_image_free(pix); }
+// Returns true if path exists and is not older than source.
+static bool isUpToDate(std::string const &path, std::string const &source) {
+  std::error_code ec;
+  auto t = std::filesystem::last_write_time(path, ec);
+  if (ec)
+    return false;
+
+  auto st = std::filesystem::last_write_time(source, ec);
+  return ec || t >= st;
+}
+
+std::vector<TextureLevel> const &Texture::getLevels() const {
+  static std::vector<TextureLevel> const noLevels;
+  return noLevels;
+}
+
+void Texture::setSupportedFormats(uint32_t formats) {
+  supportedFormats = formats;
+}
+
+uint32_t Texture::getSupportedFormats() { return supportedFormats; }
+
+TextureStd::~TextureStd() {}
 
 uint8_t *TextureStd::getPixels() const {
-  assert(pix != nullptr);
-  return pix;
+  assert(!data.empty());
+  return const_cast<uint8_t *>(data.data());
+}
+
+size_t TextureStd::getMemorySize() const {
+  return data.size() + encoded.size();
+}
+
+bool TextureStd::usesKTX2() const {
+  return isKTX2File(filename) ||
+         isUpToDate(bakedTexturePath(filename, getType()), filename);
 }
 
 void TextureStd::load() {
-  if (pix == nullptr) {
-    pix = stbi_load(filename.c_str(), &width, &height, &depth, 4);
-    if (pix == nullptr)
-      throw std::runtime_error(std::string("failed to load image: ") +
-                               filename);
+  if (!data.empty())
+    return;
+
+  if (isKTX2File(filename)) {
+    loadKTX2Data(filename);
+    return;
+  }
+
+  std::string baked = bakedTexturePath(filename, getType());
+  if (isUpToDate(baked, filename)) {
+    try {
+      loadKTX2Data(baked);
+      return;
+    } catch (std::runtime_error const &e) {
+      std::cerr << "Not using baked texture: " << e.what() << "\n";
+    }
+  }
+
+  ImageInfo info;
+  data = decodeImageFile(filename, info);
+  width = info.width;
+  height = info.height;
+  depth = 4;
+}
+
+void TextureStd::unload() {
+  std::vector<uint8_t>().swap(data);
+  std::vector<uint8_t>().swap(encoded);
+  levels.clear();
+  format = PIXEL_FORMAT_RGBA8;
+}
+
+size_t TextureStd::prepareDecode() {
+  if (!data.empty() || usesKTX2())
+    return 0;
+
+  encoded = loadFile(filename.c_str());
+  decoder = &findImageDecoder(encoded.data(), encoded.size());
+
+  try {
+    ImageInfo info = decoder->readInfo(encoded.data(), encoded.size());
+    width = info.width;
+    height = info.height;
     depth = 4;
+  } catch (std::runtime_error const &e) {
+    std::vector<uint8_t>().swap(encoded);
+    throw std::runtime_error(std::string(e.what()) + ": " + filename);
+  }
+  return size_t(width) * height * 4;
+}
+
+void TextureStd::decodeInto(uint8_t *dst) {
+  assert(!encoded.empty() && decoder != nullptr);
+
+  try {
+    decoder->decode(encoded.data(), encoded.size(), {width, height}, dst);
+  } catch (std::runtime_error const &e) {
+    std::vector<uint8_t>().swap(encoded);
+    throw std::runtime_error(std::string(e.what()) + ": " + filename);
   }
+  std::vector<uint8_t>().swap(encoded);
+}
+
+void TextureStd::loadKTX2Data(std::string const &path) {
+  KTX2Image img = loadKTX2(path, getType(), getSupportedFormats());
+  if (img.layers != 1)
+    throw std::runtime_error("texture arrays are not supported: " + path);
+
+  format = img.format;
+  width = img.width;
+  height = img.height;
+  depth = 4;
+  levels = std::move(img.levels);
+  data = std::move(img.data);
 }
@@ -27,9 +27,12 @@
 #include "support/stb_image.h"
 
 #include <memory>
+#include <vector>
 
 namespace cst {
 
+class ImageDecoder;
+
 enum TextureType {
   TEXTURE_TYPE_ALBEDO = 1,
   TEXTURE_TYPE_ROUGHNESS,
@@ -37,6 +40,36 @@ enum TextureType {
   TEXTURE_TYPE_ARM
 };
 
+// Formats of texture pixel data. Compressed formats use 4x4 pixel blocks.
+enum PixelFormat {
+  PIXEL_FORMAT_RGBA8 = 0,
+  PIXEL_FORMAT_BC1,
+  PIXEL_FORMAT_BC3,
+  PIXEL_FORMAT_BC5,
+  PIXEL_FORMAT_BC7,
+  PIXEL_FORMAT_ETC2,
+  PIXEL_FORMAT_ASTC_4X4
+};
+
+// Returns the size in bytes of width x height pixels in the given format.
+size_t pixelDataSize(PixelFormat format, int width, int height);
+
+// Directory, next to the source images, that holds baked textures.
+static constexpr char const *BAKED_TEXTURE_DIR = "walk-cache";
+
+// Returns the path of the baked (pre-mipmapped and compressed) version of an
+// image used as a texture of the given type.
+std::string bakedTexturePath(std::string const &filename, TextureType type);
+
+// Location of one mip level in the pixel data of a texture. All layers of
+// the level are stored one after another starting at offset.
+struct TextureLevel {
+  size_t offset;
+  size_t size; // size of a single layer
+  int width;
+  int height;
+};
+
 /**
  * Texture is a base class (interface) for texture implementations.
  */
@@ -74,20 +107,40 @@ public:
 
   virtual uint8_t *getPixels() const = 0;
 
+  // Returns the format of the pixel data.
+  virtual PixelFormat getFormat() const { return PIXEL_FORMAT_RGBA8; }
+
+  // Returns the mip levels stored in the pixel data. If empty, the pixels
+  // hold only the base level and the mip chain is generated when staged.
+  virtual std::vector<TextureLevel> const &getLevels() const;
+
+  // Returns the size of the pixel data held in system memory.
+  virtual size_t getMemorySize() const { return 0; }
+
   // Returns true if this texture is a visual texture and is staged.
   virtual bool isStaged() const = 0;
 
   // Load this texture into memory.
   virtual void load() = 0;
 
-  // Returns a name texture from cache.
-  static std::shared_ptr<Texture> getNamed(std::string const &name);
+  // Releases the pixel data from system memory, e.g. once it has been
+  // copied to the GPU. load() loads it again.
+  virtual void unload() {}
 
-  // Stores a texture in a cache.
-  static void storeNamed(std::shared_ptr<Texture> tex);
+  // Reads the dimensions of the texture without decoding its pixels and
+  // returns the size of the RGBA8 base level. Returns 0 if the texture must
+  // be loaded with load() instead.
+  virtual size_t prepareDecode() { return 0; }
 
-  // Clears the texture cache.
-  static void clearCache();
+  // Decodes the base level into dst of prepareDecode() bytes, e.g. mapped
+  // staging memory, without keeping a copy in system memory.
+  virtual void decodeInto(uint8_t *dst) {}
+
+  // Sets the pixel formats the renderer can sample from, as a mask of
+  // (1 << PixelFormat) bits. Compressed textures are loaded or transcoded
+  // into one of these.
+  static void setSupportedFormats(uint32_t formats);
+  static uint32_t getSupportedFormats();
 
   static bool calculateAverageColors;
 private:
@@ -119,16 +172,48 @@ public:
 
   uint8_t *getPixels() const override;
 
+  PixelFormat getFormat() const override { return format; }
+
+  std::vector<TextureLevel> const &getLevels() const override {
+    return levels;
+  }
+
+  size_t getMemorySize() const override;
+
   bool isStaged() const override { return false; }
 
+  // Loads the image. KTX2 files are loaded with their mip levels, other
+  // formats are decoded into RGBA8 with the fastest available decoder. An
+  // up to date baked version of the image is preferred when one exists.
   void load() override;
 
+  void unload() override;
+
+  // Decoding into a provided buffer is supported for images that are not
+  // KTX2 files and have no baked version.
+  size_t prepareDecode() override;
+  void decodeInto(uint8_t *dst) override;
+
 private:
+  // Loads pixel data and mip levels from a KTX2 file.
+  void loadKTX2Data(std::string const &path);
+
+  // Returns true if the image is loaded from a KTX2 file.
+  bool usesKTX2() const;
+
   std::string filename;
   int width, height, depth;
   int layers = 1;
-  stbi_uc *pix = nullptr;
   vec4 color;
+
+  // Pixel data and the mip levels stored in it.
+  PixelFormat format = PIXEL_FORMAT_RGBA8;
+  std::vector<TextureLevel> levels;
+  std::vector<uint8_t> data;
+
+  // Encoded image between prepareDecode() and decodeInto().
+  std::vector<uint8_t> encoded;
+  ImageDecoder const *decoder = nullptr;
 };
 
 } // namespace cst
@@ -0,0 +1,90 @@
+/*
+ Copyright (c) 2022 Tero Oinas
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+#include "texture_cache.h"
+
+using namespace cst;
+
+texture_ptr TextureCache::get(std::string const &name, TextureType type,
+                              std::function<texture_ptr()> const &create) {
+  Key key{name, type};
+  Shard &shard = shardOf(key);
+
+  std::scoped_lock lock(shard.mux);
+  std::weak_ptr<Texture> &entry = shard.entries[key];
+  if (texture_ptr tex = entry.lock()) {
+    hits++;
+    return tex;
+  }
+
+  misses++;
+  texture_ptr tex = create();
+  entry = tex;
+  return tex;
+}
+
+texture_ptr TextureCache::find(std::string const &name, TextureType type) {
+  Key key{name, type};
+  Shard &shard = shardOf(key);
+
+  std::scoped_lock lock(shard.mux);
+  auto it = shard.entries.find(key);
+  if (it == shard.entries.end())
+    return nullptr;
+
+  texture_ptr tex = it->second.lock();
+  if (tex == nullptr)
+    shard.entries.erase(it);
+  return tex;
+}
+
+void TextureCache::store(texture_ptr tex) {
+  Key key{tex->getName(), tex->getType()};
+  Shard &shard = shardOf(key);
+
+  std::scoped_lock lock(shard.mux);
+  shard.entries[key] = tex;
+}
+
+void TextureCache::clear() {
+  for (Shard &shard : shards) {
+    std::scoped_lock lock(shard.mux);
+    shard.entries.clear();
+  }
+}
+
+TextureCacheStats TextureCache::getStats() const {
+  TextureCacheStats stats;
+  stats.hits = hits;
+  stats.misses = misses;
+  return stats;
+}
+
+texture_ptr cst::loadTexture(std::string const &filename, TextureType type) {
+  return getTextureCache().get(filename, type, [&filename, type]() {
+    return std::make_shared<TextureStd>(filename, type);
+  });
+}
+
+TextureCache &cst::getTextureCache() {
+  static TextureCache cache;
+  return cache;
+}
@@ -0,0 +1,106 @@
+/*
+ Copyright (c) 2022 Tero Oinas
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+#ifndef _CST_LIB_SG_TEXTURE_CACHE_H
+#define _CST_LIB_SG_TEXTURE_CACHE_H
+
+#include "texture.h"
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace cst {
+
+struct TextureCacheStats {
+  uint64_t hits = 0;   // found loaded
+  uint64_t misses = 0; // created by the caller
+};
+
+/**
+ * TextureCache is a thread-safe cache of named textures keyed by the name
+ * and the type of the texture. It does not keep the textures alive.
+ * Concurrent requests for the same texture get the same object. The pixels
+ * are decoded once when the texture is staged, which stores the staged
+ * version in the cache.
+ */
+class TextureCache {
+public:
+  // Returns a texture from the cache or creates it with create. create is
+  // called with a shard of the cache locked, so it must not load anything.
+  texture_ptr get(std::string const &name, TextureType type,
+                  std::function<texture_ptr()> const &create);
+
+  // Returns a texture from the cache or nullptr if it is not cached.
+  texture_ptr find(std::string const &name, TextureType type);
+
+  // Stores a texture, replacing any texture with the same name and type,
+  // e.g. with a staged version of it.
+  void store(texture_ptr tex);
+
+  void clear();
+
+  TextureCacheStats getStats() const;
+
+private:
+  static const int NUM_SHARDS = 16;
+
+  struct Key {
+    std::string name;
+    TextureType type;
+
+    bool operator==(Key const &other) const {
+      return type == other.type && name == other.name;
+    }
+  };
+
+  struct KeyHash {
+    size_t operator()(Key const &key) const {
+      return std::hash<std::string>()(key.name) ^ (size_t(key.type) << 1);
+    }
+  };
+
+  struct Shard {
+    std::mutex mux;
+    std::unordered_map<Key, std::weak_ptr<Texture>, KeyHash> entries;
+  };
+
+  Shard &shardOf(Key const &key) {
+    return shards[KeyHash()(key) % NUM_SHARDS];
+  }
+
+  Shard shards[NUM_SHARDS];
+  std::atomic<uint64_t> hits = 0;
+  std::atomic<uint64_t> misses = 0;
+};
+
+// Returns the TextureCache singleton.
+TextureCache &getTextureCache();
+
+// Returns an image file as a texture of the given type, from the texture
+// cache if it is there already. The image is decoded when it is staged.
+texture_ptr loadTexture(std::string const &filename, TextureType type);
+
+} // namespace cst
+
+#endif // _CST_LIB_SG_TEXTURE_CACHE_H
@@ -0,0 +1,180 @@
+/*
+ Copyright (c) 2022 Tero Oinas
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+#include "transform_store.h"
+#include "node.h"
+
+#include <utility>
+
+using namespace cst;
+
+TransformStore::~TransformStore() { clear(); }
+
+void TransformStore::build(node_ptr root) {
+  std::vector<mat4> newLocals, newWorlds;
+  std::vector<uint32_t> newParents, newVersions;
+  std::vector<uint8_t> newHooked;
+  std::vector<Node *> newNodes;
+
+  // Depth-first with an explicit stack, as the hierarchy may be deep.
+  std::vector<std::pair<Node *, uint32_t>> stack = {{root.get(), NO_PARENT}};
+  while (!stack.empty()) {
+    auto [node, parent] = stack.back();
+    stack.pop_back();
+
+    uint32_t const idx = uint32_t(newNodes.size());
+    newLocals.push_back(node->getLocalTransform());
+    newWorlds.push_back(node->getGlobalTransform());
+    newParents.push_back(parent);
+    newVersions.push_back(node->getTransformVersion());
+    newHooked.push_back(node->hasTransformHook());
+    newNodes.push_back(node);
+
+    for (auto ch = node->children.rbegin(); ch != node->children.rend(); ++ch)
+      stack.push_back({ch->get(), idx});
+  }
+
+  std::unique_lock lock(mux);
+  std::scoped_lock nlock(nodesMux);
+
+  // Nodes of the previous contents that are not in the new hierarchy keep
+  // their transforms.
+  for (size_t i = 0; i < nodes.size(); i++)
+    detach(i);
+
+  for (uint32_t i = 0; i < newNodes.size(); i++) {
+    newNodes[i]->transforms = this;
+    newNodes[i]->transformIndex = i;
+  }
+
+  locals.swap(newLocals);
+  worlds.swap(newWorlds);
+  parents.swap(newParents);
+  versions.swap(newVersions);
+  hooked.swap(newHooked);
+  nodes.swap(newNodes);
+  dirty.assign(nodes.size(), 1);
+  moved.assign(nodes.size(), 0);
+  firstDirty = 0;
+  valid = true;
+
+  // The entries have new indices, so the log is skipped past.
+  logBegin += movedLog.size() + 1;
+  movedLog.clear();
+}
+
+void TransformStore::clear() {
+  std::unique_lock lock(mux);
+  std::scoped_lock nlock(nodesMux);
+
+  for (size_t i = 0; i < nodes.size(); i++)
+    detach(i);
+
+  locals.clear();
+  worlds.clear();
+  parents.clear();
+  versions.clear();
+  dirty.clear();
+  moved.clear();
+  hooked.clear();
+  nodes.clear();
+  valid = false;
+  logBegin += movedLog.size() + 1;
+  movedLog.clear();
+}
+
+void TransformStore::detach(size_t i) {
+  Node *node = nodes[i];
+  if (node == nullptr || node->transforms != this ||
+      node->transformIndex != i)
+    return;
+
+  node->local = locals[i];
+  node->global = worlds[i];
+  node->transformVersion = versions[i];
+  node->transformDirty = true;
+  node->childDirty = true;
+  node->transforms = nullptr;
+}
+
+Node *TransformStore::getRoot() const {
+  std::scoped_lock lock(nodesMux);
+  return nodes.empty() ? nullptr : nodes[0];
+}
+
+void TransformStore::remove(Node const *node) {
+  std::scoped_lock lock(nodesMux);
+  if (node->transforms != this)
+    return;
+
+  uint32_t const i = node->transformIndex;
+  if (i < nodes.size() && nodes[i] == node)
+    nodes[i] = nullptr;
+  valid = false;
+}
+
+void TransformStore::update() {
+  uint32_t const n = uint32_t(nodes.size());
+  uint32_t const first = firstDirty;
+  if (first >= n)
+    return;
+
+  std::unique_lock lock(mux);
+  changed.clear();
+  if (movedLog.size() > n) {
+    logBegin += movedLog.size();
+    movedLog.clear();
+  }
+  for (uint32_t i = first; i < n; i++) {
+    uint32_t const p = parents[i];
+    bool const parentMoved = (p != NO_PARENT) && moved[p];
+    if (!dirty[i] && !parentMoved)
+      continue;
+
+    mat4 const w = (p == NO_PARENT) ? locals[i] : worlds[p] * locals[i];
+    if (w != worlds[i]) {
+      worlds[i] = w;
+      versions[i]++;
+      moved[i] = 1;
+      movedLog.push_back(i);
+    }
+    dirty[i] = 0;
+    if (hooked[i])
+      changed.push_back(i);
+  }
+  std::fill(moved.begin() + first, moved.end(), 0);
+  firstDirty = n;
+  lock.unlock();
+
+  // The hooks may read the transforms of other nodes.
+  std::scoped_lock nlock(nodesMux);
+  for (uint32_t i : changed) {
+    Node *node = nodes[i];
+    if (node == nullptr)
+      continue;
+    if (i == 0) {
+      node->globalTransformChanged();
+    } else {
+      std::scoped_lock lock(node->mutex());
+      node->globalTransformChanged();
+    }
+  }
+}
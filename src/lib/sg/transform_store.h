@@ -0,0 +1,163 @@
+/*
+ Copyright (c) 2022 Tero Oinas
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+#ifndef _CST_LIB_SG_TRANSFORM_STORE_H
+#define _CST_LIB_SG_TRANSFORM_STORE_H
+
+#include "math/mat4.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <vector>
+
+namespace cst {
+
+class Node;
+typedef std::shared_ptr<Node> node_ptr;
+
+/**
+ * TransformStore holds the transforms of a node hierarchy in flat arrays:
+ * local and world matrices, parent indices, dirty flags and versions. The
+ * entries are in depth-first order, so every parent precedes its children
+ * and the world matrices are computed in a single linear pass. The nodes of
+ * the hierarchy become handles that read and write their entries.
+ *
+ * build(), clear() and update() are called by a single thread, which lock
+ * the mutex of the store exclusively while they write the arrays. Other
+ * threads hold it shared while they read the transforms of the nodes, e.g.
+ * when culling or drawing, and never lock it while holding a node.
+ */
+class TransformStore {
+public:
+  static constexpr uint32_t NO_PARENT = UINT32_MAX;
+
+  TransformStore() {}
+  TransformStore(TransformStore const &) = delete;
+  ~TransformStore();
+
+  TransformStore &operator=(TransformStore const &) = delete;
+
+  // Flattens the hierarchy under root into the store, replacing any
+  // previous contents. Every entry is recalculated on the next update().
+  // The arrays are built aside and swapped in, so readers are blocked only
+  // while the nodes are pointed to their new entries.
+  void build(node_ptr root);
+
+  // Moves the transforms back into the nodes and empties the store.
+  void clear();
+
+  // Returns the mutex readers on other threads hold shared.
+  std::shared_mutex &mutex() const { return mux; }
+
+  // Returns false if the hierarchy has changed since build().
+  bool isValid() const { return valid; }
+
+  // Marks the hierarchy changed, e.g. when a child is added.
+  void invalidate() { valid = false; }
+
+  // Returns the root the store was built from, or nullptr if it has been
+  // destroyed.
+  Node *getRoot() const;
+
+  size_t size() const { return nodes.size(); }
+
+  // Recalculates the world transforms of the dirty entries and of their
+  // descendants, and calls the transform hooks of their nodes. The caller
+  // must hold the mutex of the root node.
+  void update();
+
+  mat4 const &getLocal(uint32_t i) const { return locals[i]; }
+  mat4 &getLocal(uint32_t i) { return locals[i]; }
+  mat4 const &getWorld(uint32_t i) const { return worlds[i]; }
+  uint32_t getParent(uint32_t i) const { return parents[i]; }
+  uint32_t getVersion(uint32_t i) const { return versions[i]; }
+
+  // Marks the local transform of entry i changed.
+  void markDirty(uint32_t i) {
+    dirty[i] = 1;
+    firstDirty = std::min(firstDirty, i);
+  }
+
+  // Called when a node of the store is destroyed, on any thread.
+  void remove(Node const *node);
+
+  // Calls f for the nodes whose world transforms have changed since
+  // position pos of the log of moved entries, and sets pos to the end of
+  // the log. Returns false without calling f if the log no longer reaches
+  // back to pos, e.g. after build(), when any node may have moved. Start
+  // with NO_POSITION. The caller must hold the mutex shared. A node may be
+  // passed more than once.
+  template <typename F> bool forMoved(uint64_t &pos, F &&f) const;
+
+  static constexpr uint64_t NO_POSITION = UINT64_MAX;
+
+private:
+  // Moves the transforms of entry i back into its node, if the node still
+  // refers to the entry.
+  void detach(size_t i);
+
+  std::vector<mat4> locals;
+  std::vector<mat4> worlds;
+  std::vector<uint32_t> parents;
+  std::vector<uint32_t> versions;
+  std::vector<uint8_t> dirty;
+  std::vector<uint8_t> moved;  // world changed during update()
+  std::vector<uint8_t> hooked; // node has a transform hook
+  std::vector<Node *> nodes;
+
+  std::vector<uint32_t> changed; // hooked entries recalculated by update()
+
+  // Entries moved by update() since position logBegin. Emptied when it
+  // grows larger than the store, as a full scan is then cheaper.
+  std::vector<uint32_t> movedLog;
+  uint64_t logBegin = 0;
+
+  uint32_t firstDirty = 0;
+  std::atomic<bool> valid = false;
+
+  mutable std::shared_mutex mux;
+  mutable std::mutex nodesMux; // nodes, as nodes are destroyed on any thread
+};
+
+template <typename F>
+bool TransformStore::forMoved(uint64_t &pos, F &&f) const {
+  uint64_t const end = logBegin + movedLog.size();
+  if (pos < logBegin || pos > end) {
+    pos = end;
+    return false;
+  }
+
+  std::scoped_lock lock(nodesMux);
+  for (size_t i = pos - logBegin; i < movedLog.size(); i++) {
+    if (Node const *node = nodes[movedLog[i]])
+      f(node);
+  }
+  pos = end;
+  return true;
+}
+
+} // namespace cst
+
+#endif // _CST_LIB_SG_TRANSFORM_STORE_H
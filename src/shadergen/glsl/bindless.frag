@@ -0,0 +1,61 @@
+/*
+ Copyright (c) 2022 Tero Oinas
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+// Common declarations of the fragment shaders of bindless materials, in
+// place of common.frag. The material and its textures are indexed with the
+// slot pushed for each draw, and named as in common.frag so that the main
+// functions are shared.
+
+// Output attributes.
+layout(location = 0) out vec4 outColor;
+
+// Slot of the material of the draw.
+layout(push_constant) uniform DrawConstants {
+	uint material;
+} draw;
+
+struct Material {
+	vec4 albedo;
+	vec4 emissive;
+	float metallic;
+	float roughness;
+	float ao;
+	uint albedoTex;
+	uint roughnessTex;
+	uint normalTex;
+};
+
+layout(set = DESC_SET_MATERIAL, binding = DESC_BIND_BINDLESS_MATERIALS, std430) readonly buffer MaterialBuffer {
+	Material materials[];
+};
+
+layout(set = DESC_SET_MATERIAL, binding = DESC_BIND_BINDLESS_TEXTURES) uniform sampler2D textures[];
+layout(set = DESC_SET_MATERIAL, binding = DESC_BIND_BINDLESS_CUBEMAPS) uniform samplerCube cubeMaps[];
+
+// The slot is the same for the whole draw, so the indices are dynamically
+// uniform.
+#define mat materials[draw.material]
+#define albedoSampler textures[mat.albedoTex]
+#define roughSampler textures[mat.roughnessTex]
+#define normSampler textures[mat.normalTex]
+#define cubeSampler cubeMaps[mat.albedoTex]
+
@@ -44,8 +44,3 @@ layout(set = DESC_SET_MATERIAL, binding = DESC_BIND_MAT_NORMAL_TEXTURE) uniform
 // Cubemap
 layout(set = DESC_SET_MATERIAL, binding = DESC_BIND_MAT_CUBEMAP) uniform samplerCube cubeSampler;
 
-vec3 normalMap() {
-    return normalize(tbn * normalize(texture(normSampler, texCoord).rgb * 2.0 - 1.0));
-}
-
-
@@ -23,12 +23,12 @@
 #extension GL_ARB_separate_shader_objects : enable
 #extension GL_GOOGLE_include_directive : enable
 #extension GL_EXT_scalar_block_layout : enable
+#extension GL_EXT_nonuniform_qualifier : enable
 
 const float PI = 3.1415926538;
 
 const int DESC_SET_GLOBAL = 0;
 const int DESC_SET_MATERIAL = 1;
-const int DESC_SET_NODE = 2;
 
 const int DESC_BIND_MAT_BUFFER = 0;
 const int DESC_BIND_MAT_ALBEDO_TEXTURE = 1;
@@ -36,6 +36,10 @@ const int DESC_BIND_MAT_ROUGHNESS_TEXTURE = 2;
 const int DESC_BIND_MAT_NORMAL_TEXTURE = 3;
 const int DESC_BIND_MAT_CUBEMAP = 4;
 
+const int DESC_BIND_BINDLESS_MATERIALS = 0;
+const int DESC_BIND_BINDLESS_TEXTURES = 1;
+const int DESC_BIND_BINDLESS_CUBEMAPS = 2;
+
 const int MAX_LIGHTS = 8; // Must match MAX_LIGHTS in gfx/shader_data.h
 
 /** Uniform buffers **/
@@ -52,8 +56,3 @@ layout(set = DESC_SET_GLOBAL, binding = 0, std430) uniform GlobalBuffer {
 	vec4 lightColor[MAX_LIGHTS];
 } glob;
 
-layout(set = DESC_SET_NODE, binding = 0) uniform NodeBuffer {
-	mat4 transform;
-} node;
-
-
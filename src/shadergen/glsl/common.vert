@@ -24,4 +24,10 @@
 layout(location = 0) in vec3 in_pos;
 layout(location = 1) in vec3 in_normal;
 layout(location = 2) in vec2 in_texcoord;
-layout(location = 3) in vec3 in_tangent;
+layout(location = 3) in vec4 in_tangent;
+
+/** Storage buffers **/
+// Transforms of the instances drawn in the frame, indexed by gl_InstanceIndex.
+layout(set = DESC_SET_GLOBAL, binding = 1, std430) readonly buffer InstanceBuffer {
+	mat4 transform[];
+} instances;
@@ -22,6 +22,7 @@
 
 void main() {
 		pos_local = in_pos;
-		vec4 pos = glob.project * glob.view * node.transform * vec4(in_pos, 1.0f);
+		const mat4 transform = instances.transform[gl_InstanceIndex];
+		vec4 pos = glob.project * glob.view * transform * vec4(in_pos, 1.0f);
 		gl_Position = pos.xyww;
 }
@@ -21,18 +21,19 @@
  */
 
 void main() {
+	const mat4 transform = instances.transform[gl_InstanceIndex];
 	texCoord = in_texcoord;
 
-	pos_w = (node.transform * vec4(in_pos, 1.0f)).xyz;
-	normal_w = normalize((node.transform * vec4(in_normal, 0.0)).xyz);
+	pos_w = (transform * vec4(in_pos, 1.0f)).xyz;
+	normal_w = normalize((transform * vec4(in_normal, 0.0)).xyz);
 
 	// TBN matrix
-	const vec3 t = normalize(vec3(node.transform * vec4(in_tangent, 0.0)));
+	const vec3 t = normalize(vec3(transform * vec4(in_tangent.xyz, 0.0)));
 	const vec3 n = normal_w;
 	const vec3 t2 = normalize(t - dot(t, n) * n);
-	vec3 b = normalize(cross(n, t2));
+	vec3 b = normalize(cross(n, t2)) * in_tangent.w;
 	tbn	= mat3(t2, b, n);
 
-	gl_Position = glob.project * glob.view * node.transform * vec4(in_pos, 1.0f);
+	gl_Position = glob.project * glob.view * transform * vec4(in_pos, 1.0f);
 
 }
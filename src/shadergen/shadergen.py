@@ -24,7 +24,9 @@ from pathlib import Path
 
 common = Path('glsl/common.glsl').read_text()
 vert_common = Path('glsl/common.vert').read_text()
-frag_common = Path('glsl/common.frag').read_text()
+normal_map = Path('glsl/normal.frag').read_text()
+frag_common = Path('glsl/common.frag').read_text() + normal_map
+frag_common_bindless = Path('glsl/bindless.frag').read_text() + normal_map
 
 vertex_default = Path('glsl/default.vert').read_text()
 vertex_cube = Path('glsl/cube.vert').read_text()
@@ -68,40 +70,51 @@ def generate_vertex_shaders(srcout, binout):
   write_shader("cube.vert", cube_shader, srcout, binout)
 
 
-def generate_fragment_shaders(srcout, binout):
+# Bindless variants use frag_common_bindless in place of frag_common and have
+# the prefix "bindless_".
+def generate_fragment_shaders(srcout, binout, prefix, frag_common):
   write_shader(
-    "flat.frag", common + fragment_input_varyings(True) + frag_common + pbr +
-    postproc + untextured_main, srcout, binout)
+    prefix + "flat.frag",
+    common + fragment_input_varyings(True) + frag_common + pbr + postproc +
+    untextured_main, srcout, binout)
   write_shader(
-    "smooth.frag", common + fragment_input_varyings(False) + frag_common + pbr +
-    postproc + untextured_main, srcout, binout)
+    prefix + "smooth.frag",
+    common + fragment_input_varyings(False) + frag_common + pbr + postproc +
+    untextured_main, srcout, binout)
   write_shader(
-    "unshaded.frag", common + fragment_input_varyings(True) + frag_common +
-    pbr + postproc + unshaded_main, srcout, binout)
+    prefix + "unshaded.frag",
+    common + fragment_input_varyings(True) + frag_common + pbr + postproc +
+    unshaded_main, srcout, binout)
 
   write_shader(
-    "smooth_albedo_norm.frag", common + fragment_input_varyings(False) +
-    frag_common + pbr + postproc + textured_norm_main, srcout, binout)
+    prefix + "smooth_albedo_norm.frag",
+    common + fragment_input_varyings(False) + frag_common + pbr + postproc +
+    textured_norm_main, srcout, binout)
 
   write_shader(
-    "smooth_albedo_rough_norm.frag", common + fragment_input_varyings(False) +
-    frag_common + pbr + postproc + textured_rough_norm_main, srcout, binout)
+    prefix + "smooth_albedo_rough_norm.frag",
+    common + fragment_input_varyings(False) + frag_common + pbr + postproc +
+    textured_rough_norm_main, srcout, binout)
 
   write_shader(
-    "smooth_albedo_arm_norm.frag", common + fragment_input_varyings(False) +
-    frag_common + pbr + postproc + textured_arm_norm_main, srcout, binout)
+    prefix + "smooth_albedo_arm_norm.frag",
+    common + fragment_input_varyings(False) + frag_common + pbr + postproc +
+    textured_arm_norm_main, srcout, binout)
 
   write_shader(
-    "flat_albedo.frag", common + fragment_input_varyings(True) + frag_common +
-    pbr + postproc + textured_main, srcout, binout)
+    prefix + "flat_albedo.frag",
+    common + fragment_input_varyings(True) + frag_common + pbr + postproc +
+    textured_main, srcout, binout)
 
   write_shader(
-    "smooth_albedo.frag", common + fragment_input_varyings(False) +
-    frag_common + pbr + postproc + textured_main, srcout, binout)
+    prefix + "smooth_albedo.frag",
+    common + fragment_input_varyings(False) + frag_common + pbr + postproc +
+    textured_main, srcout, binout)
 
   write_shader(
-    "unshaded_albedo_cube.frag", common + fragment_input_varyings(False) +
-    frag_common + postproc + unshaded_textured_cube_main, srcout, binout)
+    prefix + "unshaded_albedo_cube.frag",
+    common + fragment_input_varyings(False) + frag_common + postproc +
+    unshaded_textured_cube_main, srcout, binout)
 
 
 def generate_shaders(srcout, binout):
@@ -114,7 +127,8 @@ def generate_shaders(srcout, binout):
     os.makedirs(binout)
 
   generate_vertex_shaders(srcout, binout)
-  generate_fragment_shaders(srcout, binout)
+  generate_fragment_shaders(srcout, binout, "", frag_common)
+  generate_fragment_shaders(srcout, binout, "bindless_", frag_common_bindless)
 
 
 generate_shaders(sys.argv[1], sys.argv[2])
@@ -0,0 +1,92 @@
+/*
+ Copyright (c) 2022 Tero Oinas
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+// Compares transformAABB and transformAABBScalar against transforming the
+// eight corners of the box for random affine transforms.
+
+#include "check.h"
+#include "math/aabb.h"
+
+#include <cmath>
+#include <random>
+
+using namespace cst;
+
+static const int NUM_CASES = 100000;
+
+static AABB transformCorners(mat4 const &tr, AABB const &aabb) {
+  vec3 const first = tr * aabb.p1;
+  AABB r(first, first);
+  for (int i = 1; i < 8; i++) {
+    vec3 const corner((i & 1) ? aabb.p2.x() : aabb.p1.x(),
+                      (i & 2) ? aabb.p2.y() : aabb.p1.y(),
+                      (i & 4) ? aabb.p2.z() : aabb.p1.z());
+    r.extend(tr * corner);
+  }
+  return r;
+}
+
+// Returns true if a and b are equal within the rounding error relative to
+// the magnitude of the coordinates.
+static bool near(AABB const &a, AABB const &b) {
+  for (int i = 0; i < 3; i++) {
+    float const scale = 1.0f + std::abs(b.p1.d[i]) + std::abs(b.p2.d[i]);
+    if (std::abs(a.p1.d[i] - b.p1.d[i]) > 1e-4f * scale ||
+        std::abs(a.p2.d[i] - b.p2.d[i]) > 1e-4f * scale)
+      return false;
+  }
+  return true;
+}
+
+int main() {
+  std::mt19937 rng(1);
+  std::uniform_real_distribution<float> u(-1.0f, 1.0f);
+  auto randomVec = [&](float scale) {
+    return vec3(u(rng), u(rng), u(rng)) * scale;
+  };
+
+  int failures = 0;
+  for (int i = 0; i < NUM_CASES && failures < 10; i++) {
+    // Rotation, translation and non-uniform scale, including mirroring and
+    // flat boxes.
+    vec3 const s = randomVec(4.0f);
+    mat4 const tr = mat4::translate(randomVec(100.0f)) *
+                    mat4::rot_axis(u(rng) * 3.2f, randomVec(1.0f) +
+                                                      vec3(0.0f, 0.0f, 1.1f)) *
+                    mat4::scale(vec3(s.x(), s.y(), i % 16 == 0 ? 0.0f : s.z()));
+
+    vec3 const p = randomVec(50.0f);
+    vec3 const e(std::abs(u(rng)) * 10.0f, std::abs(u(rng)) * 10.0f,
+                 i % 8 == 0 ? 0.0f : std::abs(u(rng)) * 10.0f);
+    AABB const aabb(p - e, p + e);
+
+    AABB const expected = transformCorners(tr, aabb);
+    AABB const simd = transformAABB(tr, aabb);
+    AABB const scalar = transformAABBScalar(tr, aabb);
+    if (!near(simd, expected) || !near(scalar, expected)) {
+      std::cerr << "case " << i << ": " << aabb << " -> " << expected
+                << ", got " << simd << " and " << scalar << "\n";
+      failures++;
+    }
+  }
+  CHECK(failures == 0);
+  return testResult("aabb_transform");
+}
@@ -0,0 +1,54 @@
+/*
+ Copyright (c) 2022 Tero Oinas
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+#ifndef _CST_TESTS_CHECK_H
+#define _CST_TESTS_CHECK_H
+
+#include <iostream>
+
+// Minimal checks for the test executables. A failed check is reported and
+// makes the test return a nonzero exit status from testResult().
+
+inline int &testFailures() {
+  static int failures = 0;
+  return failures;
+}
+
+#define CHECK(cond)                                                            \
+  do {                                                                         \
+    if (!(cond)) {                                                             \
+      std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: " #cond    \
+                << "\n";                                                       \
+      testFailures()++;                                                        \
+    }                                                                          \
+  } while (0)
+
+// Returns the exit status of the test and prints a summary.
+inline int testResult(char const *name) {
+  if (testFailures() > 0) {
+    std::cerr << name << ": " << testFailures() << " checks failed\n";
+    return 1;
+  }
+  std::cout << name << ": passed\n";
+  return 0;
+}
+
+#endif // _CST_TESTS_CHECK_H
@@ -0,0 +1,141 @@
+/*
+ Copyright (c) 2022 Tero Oinas
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+// Compares Frustum::isVisible and Frustum::testBoxes against transforming
+// the eight corners of each box to clip space, for random cameras and
+// boxes around and inside their view volumes. A box is outside if all its
+// corners are outside the same clip plane.
+
+#include "check.h"
+#include "math/frustum.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace cst;
+
+static const int NUM_CAMERAS = 200;
+// Not a multiple of four, so that testBoxes also takes its scalar tail.
+static const int NUM_BOXES = 1001;
+
+// Returns the signed distance of the box to the clip plane it is furthest
+// outside of, computed in double precision from the clip space coordinates
+// of its corners. The box is visible if the result is not negative.
+static double cornerDistance(mat4 const &projView, vec3 const &c,
+                             vec3 const &e) {
+  double clip[8][4];
+  for (int i = 0; i < 8; i++) {
+    double const p[3] = {c.d[0] + ((i & 1) ? e.d[0] : -e.d[0]),
+                         c.d[1] + ((i & 2) ? e.d[1] : -e.d[1]),
+                         c.d[2] + ((i & 4) ? e.d[2] : -e.d[2])};
+    for (int r = 0; r < 4; r++)
+      clip[i][r] = projView.m[r] * p[0] + projView.m[4 + r] * p[1] +
+                   projView.m[8 + r] * p[2] + projView.m[12 + r];
+  }
+
+  // -w <= x, y <= w and 0 <= z <= w as (sign of x, y, z, sign of w) pairs.
+  static const int planes[6][3] = {{0, 1, 1},  {0, -1, 1}, {1, 1, 1},
+                                   {1, -1, 1}, {2, 1, 0},  {2, -1, 1}};
+  double nearest = INFINITY;
+  for (auto const &pl : planes) {
+    // The length of the plane normal in world space, to turn the clip
+    // space values into distances that can be compared to a tolerance.
+    double n[3];
+    for (int k = 0; k < 3; k++)
+      n[k] = pl[1] * projView.m[4 * k + pl[0]] + pl[2] * projView.m[4 * k + 3];
+    double const len = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+    double furthest = -INFINITY;
+    for (auto const &v : clip)
+      furthest = std::max(furthest, pl[1] * v[pl[0]] + pl[2] * v[3]);
+    nearest = std::min(nearest, furthest / len);
+  }
+  return nearest;
+}
+
+int main() {
+  std::mt19937 rng(1);
+  std::uniform_real_distribution<float> u(-1.0f, 1.0f);
+  auto u01 = [&] { return 0.5f * (u(rng) + 1.0f); };
+  auto randomVec = [&](float scale) {
+    return vec3(u(rng), u(rng), u(rng)) * scale;
+  };
+
+  std::vector<float> cx(NUM_BOXES), cy(NUM_BOXES), cz(NUM_BOXES);
+  std::vector<float> ex(NUM_BOXES), ey(NUM_BOXES), ez(NUM_BOXES);
+  std::vector<uint8_t> visible(NUM_BOXES);
+
+  int failures = 0, numVisible = 0, numAmbiguous = 0;
+  for (int cam = 0; cam < NUM_CAMERAS && failures < 10; cam++) {
+    float const aspect = 0.5f + 2.0f * u01();
+    float const fov = 20.0f + 100.0f * u01();
+    float const near = 0.01f + u01();
+    float const far = near * (10.0f + 1000.0f * u01());
+    vec3 const axis = randomVec(1.0f) + vec3(0.0f, 0.0f, 1.1f);
+    mat4 const camera = mat4::translate(randomVec(100.0f)) *
+                        mat4::rot_axis(u(rng) * 3.2f, axis);
+    mat4 const projView = mat4::project(aspect, fov, near, far) *
+                          camera.invert();
+    Frustum const frustum(projView);
+
+    // Boxes placed in camera space over a volume somewhat larger than the
+    // frustum, so that many of them straddle its planes.
+    float const slope = std::tan(0.5f * fov * float(M_PI) / 180.0f) * 1.5f;
+    for (int i = 0; i < NUM_BOXES; i++) {
+      float const z = -far * (1.2f * u01() - 0.1f);
+      float const y = u(rng) * slope * std::abs(z);
+      vec3 const c = camera * vec3(u(rng) * slope * aspect * std::abs(z), y, z);
+      vec3 const e = vec3(u01(), u01(), i % 8 == 0 ? 0.0f : u01()) *
+                     (0.1f * std::abs(z) + near);
+      cx[i] = c.x(), cy[i] = c.y(), cz[i] = c.z();
+      ex[i] = e.x(), ey[i] = e.y(), ez[i] = e.z();
+    }
+    frustum.testBoxes(cx.data(), cy.data(), cz.data(), ex.data(), ey.data(),
+                      ez.data(), NUM_BOXES, visible.data());
+
+    for (int i = 0; i < NUM_BOXES; i++) {
+      vec3 const c(cx[i], cy[i], cz[i]), e(ex[i], ey[i], ez[i]);
+      double const dist = cornerDistance(projView, c, e);
+      bool const expected = dist >= 0.0;
+      numVisible += expected;
+
+      // Boxes touching a plane may go either way with float rounding.
+      double const scale = 1.0 + c.len() + e.len();
+      if (std::abs(dist) < 1e-4 * scale) {
+        numAmbiguous++;
+        continue;
+      }
+      bool const scalar = frustum.isVisible(c, e);
+      if (scalar != expected || bool(visible[i]) != expected) {
+        std::cerr << "camera " << cam << ", box " << i << ": " << c << " +- "
+                  << e << " expected " << expected << ", isVisible "
+                  << scalar << ", testBoxes " << int(visible[i]) << "\n";
+        failures++;
+      }
+    }
+  }
+  std::cout << NUM_CAMERAS * NUM_BOXES << " boxes, " << numVisible
+            << " visible, " << numAmbiguous << " touching a plane\n";
+  CHECK(failures == 0);
+  return testResult("frustum");
+}
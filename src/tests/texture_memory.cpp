@@ -0,0 +1,108 @@
+/*
+ Copyright (c) 2022 Tero Oinas
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+// Checks that the pixels of textures are released from system memory by
+// unload(), as done once a texture has been uploaded, by tracking the
+// resident set size of the process.
+
+#include "check.h"
+#include "core/memusage.h"
+#include "sg/texture.h"
+#include "support/stb_image_write.h"
+
+#include <filesystem>
+#include <unistd.h>
+#include <vector>
+
+using namespace cst;
+
+static const int SIZE = 1024;
+static const int NUM_TEXTURES = 16;
+static const size_t TEXTURE_BYTES = size_t(SIZE) * SIZE * 4;
+static const size_t TOTAL_BYTES = TEXTURE_BYTES * NUM_TEXTURES;
+
+static std::string writeImage(std::filesystem::path const &dir, int n) {
+  std::vector<uint8_t> pixels(TEXTURE_BYTES);
+  for (size_t i = 0; i < pixels.size(); i++)
+    pixels[i] = uint8_t(i / 4 + n);
+
+  std::string path = (dir / ("texture" + std::to_string(n) + ".png")).string();
+  stbi_write_png(path.c_str(), SIZE, SIZE, 4, pixels.data(), SIZE * 4);
+  return path;
+}
+
+static size_t mb(size_t bytes) { return bytes >> 20; }
+
+int main() {
+  std::filesystem::path dir = std::filesystem::temp_directory_path() /
+                              ("walk-test-" + std::to_string(getpid()));
+  std::filesystem::create_directories(dir);
+
+  std::vector<std::string> files;
+  for (int i = 0; i < NUM_TEXTURES; i++)
+    files.push_back(writeImage(dir, i));
+
+  std::vector<texture_ptr> textures;
+  for (std::string const &f : files)
+    textures.push_back(std::make_shared<TextureStd>(f, TEXTURE_TYPE_ALBEDO));
+
+  size_t const base = currentRSS();
+  CHECK(base > 0);
+
+  for (texture_ptr const &tex : textures) {
+    tex->load();
+    CHECK(tex->getMemorySize() == TEXTURE_BYTES);
+  }
+  size_t const loaded = currentRSS();
+
+  for (texture_ptr const &tex : textures) {
+    tex->unload();
+    CHECK(tex->getMemorySize() == 0);
+  }
+  size_t const unloaded = currentRSS();
+
+  std::cout << "RSS: base " << mb(base) << " MB, loaded " << mb(loaded)
+            << " MB, unloaded " << mb(unloaded) << " MB, peak "
+            << mb(peakRSS()) << " MB, pixels " << mb(TOTAL_BYTES) << " MB\n";
+
+  // Peak: the pixels of all of the textures were resident at once.
+  CHECK(loaded >= base + TOTAL_BYTES * 3 / 4);
+  CHECK(peakRSS() >= loaded);
+
+  // Steady state: unloading returns the memory.
+  CHECK(unloaded <= base + TOTAL_BYTES / 4);
+
+  // Decoding into a caller's buffer, e.g. staging memory, keeps nothing.
+  std::vector<uint8_t> staging(TEXTURE_BYTES);
+  for (texture_ptr const &tex : textures) {
+    CHECK(tex->prepareDecode() == TEXTURE_BYTES);
+    tex->decodeInto(staging.data());
+    CHECK(tex->getMemorySize() == 0);
+  }
+  CHECK(currentRSS() <= unloaded + TEXTURE_BYTES * 2);
+
+  // A texture unloaded after the upload can be loaded again.
+  textures[0]->load();
+  CHECK(textures[0]->getPixels()[4] == 1);
+
+  std::filesystem::remove_all(dir);
+  return testResult("texture_memory");
+}